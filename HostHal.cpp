@@ -0,0 +1,297 @@
+/*
+* HostHal.cpp
+*
+* Host implementation of the Arduino core subset used by RgbStrip.
+* Compiled out entirely on Arduino targets.
+*/
+
+#if !defined(ARDUINO)
+
+#include "HostHal.h"
+#include <errno.h>
+#include <time.h>
+
+namespace {
+	uint64_t virtualTime = 0;
+	HostHal::clock_source clockSource = NULL;
+
+	HostHal::pwm_sink pwmSink = NULL;
+	void* pwmSinkContext = NULL;
+
+	uint8_t pinModes[HostHal::NUM_PINS];
+	int pinValues[HostHal::NUM_PINS];
+	unsigned long pinWriteCounts[HostHal::NUM_PINS];
+	unsigned long writeCount = 0;
+	unsigned long wakeupCount = 0;
+
+	HostHal::PwmWrite writeLog[HostHal::WRITE_LOG_SIZE];
+	unsigned int writeLogHead = 0;
+	unsigned int writeLogCount = 0;
+
+	inline uint64_t currentTime() {
+		return clockSource ? clockSource() : virtualTime;
+	}
+}
+
+
+// Arduino core API
+
+unsigned long millis() {
+	return (unsigned long)(uint32_t)(currentTime() / 1000);
+}
+
+unsigned long micros() {
+	return (unsigned long)(uint32_t)currentTime();
+}
+
+void delay(unsigned long ms) {
+	if (clockSource) {
+		uint64_t until = clockSource() + (uint64_t)ms * 1000;
+		while (clockSource() < until) {
+		}
+	} else {
+		virtualTime += (uint64_t)ms * 1000;
+	}
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	if (pin < HostHal::NUM_PINS) {
+		pinModes[pin] = mode;
+	}
+}
+
+void analogWrite(uint8_t pin, int value) {
+	writeCount++;
+
+	if (pin < HostHal::NUM_PINS) {
+		pinValues[pin] = value;
+		pinWriteCounts[pin]++;
+	}
+
+	HostHal::PwmWrite& entry = writeLog[writeLogHead];
+	entry.time = currentTime();
+	entry.pin = pin;
+	entry.value = value;
+
+	writeLogHead = (writeLogHead + 1) % HostHal::WRITE_LOG_SIZE;
+	if (writeLogCount < HostHal::WRITE_LOG_SIZE) {
+		writeLogCount++;
+	}
+
+	if (pwmSink) {
+		pwmSink(pin, value, pwmSinkContext);
+	}
+}
+
+
+// Shim control
+
+void HostHal::reset() {
+	virtualTime = 0;
+	clockSource = NULL;
+	pwmSink = NULL;
+	pwmSinkContext = NULL;
+
+	memset(pinModes, 0, sizeof(pinModes));
+	memset(pinValues, 0, sizeof(pinValues));
+	memset(pinWriteCounts, 0, sizeof(pinWriteCounts));
+	writeCount = 0;
+	wakeupCount = 0;
+	clearWriteLog();
+}
+
+void HostHal::setMicros(uint64_t time) {
+	virtualTime = time;
+}
+
+void HostHal::advanceMicros(uint64_t duration) {
+	virtualTime += duration;
+}
+
+void HostHal::advanceMillis(uint64_t duration) {
+	virtualTime += duration * 1000;
+}
+
+uint64_t HostHal::now() {
+	return currentTime();
+}
+
+void HostHal::setClockSource(clock_source source) {
+	clockSource = source;
+}
+
+uint64_t HostHal::realMicros() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void HostHal::idle(unsigned long ms) {
+	if (clockSource) {
+		struct timespec ts;
+		ts.tv_sec = ms / 1000;
+		ts.tv_nsec = (long)(ms % 1000) * 1000000;
+		// Resume after a signal with the time that was left; any other error ends the sleep
+		while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+		}
+	} else {
+		virtualTime += (uint64_t)ms * 1000;
+	}
+
+	wakeupCount++;
+}
+
+unsigned long HostHal::getWakeupCount() {
+	return wakeupCount;
+}
+
+void HostHal::setPwmSink(pwm_sink sink, void* context) {
+	pwmSink = sink;
+	pwmSinkContext = context;
+}
+
+uint8_t HostHal::getPinMode(uint8_t pin) {
+	return pin < NUM_PINS ? pinModes[pin] : 0;
+}
+
+int HostHal::getPinValue(uint8_t pin) {
+	return pin < NUM_PINS ? pinValues[pin] : 0;
+}
+
+unsigned long HostHal::getWriteCount() {
+	return writeCount;
+}
+
+unsigned long HostHal::getPinWriteCount(uint8_t pin) {
+	return pin < NUM_PINS ? pinWriteCounts[pin] : 0;
+}
+
+unsigned int HostHal::getLoggedWriteCount() {
+	return writeLogCount;
+}
+
+/**
+* Get an entry from the write log
+* @param index Age of the entry; 0 is the oldest retained write
+*/
+const HostHal::PwmWrite& HostHal::getLoggedWrite(unsigned int index) {
+	unsigned int oldest = (writeLogHead + WRITE_LOG_SIZE - writeLogCount) % WRITE_LOG_SIZE;
+	return writeLog[(oldest + index) % WRITE_LOG_SIZE];
+}
+
+void HostHal::clearWriteLog() {
+	writeLogHead = 0;
+	writeLogCount = 0;
+}
+
+
+// Buffer stream
+
+HostHal::BufferStream::BufferStream() : _head(0), _count(0), _readCount(0) {
+}
+
+unsigned int HostHal::BufferStream::feed(const char* text) {
+	return feed((const uint8_t*) text, strlen(text));
+}
+
+unsigned int HostHal::BufferStream::feed(const uint8_t* data, unsigned int length) {
+	unsigned int accepted = 0;
+
+	while (accepted < length && _count < STREAM_BUFFER_SIZE) {
+		_buffer[(_head + _count) % STREAM_BUFFER_SIZE] = data[accepted++];
+		_count++;
+	}
+
+	return accepted;
+}
+
+int HostHal::BufferStream::available() {
+	return _count;
+}
+
+int HostHal::BufferStream::read() {
+	if (_count == 0) {
+		return -1;
+	}
+
+	uint8_t value = _buffer[_head];
+	_head = (_head + 1) % STREAM_BUFFER_SIZE;
+	_count--;
+	_readCount++;
+	return value;
+}
+
+int HostHal::BufferStream::peek() {
+	return _count ? _buffer[_head] : -1;
+}
+
+unsigned long HostHal::BufferStream::getReadCount() {
+	return _readCount;
+}
+
+
+
+// Timer thread
+
+HostHal::TimerThread::TimerThread() : _running(false), _started(false), _periodMicros(0), _callback(NULL), _context(NULL) {
+}
+
+HostHal::TimerThread::~TimerThread() {
+	stop();
+}
+
+bool HostHal::TimerThread::start(unsigned long periodMicros, tick_callback callback, void* context) {
+	if (_started || callback == NULL || periodMicros == 0) {
+		return false;
+	}
+
+	_periodMicros = periodMicros;
+	_callback = callback;
+	_context = context;
+	__atomic_store_n(&_running, true, __ATOMIC_RELEASE);
+
+	if (pthread_create(&_thread, NULL, threadMain, this) != 0) {
+		__atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+		return false;
+	}
+
+	_started = true;
+	return true;
+}
+
+void HostHal::TimerThread::stop() {
+	if (!_started) {
+		return;
+	}
+
+	__atomic_store_n(&_running, false, __ATOMIC_RELEASE);
+	pthread_join(_thread, NULL);
+	_started = false;
+}
+
+bool HostHal::TimerThread::isRunning() {
+	return _started;
+}
+
+void* HostHal::TimerThread::threadMain(void* instance) {
+	TimerThread* timer = (TimerThread*) instance;
+	struct timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	while (__atomic_load_n(&timer->_running, __ATOMIC_ACQUIRE)) {
+		deadline.tv_nsec += (long)(timer->_periodMicros % 1000000) * 1000;
+		deadline.tv_sec += timer->_periodMicros / 1000000 + deadline.tv_nsec / 1000000000;
+		deadline.tv_nsec %= 1000000000;
+
+		// clock_nanosleep() returns the error rather than setting errno. The deadline is absolute, so
+		// retrying after a signal is exact; any other error gives up on the wait and ticks now
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+		}
+
+		timer->_callback(timer->_context);
+	}
+
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,182 @@
+/*
+* HostHal.h
+*
+* Minimal Arduino core replacement used when RgbStrip is compiled on a host
+* (i.e. without ARDUINO defined). Time comes from a virtual clock that is only
+* advanced on request, and every analogWrite() is recorded so that the output
+* of a strip can be inspected or counted.
+*
+* The shim is pluggable: the clock and the PWM sink can both be redirected to
+* user supplied functions, e.g. to run against the real monotonic clock when
+* benchmarking.
+*/
+
+
+#ifndef HOSTHAL_H_
+#define HOSTHAL_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+// Program memory is ordinary memory on the host
+#define PROGMEM
+#define PGM_P const char*
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define memcpy_P memcpy
+
+// Arduino core API
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void pinMode(uint8_t pin, uint8_t mode);
+void analogWrite(uint8_t pin, int value);
+
+/**
+* Cut-down Arduino Stream, reading side only
+*/
+class Stream {
+	public:
+	virtual ~Stream() {}
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+};
+
+
+namespace HostHal {
+	// Number of pins tracked by the shim
+	const uint8_t NUM_PINS = 64;
+
+	// Number of PWM writes retained in the write log
+	const unsigned int WRITE_LOG_SIZE = 1024;
+
+	/**
+	* A single recorded analogWrite() call
+	* @param time Virtual time of the write in microseconds
+	* @param pin Pin that was written
+	* @param value Duty cycle that was written
+	*/
+	struct PwmWrite {
+		uint64_t time;
+		uint8_t pin;
+		int value;
+	};
+
+	typedef uint64_t (*clock_source)(void);
+	typedef void (*pwm_sink)(uint8_t pin, int value, void* context);
+
+	// Reset the clock, pin states and write log
+	void reset();
+
+	// Virtual clock control. Time is kept in microseconds.
+	void setMicros(uint64_t time);
+	void advanceMicros(uint64_t duration);
+	void advanceMillis(uint64_t duration);
+	uint64_t now();
+
+	// Replace the virtual clock with another time source (NULL restores the virtual clock)
+	void setClockSource(clock_source source);
+
+	// Monotonic wall clock in microseconds, suitable for setClockSource()
+	uint64_t realMicros();
+
+	// Sleep for the given time, standing in for a low power idle mode. The virtual clock is advanced;
+	// with a clock source set the thread sleeps with nanosleep(), so the source should follow real time
+	void idle(unsigned long ms);
+
+	// Number of returns from idle() since the last reset
+	unsigned long getWakeupCount();
+
+	// Forward every PWM write to an additional sink (NULL removes the sink)
+	void setPwmSink(pwm_sink sink, void* context);
+
+	// Pin state inspection
+	uint8_t getPinMode(uint8_t pin);
+	int getPinValue(uint8_t pin);
+
+	// Write log inspection
+	unsigned long getWriteCount();
+	unsigned long getPinWriteCount(uint8_t pin);
+	unsigned int getLoggedWriteCount();
+	const PwmWrite& getLoggedWrite(unsigned int index);
+	void clearWriteLog();
+
+	// Capacity of a BufferStream in bytes
+	const unsigned int STREAM_BUFFER_SIZE = 256;
+
+	/**
+	* Stream that plays back bytes fed to it, standing in for a serial port
+	* Bytes fed beyond STREAM_BUFFER_SIZE unread bytes are dropped, like a full UART buffer.
+	*/
+	class BufferStream : public Stream {
+		public:
+		BufferStream();
+
+		// Queue bytes to be read. Returns the number of bytes accepted
+		unsigned int feed(const char* text);
+		unsigned int feed(const uint8_t* data, unsigned int length);
+
+		int available();
+		int read();
+		int peek();
+
+		// Total number of bytes read from the stream
+		unsigned long getReadCount();
+
+		private:
+		uint8_t _buffer[STREAM_BUFFER_SIZE];
+		unsigned int _head;
+		unsigned int _count;
+		unsigned long _readCount;
+	};
+
+	typedef void (*tick_callback)(void* context);
+
+	/**
+	* POSIX thread that calls a function at a fixed period, standing in for a hardware timer interrupt
+	* Ticks are scheduled on absolute CLOCK_MONOTONIC deadlines, so they don't drift. Like an interrupt,
+	* a tick that overruns delays the following ones instead of overlapping them.
+	* Use with setClockSource(realMicros): the virtual clock is not safe to advance from another thread.
+	*/
+	class TimerThread {
+		public:
+		TimerThread();
+		~TimerThread();
+
+		// Start calling the function every period microseconds. Returns false if already running or the thread can't start
+		bool start(unsigned long periodMicros, tick_callback callback, void* context);
+
+		// Stop ticking and wait for the thread to finish its current tick
+		void stop();
+
+		// Determine if the thread is running
+		bool isRunning();
+
+		private:
+		TimerThread(const TimerThread&);
+		TimerThread& operator=(const TimerThread&);
+
+		static void* threadMain(void* instance);
+
+		pthread_t _thread;
+		bool _running;	// Accessed with __atomic builtins; cleared by stop()
+		bool _started;	// Owner thread only
+		unsigned long _periodMicros;
+		tick_callback _callback;
+		void* _context;
+	};
+}
+
+#endif /* HOSTHAL_H_ */
@@ -0,0 +1,334 @@
+/*
+* PixelStrip.cpp
+*
+* Addressable LED strip backend. See PixelStrip.h.
+*/
+
+#include "PixelStrip.h"
+
+
+/**
+* Constructor
+* All pixels start off, at full brightness with transitions and strobing disabled, as for RgbStrip.
+* @param active Active colour buffer of numPixels * 3 bytes
+* @param target Target colour buffer of numPixels * 3 bytes
+* @param frame Encoded frame buffer of numPixels * 3 bytes
+* @param numPixels Number of pixels
+* @param transport Transport that frames are sent through
+* @param timer Scheduler for the transition, strobe and flash events
+* @param order Byte order of a pixel on the wire (see PIXEL_ORDERS)
+*/
+PixelStrip::PixelStrip(byte* active, byte* target, byte* frame, uint16_t numPixels, PixelTransport& transport, SimpleTimer& timer, byte order)
+	: StripControl(timer), _transport(transport) {
+	_active = active;
+	_target = target;
+	_frame = frame;
+	_numPixels = numPixels;
+
+	switch (order) {
+		case PIXEL_RGB:
+			_redOffset = 0; _greenOffset = 1; _blueOffset = 2;
+			break;
+		case PIXEL_BGR:
+			_redOffset = 2; _greenOffset = 1; _blueOffset = 0;
+			break;
+		default:
+			_redOffset = 1; _greenOffset = 0; _blueOffset = 2;
+			break;
+	}
+
+	memset(_active, 0, numPixels * 3);
+	memset(_target, 0, numPixels * 3);
+	memset(_frame, 0, numPixels * 3);
+	_frameCount = 0;
+	resetCommitTimes();
+
+	// Set initial brightness and output curve; the first update() sends an all-off frame
+	_outputCurve = CURVE_LINEAR;
+	_brightness = DEFAULT_BRIGHTNESS;
+	updateLevelTable();
+
+	// Set up transition and strobe events
+	scheduleEvents();
+}
+
+
+// Pixel access
+void PixelStrip::putPixel(byte* buffer, uint16_t pixel, RGB colour) {
+	byte* p = buffer + pixel * 3;
+	p[_redOffset] = colour.r;
+	p[_greenOffset] = colour.g;
+	p[_blueOffset] = colour.b;
+}
+
+
+RGB PixelStrip::getPixel(const byte* buffer, uint16_t pixel) {
+	const byte* p = buffer + pixel * 3;
+	RGB colour = {p[_redOffset], p[_greenOffset], p[_blueOffset]};
+	return colour;
+}
+
+
+/**
+* Set the target colour of a single pixel
+* @param pixel Index of the pixel. Out of range pixels are ignored
+* @param colour RGB colour code of the desired colour
+*/
+void PixelStrip::setPixelColour(uint16_t pixel, RGB colour) {
+	if (pixel >= _numPixels) {
+		return;
+	}
+
+	putPixel(_target, pixel, colour);
+
+	// If transitions are not enabled, write the change in colour immediately
+	if (isTransitionsEnabled() == false) {
+		putPixel(_active, pixel, colour);
+		_frameDirty = true;
+	}
+}
+
+
+/**
+* Set the target colour of every pixel
+* @param colour RGB colour code of the desired colour
+*/
+void PixelStrip::setTargetColour(RGB colour) {
+	for (uint16_t i = 0; i < _numPixels; i++) {
+		putPixel(_target, i, colour);
+	}
+
+	if (isTransitionsEnabled() == false) {
+		memcpy(_active, _target, _numPixels * 3);
+		_frameDirty = true;
+	}
+}
+
+
+/**
+* Get the colour a pixel currently displays
+* @return Active colour of the pixel, before brightness and the output curve; black if out of range
+*/
+RGB PixelStrip::getPixelColour(uint16_t pixel) {
+	if (pixel >= _numPixels) {
+		RGB black = {0, 0, 0};
+		return black;
+	}
+	return getPixel(_active, pixel);
+}
+
+
+/**
+* Get the colour a pixel is transitioning towards
+* @return Target colour of the pixel; black if out of range
+*/
+RGB PixelStrip::getPixelTarget(uint16_t pixel) {
+	if (pixel >= _numPixels) {
+		RGB black = {0, 0, 0};
+		return black;
+	}
+	return getPixel(_target, pixel);
+}
+
+
+uint16_t PixelStrip::getNumPixels() {
+	return _numPixels;
+}
+
+
+const byte* PixelStrip::getFrame() {
+	return _frame;
+}
+
+
+// Brightness and output curve
+/**
+* Set the brightness of every pixel as a percentage
+* @param percentage The percentage intensity of the pixels. 100% is full brightness, whilst 0% is off
+*/
+void PixelStrip::setBrightness(int percentage) {
+	if (percentage > 100) {
+		percentage = 100;
+	} else if (percentage <= 0) {
+		percentage = 0;
+	}
+
+	if (percentage != _brightness) {
+		_brightness = percentage;
+		updateLevelTable();
+	}
+}
+
+
+int PixelStrip::getBrightness() {
+	return _brightness;
+}
+
+
+/**
+* Select the curve used to map colour levels onto encoded output levels
+* @param curve One of OUTPUT_CURVES (see RgbCurves.h). Unknown curves are ignored.
+*/
+void PixelStrip::setOutputCurve(byte curve) {
+	if (curve < NUM_OUTPUT_CURVES && curve != _outputCurve) {
+		_outputCurve = curve;
+		updateLevelTable();
+	}
+}
+
+
+byte PixelStrip::getOutputCurve() {
+	return _outputCurve;
+}
+
+
+/**
+* Rebuild the table that encodes channel levels
+* Each level goes through the same 16-bit pipeline as RgbStrip (brightness, then the output curve)
+* and is rounded to 8 bits. Rebuilding costs 256 curve evaluations, only when brightness or curve change.
+*/
+void PixelStrip::updateLevelTable() {
+	uint16_t brightnessScale = ((uint32_t)_brightness * 32768 + 50) / 100;
+	const uint16_t* curveTable = (_outputCurve == CURVE_LINEAR) ? NULL : OUTPUT_CURVE_TABLES[_outputCurve - 1];
+
+	for (uint16_t level = 0; level < 256; level++) {
+		uint16_t output = ((uint32_t)(level * 257U) * brightnessScale) >> 15;
+		if (curveTable != NULL) {
+			output = applyOutputCurve(curveTable, output);
+		}
+		_levelTable[level] = ((uint32_t)output * 255 + 32767) / 65535;
+	}
+
+	_frameDirty = true;
+}
+
+
+// Transitions
+/**
+* Step every channel of every pixel towards its target
+* Several steps are taken as one larger step, which lands in the same place.
+* The buffers hold the same channel order, so the whole active buffer is stepped in one pass by the
+* batched kernel in RgbBlend.h, without unpacking pixels or branching per channel.
+*/
+void PixelStrip::stepTowardsTargetColours(unsigned int steps) {
+	byte step = (steps >= 255 / TRANSITION_STEP) ? 255 : steps * TRANSITION_STEP;
+
+	if (blendTowards(_active, _target, _numPixels * 3, step)) {
+		_frameDirty = true;
+	}
+}
+
+
+/**
+* Determine if every pixel has reached its target colour
+*/
+bool PixelStrip::isTargetColourReached() {
+	return memcmp(_active, _target, _numPixels * 3) == 0;
+}
+
+
+/**
+* Callback for the transition timer event
+* Events missed while loop() was busy are made up for in this step, as for RgbStrip.
+*/
+void PixelStrip::transitionEvent(unsigned int missed) {
+	stepTowardsTargetColours(missed + 1);
+}
+
+
+// Output
+/**
+* Run timer events and send a frame if anything changed
+* Strips sharing a scheduler all run it; when nothing is due this is a single comparison.
+*/
+void PixelStrip::update() {
+	_timer.run();
+
+	if (_frameDirty) {
+		show();
+	}
+}
+
+
+/**
+* Get how long the sketch can sleep before update() next has work to do
+* As RgbStrip::msUntilNextEvent(): covers every timer on the strip's scheduler, and returns 0 while a frame is pending.
+* @return Time in ms until the next event, 0 if update() has work to do now, or RGBSTRIP_NO_EVENT if nothing is scheduled
+*/
+unsigned long PixelStrip::msUntilNextEvent() {
+	if (_frameDirty) {
+		return 0;
+	}
+
+	uint32_t ticks = _timer.nextDeadline();
+	if (ticks == SimpleTimer::NO_DEADLINE) {
+		return RGBSTRIP_NO_EVENT;
+	}
+
+	// Round up so the sketch doesn't wake just before the deadline
+	return ticksToMs(ticks + SIMPLETIMER_TICKS_PER_MS - 1);
+}
+
+
+/**
+* Encode the active colours into the frame and send it
+* If the transport is not ready the frame stays pending and is sent by a later update().
+* The active buffer acts as the back buffer: the transport only ever sees a complete frame, and
+* all changes since the last frame go out together. The commit (encoding plus the transport's
+* show()) is timed; transports that disable interrupts while sending can stop micros() advancing
+* on AVR, so time those from the transport's own frame length.
+*/
+void PixelStrip::show() {
+	if (!_transport.canShow()) {
+		_frameDirty = true;
+		return;
+	}
+
+	// Timed in 32 bits so that it stays right when micros() wraps, also where unsigned long is wider
+	uint32_t start = micros();
+
+	uint16_t length = _numPixels * 3;
+	for (uint16_t i = 0; i < length; i++) {
+		_frame[i] = _levelTable[_active[i]];
+	}
+
+	_transport.show(_frame, length);
+	_frameDirty = false;
+	_frameCount++;
+
+	uint32_t elapsed = micros() - start;
+	_commitTime = elapsed;
+	if (elapsed > _maxCommitTime) {
+		_maxCommitTime = elapsed;
+	}
+}
+
+
+unsigned long PixelStrip::getFrameCount() {
+	return _frameCount;
+}
+
+
+/**
+* Get the duration of the last commit
+* @return Time taken to encode and send the last frame, in microseconds
+*/
+unsigned long PixelStrip::getCommitTime() {
+	return _commitTime;
+}
+
+
+/**
+* Get the longest commit since the timings were reset
+* Encoding is one table read per byte, so this grows linearly with the strip length plus the transport's cost.
+* @return Longest time taken to encode and send a frame, in microseconds
+*/
+unsigned long PixelStrip::getMaxCommitTime() {
+	return _maxCommitTime;
+}
+
+
+void PixelStrip::resetCommitTimes() {
+	_commitTime = 0;
+	_maxCommitTime = 0;
+}
@@ -0,0 +1,173 @@
+/*
+* PixelStrip.h
+*
+* Addressable LED strip (WS2812, APA102, ...) with the same transition, strobe
+* and flash behaviour as RgbStrip, applied to every pixel. Both strips get those
+* events and the brightness shortcuts from StripControl (see StripControl.h).
+*
+* Pixels are kept as three contiguous byte buffers in the strip's channel order
+* (GRB by default): the active colours, the target colours, and the encoded
+* frame that is handed to the transport. Brightness and the output curve are
+* folded into a 256 entry table, so encoding a frame is one table read per byte.
+* A frame is only encoded and sent from update(), and only when something changed.
+*
+* Example:
+*   NeoPixelTransport transport(pixels);	// see PixelTransport.h
+*   PixelStripT<60> strip(transport);
+*
+*   strip.setOutputCurve(CURVE_GAMMA);
+*   strip.enableTransitions();
+*   strip.setPixelColour(0, COLOURS[RED]);
+*   ...
+*   strip.update();
+*/
+
+
+#ifndef PIXELSTRIP_H_
+#define PIXELSTRIP_H_
+
+#include "RgbHal.h"
+#include "RgbStrip.h"
+#include "PixelTransport.h"
+#include "RgbBlend.h"
+
+/**
+* Byte order of a pixel on the wire
+*/
+enum PIXEL_ORDERS{
+	PIXEL_GRB = 0,	// WS2812, SK6812
+	PIXEL_RGB = 1,	// WS2811 and some clones
+	PIXEL_BGR = 2	// APA102, SK9822
+};
+
+class PixelStrip : public StripControl
+{
+	public:
+	// Set the target colour of one pixel, or of every pixel. Colours change instantly if transitions are disabled
+	void setPixelColour(uint16_t pixel, RGB colour);
+	void setTargetColour(RGB colour);
+
+	// Get the colour a pixel currently displays (before brightness is applied)
+	RGB getPixelColour(uint16_t pixel);
+
+	// Get the colour a pixel is transitioning towards
+	RGB getPixelTarget(uint16_t pixel);
+
+	// Number of pixels in the strip
+	uint16_t getNumPixels();
+
+	// Encoded frame sent to the transport: getNumPixels() * 3 bytes in wire order
+	const byte* getFrame();
+
+	// Set the brightness of the whole strip
+	void setBrightness(int percentage);
+
+	// Get the brightness of the strip
+	int getBrightness();
+
+	// Select the output curve (see OUTPUT_CURVES in RgbCurves.h) applied when frames are encoded
+	void setOutputCurve(byte curve);
+
+	// Get the output curve applied when frames are encoded
+	byte getOutputCurve();
+
+	// Determine if every pixel has reached its target colour
+	bool isTargetColourReached();
+
+	// Run timer events, then encode and send a frame if anything changed
+	void update();
+
+	// Get the time in ms until update() next has work to do, 0 if it has work now, or RGBSTRIP_NO_EVENT if nothing is scheduled
+	unsigned long msUntilNextEvent();
+
+	// Encode and send a frame now, if the transport is ready
+	void show();
+
+	// Get the number of frames sent to the transport
+	unsigned long getFrameCount();
+
+	// Get the time taken to encode and send the last frame in microseconds
+	unsigned long getCommitTime();
+
+	// Get the longest time taken to encode and send a frame, in microseconds
+	unsigned long getMaxCommitTime();
+
+	// Reset the commit timings to zero
+	void resetCommitTimes();
+
+	protected:
+	// Constructor, called by PixelStripT with its storage
+	PixelStrip(byte* active, byte* target, byte* frame, uint16_t numPixels, PixelTransport& transport, SimpleTimer& timer, byte order);
+
+	private:
+	PixelStrip(const PixelStrip&);
+	PixelStrip& operator=(const PixelStrip&);
+
+	// Store a colour at a pixel of a buffer in wire order
+	void putPixel(byte* buffer, uint16_t pixel, RGB colour);
+
+	// Read the colour of a pixel from a buffer in wire order
+	RGB getPixel(const byte* buffer, uint16_t pixel);
+
+	// Rebuild the encode table from the brightness and output curve
+	void updateLevelTable();
+
+	// Step every channel of every pixel towards its target by TRANSITION_STEP, the given number of times
+	void stepTowardsTargetColours(unsigned int steps);
+
+	// Transition timer callback. Step the active colours towards the targets, making up for missed events
+	void transitionEvent(unsigned int missed);
+
+	byte* _active;
+	byte* _target;
+	byte* _frame;
+	uint16_t _numPixels;
+	byte _redOffset;
+	byte _greenOffset;
+	byte _blueOffset;
+
+	PixelTransport& _transport;
+
+	byte _levelTable[256];	// Encoded output of each channel level at the current brightness and curve
+	int _brightness;
+	byte _outputCurve;
+	bool _frameDirty;
+	unsigned long _frameCount;
+	unsigned long _commitTime;	// Duration of the last show() in microseconds
+	unsigned long _maxCommitTime;
+};
+
+/**
+* Scheduler of a pixel strip created without one
+* A base of PixelStripT, so that it is constructed before PixelStrip schedules its events on it.
+*/
+struct PixelStripTimer {
+	SimpleTimer _ownTimer;
+};
+
+/**
+* Pixel strip with storage for a fixed number of pixels
+* RAM use is 9 bytes per pixel (active, target and encoded frame) plus about 300 bytes of state.
+*/
+template <uint16_t NumPixels>
+class PixelStripT : private PixelStripTimer, public PixelStrip
+{
+	static_assert(NumPixels > 0 && NumPixels <= 0xFFFF / 3, "Pixel strips hold 1-21845 pixels");
+
+	public:
+	// Constructor. Timer events are scheduled on a timer of the strip's own
+	PixelStripT(PixelTransport& transport, byte order = PIXEL_GRB)
+		: PixelStrip(_activeStorage, _targetStorage, _frameStorage, NumPixels, transport, _ownTimer, order) {}
+
+	// Constructor. Timer events are scheduled on the given scheduler
+	PixelStripT(PixelTransport& transport, SimpleTimer& timer, byte order = PIXEL_GRB)
+		: PixelStrip(_activeStorage, _targetStorage, _frameStorage, NumPixels, transport, timer, order) {}
+
+	private:
+	byte _activeStorage[NumPixels * 3];
+	byte _targetStorage[NumPixels * 3];
+	byte _frameStorage[NumPixels * 3];
+};
+
+
+#endif /* PIXELSTRIP_H_ */
@@ -0,0 +1,64 @@
+/*
+* PixelTransport.cpp
+*
+* Host transport that records pixel frames. Compiled out on Arduino targets.
+*/
+
+#if !defined(ARDUINO)
+
+#include "PixelTransport.h"
+
+
+RecordingTransport::RecordingTransport() {
+	clear();
+}
+
+/**
+* Record a frame
+* Frames longer than PIXEL_RECORD_BYTES are truncated; getFrameLength() still reports the full length.
+*/
+void RecordingTransport::show(const byte* frame, uint16_t length) {
+	unsigned int slot = _frameCount % PIXEL_RECORD_FRAMES;
+
+	memcpy(_frames[slot], frame, length < PIXEL_RECORD_BYTES ? length : PIXEL_RECORD_BYTES);
+	_lengths[slot] = length;
+	_times[slot] = HostHal::now();
+	_frameCount++;
+}
+
+unsigned long RecordingTransport::getFrameCount() {
+	return _frameCount;
+}
+
+const byte* RecordingTransport::getFrame(unsigned int age) {
+	int slot = slotOf(age);
+	return slot >= 0 ? _frames[slot] : NULL;
+}
+
+uint16_t RecordingTransport::getFrameLength(unsigned int age) {
+	int slot = slotOf(age);
+	return slot >= 0 ? _lengths[slot] : 0;
+}
+
+uint64_t RecordingTransport::getFrameTime(unsigned int age) {
+	int slot = slotOf(age);
+	return slot >= 0 ? _times[slot] : 0;
+}
+
+void RecordingTransport::clear() {
+	_frameCount = 0;
+}
+
+/**
+* Find the slot holding a recorded frame
+* @return Slot index, or -1 if the frame was never recorded or has been overwritten
+*/
+int RecordingTransport::slotOf(unsigned int age) {
+	if (age >= PIXEL_RECORD_FRAMES || age >= _frameCount) {
+		return -1;
+	}
+
+	return (_frameCount - 1 - age) % PIXEL_RECORD_FRAMES;
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+* PixelTransport.h
+*
+* Interface between a PixelStrip and the hardware that sends its frames.
+* A transport receives the encoded frame (brightness and output curve already
+* applied, bytes in the strip's channel order) and pushes it to the LEDs.
+*
+* Wrapping an existing driver takes a few lines, e.g. for Adafruit_NeoPixel:
+*   class NeoPixelTransport : public PixelTransport {
+*       public:
+*       NeoPixelTransport(Adafruit_NeoPixel& pixels) : _pixels(pixels) {}
+*       void show(const byte* frame, uint16_t length) {
+*           memcpy(_pixels.getPixels(), frame, length);
+*           _pixels.show();
+*       }
+*       bool canShow() { return _pixels.canShow(); }
+*       private:
+*       Adafruit_NeoPixel& _pixels;
+*   };
+*/
+
+
+#ifndef PIXELTRANSPORT_H_
+#define PIXELTRANSPORT_H_
+
+#include "RgbHal.h"
+
+class PixelTransport
+{
+	public:
+	virtual ~PixelTransport() {}
+
+	// Send a frame of length bytes, 3 per pixel in the strip's channel order
+	virtual void show(const byte* frame, uint16_t length) = 0;
+
+	// Determine if a new frame can be sent yet, e.g. once the WS2812 latch time has passed
+	virtual bool canShow() { return true; }
+};
+
+
+#if !defined(ARDUINO)
+
+// Number of frames kept by a RecordingTransport
+#define PIXEL_RECORD_FRAMES 8
+
+// Largest frame a RecordingTransport keeps, in bytes (1024 pixels)
+#define PIXEL_RECORD_BYTES 3072
+
+/**
+* Transport that records the frames sent to it, for host builds
+* The last PIXEL_RECORD_FRAMES frames are kept along with the virtual time they were shown at.
+*/
+class RecordingTransport : public PixelTransport
+{
+	public:
+	RecordingTransport();
+
+	void show(const byte* frame, uint16_t length);
+
+	// Total number of frames shown
+	unsigned long getFrameCount();
+
+	// Get a recorded frame. Age 0 is the latest frame; returns NULL if that frame is no longer kept
+	const byte* getFrame(unsigned int age = 0);
+
+	// Length in bytes of a recorded frame
+	uint16_t getFrameLength(unsigned int age = 0);
+
+	// Virtual time in microseconds at which a recorded frame was shown
+	uint64_t getFrameTime(unsigned int age = 0);
+
+	// Forget every recorded frame
+	void clear();
+
+	private:
+	int slotOf(unsigned int age);
+
+	byte _frames[PIXEL_RECORD_FRAMES][PIXEL_RECORD_BYTES];
+	uint16_t _lengths[PIXEL_RECORD_FRAMES];
+	uint64_t _times[PIXEL_RECORD_FRAMES];
+	unsigned long _frameCount;
+};
+
+#endif
+
+
+#endif /* PIXELTRANSPORT_H_ */
@@ -0,0 +1,178 @@
+/*
+* RGB.cpp
+*
+* Colour code lookup table for the built in palette and colour space conversions.
+*/
+
+#include "RGB.h"
+
+const byte COLOUR_CODE_INDEXES[COLOUR_CODE_TABLE_SIZE] PROGMEM = COLOUR_CODE_TABLE(COLOUR_MAP);
+
+static_assert(colourCodeIndex(COLOUR_MAP, 'z') == OFF && colourCodeIndex(COLOUR_MAP, 'p') == PURPLE, "COLOUR_MAP must follow COLOUR_INDEXES");
+
+
+/**
+* Build an RGB colour from the channel levels of one sixth of the colour wheel
+* @param segment Sixth of the colour wheel, 0 (red to yellow) to 5 (magenta to red)
+* @param high Level of the strongest channel
+* @param low Level of the weakest channel
+* @param falling Level of the channel fading out across the segment
+* @param rising Level of the channel fading in across the segment
+*/
+static RGB fromHueSegment(byte segment, byte high, byte low, byte falling, byte rising){
+	RGB rgb;
+	switch (segment){
+		case 0: rgb.r = high; rgb.g = rising; rgb.b = low; break;
+		case 1: rgb.r = falling; rgb.g = high; rgb.b = low; break;
+		case 2: rgb.r = low; rgb.g = high; rgb.b = rising; break;
+		case 3: rgb.r = low; rgb.g = falling; rgb.b = high; break;
+		case 4: rgb.r = rising; rgb.g = low; rgb.b = high; break;
+		default: rgb.r = high; rgb.g = low; rgb.b = falling; break;
+	}
+	return rgb;
+}
+
+
+/**
+* Work out the hue of a colour from its channels
+* @param max Level of the strongest channel
+* @param delta Difference between the strongest and weakest channels; must not be zero
+*/
+static uint16_t hueOf(RGB colour, byte max, byte delta){
+	int16_t offset;
+	int16_t numerator;
+
+	if (max == colour.r){
+		offset = 0;
+		numerator = (int16_t)colour.g - colour.b;
+	} else if (max == colour.g){
+		offset = 2 * HUE_SEGMENT;
+		numerator = (int16_t)colour.b - colour.r;
+	} else {
+		offset = 4 * HUE_SEGMENT;
+		numerator = (int16_t)colour.r - colour.g;
+	}
+
+	// Round to the nearest hue step, away from zero for negative offsets
+	int32_t scaled = (int32_t)numerator * HUE_SEGMENT;
+	int16_t fraction = (scaled >= 0) ? (scaled + delta / 2) / delta : -((-scaled + delta / 2) / delta);
+	return wrapHue(offset + fraction);
+}
+
+
+// Scale of the fixed-point channel levels used by the conversions: 255 levels times 256 hue steps
+#define LEVEL_UNIT 65280UL
+
+/**
+* Round a fixed-point level back to 0-255
+* Multiplying by 257 / 2^24 divides by LEVEL_UNIT to within 0.002% without a division.
+*/
+static inline byte fromLevelUnits(uint32_t level){
+	return (level * 257 + (1UL << 23)) >> 24;
+}
+
+
+/**
+* Convert an HSV colour to RGB
+* Integer only: channel levels are worked out in LEVEL_UNIT fixed point and rounded once, with no
+* division for hues on the colour wheel, so it is cheap enough to run on every transition step.
+* @param colour HSV colour. Hues of HUE_MAX and above wrap around the colour wheel
+* @return RGB colour
+*/
+RGB hsvToRgb(HSV colour){
+	uint16_t hue = colour.h;
+	if (hue >= HUE_MAX){
+		hue %= HUE_MAX;
+	}
+	byte segment = hue >> 8;
+	uint16_t fraction = hue & 0xFF;
+	byte v = colour.v;
+	byte s = colour.s;
+
+	byte low = fromLevelUnits((uint32_t)v * ((uint32_t)(255 - s) << 8));
+	byte falling = fromLevelUnits((uint32_t)v * (LEVEL_UNIT - s * fraction));
+	byte rising = fromLevelUnits((uint32_t)v * (LEVEL_UNIT - s * (256 - fraction)));
+
+	return fromHueSegment(segment, v, low, falling, rising);
+}
+
+
+/**
+* Convert an RGB colour to HSV
+* Uses division, so convert colours when they are set rather than on every update.
+* @param colour RGB colour
+* @return HSV colour; greys have hue and saturation 0
+*/
+HSV rgbToHsv(RGB colour){
+	byte max = colour.r > colour.g ? colour.r : colour.g;
+	max = colour.b > max ? colour.b : max;
+	byte min = colour.r < colour.g ? colour.r : colour.g;
+	min = colour.b < min ? colour.b : min;
+	byte delta = max - min;
+
+	HSV hsv;
+	hsv.v = max;
+	if (delta == 0){
+		hsv.h = 0;
+		hsv.s = 0;
+		return hsv;
+	}
+
+	hsv.s = ((uint16_t)delta * 255 + max / 2) / max;
+	hsv.h = hueOf(colour, max, delta);
+	return hsv;
+}
+
+
+/**
+* Convert an HSL colour to RGB
+* Integer only, no division for hues on the colour wheel.
+* @param colour HSL colour. Hues of HUE_MAX and above wrap around the colour wheel
+* @return RGB colour
+*/
+RGB hslToRgb(HSL colour){
+	uint16_t hue = colour.h;
+	if (hue >= HUE_MAX){
+		hue %= HUE_MAX;
+	}
+	byte segment = hue >> 8;
+	uint16_t fraction = hue & 0xFF;
+
+	// Chroma is largest at mid lightness and falls to zero at black and white
+	uint16_t spread = (colour.l < 128) ? 2 * colour.l : 2 * (255 - colour.l);
+	uint32_t chroma = (uint32_t)spread * colour.s;	// In units of 1/65025
+	uint32_t low = (uint32_t)colour.l * LEVEL_UNIT - chroma * 128;
+	uint32_t high = low + chroma * 256;
+
+	return fromHueSegment(segment, fromLevelUnits(high), fromLevelUnits(low),
+		fromLevelUnits(high - chroma * fraction), fromLevelUnits(low + chroma * fraction));
+}
+
+
+/**
+* Convert an RGB colour to HSL
+* Uses division, so convert colours when they are set rather than on every update.
+* @param colour RGB colour
+* @return HSL colour; greys have hue and saturation 0
+*/
+HSL rgbToHsl(RGB colour){
+	byte max = colour.r > colour.g ? colour.r : colour.g;
+	max = colour.b > max ? colour.b : max;
+	byte min = colour.r < colour.g ? colour.r : colour.g;
+	min = colour.b < min ? colour.b : min;
+	byte delta = max - min;
+	uint16_t sum = (uint16_t)max + min;
+
+	HSL hsl;
+	hsl.l = (sum + 1) >> 1;
+	if (delta == 0){
+		hsl.h = 0;
+		hsl.s = 0;
+		return hsl;
+	}
+
+	uint16_t spread = (sum <= 255) ? sum : 510 - sum;
+	hsl.s = ((uint16_t)delta * 255 + spread / 2) / spread;
+	hsl.h = hueOf(colour, max, delta);
+	return hsl;
+}
@@ -1,7 +1,7 @@
 #ifndef RGB_H__
 #define RGB_H__
 
-#include "Arduino.h"
+#include "RgbHal.h"
 
 /**
 * RGB container
@@ -15,6 +15,101 @@ struct RGB{
 	byte b;
 };
 
+/**
+* Wide RGB container used inside the output pipeline
+* Channels run from 0 to 65535; an 8-bit level c corresponds to c * 257.
+* @param r Red channel intensity
+* @param g Green channel intensity
+* @param b Blue channel intensity
+*/
+struct RGB16{
+	uint16_t r;
+	uint16_t g;
+	uint16_t b;
+};
+
+/**
+* Widen an 8-bit colour to 16 bits per channel
+*/
+inline RGB16 toRGB16(RGB colour){
+	RGB16 wide = {(uint16_t)(colour.r * 257U), (uint16_t)(colour.g * 257U), (uint16_t)(colour.b * 257U)};
+	return wide;
+}
+
+/**
+* Narrow a 16-bit colour to 8 bits per channel
+*/
+inline RGB toRGB(RGB16 colour){
+	RGB narrow = {(byte)(colour.r >> 8), (byte)(colour.g >> 8), (byte)(colour.b >> 8)};
+	return narrow;
+}
+
+/**
+* HSV container
+* Hue runs in HUE_SEGMENT steps per sixth of the colour wheel so conversions need no division.
+* @param h Hue from 0 (red) to HUE_MAX - 1
+* @param s Saturation from 0 (grey) to 255
+* @param v Value from 0 (black) to 255
+*/
+struct HSV{
+	uint16_t h;
+	byte s;
+	byte v;
+};
+
+#define HUE_SEGMENT 256	// Hue steps between primary and secondary colours
+#define HUE_MAX (6 * HUE_SEGMENT)	// Hue steps around the whole colour wheel
+
+/**
+* HSL container
+* @param h Hue from 0 (red) to HUE_MAX - 1, as for HSV
+* @param s Saturation from 0 (grey) to 255
+* @param l Lightness from 0 (black) through 128 (full colour) to 255 (white)
+*/
+struct HSL{
+	uint16_t h;
+	byte s;
+	byte l;
+};
+
+// Convert an HSV colour to RGB. Hues past HUE_MAX wrap around
+RGB hsvToRgb(HSV colour);
+
+// Convert an RGB colour to HSV. Greys get hue 0
+HSV rgbToHsv(RGB colour);
+
+// Convert an HSL colour to RGB. Hues past HUE_MAX wrap around
+RGB hslToRgb(HSL colour);
+
+// Convert an RGB colour to HSL. Greys get hue 0
+HSL rgbToHsl(RGB colour);
+
+/**
+* Signed distance from one hue to another the short way round the colour wheel
+* @return Distance from -HUE_MAX / 2 + 1 to HUE_MAX / 2
+*/
+inline int16_t hueDistance(uint16_t from, uint16_t to){
+	int16_t distance = (int16_t)to - (int16_t)from;
+	if (distance > HUE_MAX / 2){
+		distance -= HUE_MAX;
+	} else if (distance <= -HUE_MAX / 2){
+		distance += HUE_MAX;
+	}
+	return distance;
+}
+
+/**
+* Bring a hue offset by up to one turn back onto the colour wheel, without dividing
+*/
+inline uint16_t wrapHue(int16_t hue){
+	if (hue < 0){
+		return hue + HUE_MAX;
+	} else if (hue >= HUE_MAX){
+		return hue - HUE_MAX;
+	}
+	return hue;
+}
+
 /**
 * Indexes for the COLOURS array.
 * Each array entry is mapped to a worded index  
@@ -51,8 +146,58 @@ const RGB COLOURS[] = {
 
 /**
 * Maps the colours found in the COLOURS RGB array to single char entries  
+* Only used at compile time to build COLOUR_CODE_INDEXES; it takes no memory on the target.
+*/
+constexpr char COLOUR_MAP[] = "zrgbwycmop";
+
+// Number of colours in the COLOURS palette
+const byte NUM_COLOURS = sizeof(COLOUR_MAP) - 1;
+
+static_assert(sizeof(COLOURS) / sizeof(RGB) == NUM_COLOURS, "COLOUR_MAP needs one code per COLOURS entry");
+
+// Palette index returned for characters that are not colour codes
+#define NO_COLOUR 0xFF
+
+// Number of entries in a colour code table; one per 7-bit ASCII character
+#define COLOUR_CODE_TABLE_SIZE 128
+
+/**
+* Find the palette index of a single character colour code at compile time
+* @param codes String of colour codes, one per palette entry
+* @param code Character to look up
+* @return Index of the code in the string, or NO_COLOUR
+*/
+constexpr byte colourCodeIndex(const char* codes, char code, byte index = 0){
+	return (codes[index] == '\0' || code == '\0') ? NO_COLOUR
+		: (codes[index] == code) ? index : colourCodeIndex(codes, code, index + 1);
+}
+
+// Expand colourCodeIndex over consecutive characters
+#define COLOUR_CODES_4(codes, n) colourCodeIndex(codes, n), colourCodeIndex(codes, n + 1), colourCodeIndex(codes, n + 2), colourCodeIndex(codes, n + 3)
+#define COLOUR_CODES_16(codes, n) COLOUR_CODES_4(codes, n), COLOUR_CODES_4(codes, n + 4), COLOUR_CODES_4(codes, n + 8), COLOUR_CODES_4(codes, n + 12)
+#define COLOUR_CODES_64(codes, n) COLOUR_CODES_16(codes, n), COLOUR_CODES_16(codes, n + 16), COLOUR_CODES_16(codes, n + 32), COLOUR_CODES_16(codes, n + 48)
+
+/**
+* Initialiser for a COLOUR_CODE_TABLE_SIZE byte table mapping characters to palette indexes
+* Palettes of your own can be given single character codes the same way as the built in one:
+*   constexpr char MY_CODES[] = "zrgbk";
+*   const byte MY_CODE_TABLE[COLOUR_CODE_TABLE_SIZE] PROGMEM = COLOUR_CODE_TABLE(MY_CODES);
+*   byte index = lookupColourCode(MY_CODE_TABLE, 'k');
+*/
+#define COLOUR_CODE_TABLE(codes) { COLOUR_CODES_64(codes, 0), COLOUR_CODES_64(codes, 64) }
+
+// Palette index of each character code in COLOUR_MAP, in PROGMEM
+extern const byte COLOUR_CODE_INDEXES[COLOUR_CODE_TABLE_SIZE] PROGMEM;
+
+/**
+* Look up a single character colour code
+* @param table Colour code table in PROGMEM, built with COLOUR_CODE_TABLE
+* @param code Character to look up
+* @return Palette index of the code, or NO_COLOUR
 */
-const String COLOUR_MAP = "zrgbwycmop";
+inline byte lookupColourCode(const byte* table, char code){
+	return ((byte)code < COLOUR_CODE_TABLE_SIZE) ? pgm_read_byte(table + (byte)code) : NO_COLOUR;
+}
 
 
 #endif
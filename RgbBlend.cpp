@@ -0,0 +1,180 @@
+/*
+* RgbBlend.cpp
+*
+* Implementations of the batched transition kernel. See RgbBlend.h.
+*/
+
+#include "RgbBlend.h"
+
+// The NEON and ARM DSP versions have not been run against the scalar loop yet (tests/BlendTest.cpp),
+// so ARM targets use SWAR unless RGBBLEND_ARM_SIMD is defined
+#if defined(RGBBLEND_SCALAR) || defined(RGBBLEND_SWAR)
+// Chosen by the build
+#elif defined(__SSE2__)
+#define RGBBLEND_SSE2
+#include <emmintrin.h>
+#elif defined(RGBBLEND_ARM_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define RGBBLEND_NEON
+#include <arm_neon.h>
+#elif defined(RGBBLEND_ARM_SIMD) && defined(__ARM_FEATURE_SIMD32)
+#define RGBBLEND_SIMD32
+#include <arm_acle.h>
+#elif !defined(__AVR__)
+#define RGBBLEND_SWAR
+#endif
+
+
+/**
+* Step a single byte towards its target
+*/
+static inline byte blendByte(byte active, byte target, byte step) {
+	byte up = (active > 255 - step) ? 255 : active + step;
+	byte down = (active < step) ? 0 : active - step;
+	byte limited = (up < target) ? up : target;
+	return (limited > down) ? limited : down;
+}
+
+
+#if defined(RGBBLEND_SWAR)
+
+// High bit of every byte in a word
+#define SWAR_HIGH 0x80808080UL
+
+/**
+* Expand the high bit of each byte into a full byte mask
+*/
+static inline uint32_t swarMask(uint32_t highBits) {
+	return (highBits >> 7) * 0xFF;
+}
+
+static inline uint32_t swarAddSaturate(uint32_t a, uint32_t b) {
+	uint32_t sum = ((a & ~SWAR_HIGH) + (b & ~SWAR_HIGH)) ^ ((a ^ b) & SWAR_HIGH);
+	uint32_t carry = ((a & b) | ((a | b) & ~sum)) & SWAR_HIGH;
+	return sum | swarMask(carry);
+}
+
+// Bytes of a that are below the matching byte of b, as 0x80 flags
+static inline uint32_t swarBorrow(uint32_t a, uint32_t b, uint32_t difference) {
+	return ((~a & b) | (~(a ^ b) & difference)) & SWAR_HIGH;
+}
+
+static inline uint32_t swarSubtract(uint32_t a, uint32_t b) {
+	return ((a | SWAR_HIGH) - (b & ~SWAR_HIGH)) ^ ((a ^ ~b) & SWAR_HIGH);
+}
+
+static inline uint32_t swarSubtractSaturate(uint32_t a, uint32_t b) {
+	uint32_t difference = swarSubtract(a, b);
+	return difference & ~swarMask(swarBorrow(a, b, difference));
+}
+
+static inline uint32_t swarMin(uint32_t a, uint32_t b) {
+	uint32_t less = swarMask(swarBorrow(a, b, swarSubtract(a, b)));
+	return (a & less) | (b & ~less);
+}
+
+static inline uint32_t swarMax(uint32_t a, uint32_t b) {
+	uint32_t less = swarMask(swarBorrow(a, b, swarSubtract(a, b)));
+	return (b & less) | (a & ~less);
+}
+
+#endif
+
+
+/**
+* Step each byte of a buffer towards its target
+* @param active Buffer to update in place
+* @param target Target values, same length as active
+* @param length Number of bytes
+* @param step Largest change to any byte
+* @return True if any byte of active changed
+*/
+bool blendTowards(byte* active, const byte* target, uint16_t length, byte step) {
+	uint16_t i = 0;
+	byte changed = 0;
+
+#if defined(RGBBLEND_SSE2)
+	__m128i steps = _mm_set1_epi8((char) step);
+	__m128i changes = _mm_setzero_si128();
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(active + i));
+		__m128i t = _mm_loadu_si128((const __m128i*)(target + i));
+		__m128i r = _mm_max_epu8(_mm_min_epu8(_mm_adds_epu8(a, steps), t), _mm_subs_epu8(a, steps));
+		changes = _mm_or_si128(changes, _mm_xor_si128(a, r));
+		_mm_storeu_si128((__m128i*)(active + i), r);
+	}
+	changed = _mm_movemask_epi8(_mm_cmpeq_epi8(changes, _mm_setzero_si128())) != 0xFFFF;
+
+#elif defined(RGBBLEND_NEON)
+	uint8x16_t steps = vdupq_n_u8(step);
+	uint8x16_t changes = vdupq_n_u8(0);
+
+	for (; i + 16 <= length; i += 16) {
+		uint8x16_t a = vld1q_u8(active + i);
+		uint8x16_t t = vld1q_u8(target + i);
+		uint8x16_t r = vmaxq_u8(vminq_u8(vqaddq_u8(a, steps), t), vqsubq_u8(a, steps));
+		changes = vorrq_u8(changes, veorq_u8(a, r));
+		vst1q_u8(active + i, r);
+	}
+	uint8x8_t folded = vorr_u8(vget_low_u8(changes), vget_high_u8(changes));
+	changed = vget_lane_u64(vreinterpret_u64_u8(folded), 0) != 0;
+
+#elif defined(RGBBLEND_SIMD32)
+	// Cortex-M4/M7: per-byte saturating arithmetic, with min and max from the GE flags set by __usub8
+	uint32_t steps = step * 0x01010101UL;
+	uint32_t changes = 0;
+
+	for (; i + 4 <= length; i += 4) {
+		uint32_t a, t;
+		memcpy(&a, active + i, 4);
+		memcpy(&t, target + i, 4);
+		uint32_t up = __uqadd8(a, steps);
+		uint32_t down = __uqsub8(a, steps);
+		__usub8(up, t);
+		uint32_t limited = __sel(t, up);
+		__usub8(limited, down);
+		uint32_t r = __sel(limited, down);
+		changes |= a ^ r;
+		memcpy(active + i, &r, 4);
+	}
+	changed = changes != 0;
+
+#elif defined(RGBBLEND_SWAR)
+	uint32_t steps = step * 0x01010101UL;
+	uint32_t changes = 0;
+
+	for (; i + 4 <= length; i += 4) {
+		uint32_t a, t;
+		memcpy(&a, active + i, 4);
+		memcpy(&t, target + i, 4);
+		uint32_t r = swarMax(swarMin(swarAddSaturate(a, steps), t), swarSubtractSaturate(a, steps));
+		changes |= a ^ r;
+		memcpy(active + i, &r, 4);
+	}
+	changed = changes != 0;
+#endif
+
+	// Remaining bytes, or the whole buffer on scalar targets
+	for (; i < length; i++) {
+		byte r = blendByte(active[i], target[i], step);
+		changed |= active[i] ^ r;
+		active[i] = r;
+	}
+
+	return changed != 0;
+}
+
+
+const char* blendImplementation() {
+#if defined(RGBBLEND_SSE2)
+	return "sse2";
+#elif defined(RGBBLEND_NEON)
+	return "neon";
+#elif defined(RGBBLEND_SIMD32)
+	return "simd32";
+#elif defined(RGBBLEND_SWAR)
+	return "swar";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,33 @@
+/*
+* RgbBlend.h
+*
+* Batched transition kernel: moves every byte of an active buffer towards the
+* matching byte of a target buffer by at most a fixed step, in one pass.
+*
+* Each byte becomes max(min(a + s, t), a - s) with saturating add and subtract,
+* which steps towards the target without overshooting and without branches.
+* The kernel picks the widest implementation the target supports:
+*   SSE2 (x86 hosts)                           16 bytes per operation
+*   NEON (ARM hosts, RGBBLEND_ARM_SIMD)        16 bytes per operation
+*   ARM DSP extension (Cortex-M4/M7,
+*     RGBBLEND_ARM_SIMD)                       4 bytes per operation
+*   SWAR on 32-bit words (other 32-bit MCUs,
+*     or RGBBLEND_SWAR defined)                4 bytes per operation
+*   Scalar (AVR, or RGBBLEND_SCALAR defined)   1 byte per operation
+* The ARM versions are opt-in until tests/BlendTest.cpp has passed on ARM hardware or under QEMU.
+*/
+
+
+#ifndef RGBBLEND_H_
+#define RGBBLEND_H_
+
+#include "RgbHal.h"
+
+// Step each byte of active towards target by at most step. Returns true if any byte changed
+bool blendTowards(byte* active, const byte* target, uint16_t length, byte step);
+
+// Name of the implementation selected at compile time ("sse2", "neon", "simd32", "swar" or "scalar")
+const char* blendImplementation();
+
+
+#endif /* RGBBLEND_H_ */
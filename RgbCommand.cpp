@@ -0,0 +1,180 @@
+/*
+* RgbCommand.cpp
+*
+* Stream command parser for RgbStrip. See RgbCommand.h for the command set.
+*/
+
+#include "RgbCommand.h"
+
+
+/**
+* Constructor
+* The parser does nothing until it is attached with RgbStrip::setCommandParser(), or update() is called.
+* @param stream Stream that commands are read from
+* @param strip Strip that commands are applied to
+*/
+RgbCommandParser::RgbCommandParser(Stream& stream, RgbStrip& strip) : _stream(stream), _strip(strip) {
+	_command = 0;
+	_digits = 0;
+	_value = 0;
+	_errorCount = 0;
+}
+
+
+/**
+* Read and apply waiting bytes
+* At most RGBCOMMAND_MAX_BYTES are read per call; anything else stays in the stream for the next
+* call, so the time spent here is bounded however fast bytes arrive.
+*/
+void RgbCommandParser::update() {
+	for (byte i = 0; i < RGBCOMMAND_MAX_BYTES && _stream.available() > 0; i++) {
+		int c = _stream.read();
+		if (c < 0) {
+			break;
+		}
+		parse((char) c);
+	}
+}
+
+
+/**
+* Parse a single byte of input
+* Commands are applied as soon as they are complete. A numeric command is complete when the
+* byte after its last digit arrives, so end the final command of a message with a newline.
+* @param c Next byte of input
+*/
+void RgbCommandParser::parse(char c) {
+	if (_command == '#') {
+		byte nibble;
+		if (c >= '0' && c <= '9') {
+			nibble = c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			nibble = c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			nibble = c - 'A' + 10;
+		} else {
+			// Short hex colour; drop it and treat this byte as a new command
+			_errorCount++;
+			_command = 0;
+			beginCommand(c);
+			return;
+		}
+
+		_value = (_value << 4) | nibble;
+		if (++_digits == 6) {
+			RGB colour;
+			colour.r = _value >> 16;
+			colour.g = _value >> 8;
+			colour.b = _value;
+			_command = 0;
+			_strip.setTargetColour(colour);
+		}
+		return;
+	}
+
+	if (_command != 0) {
+		if (c >= '0' && c <= '9') {
+			_value = _value * 10 + (c - '0');
+			if (_value > RGBCOMMAND_MAX_VALUE) {
+				_value = RGBCOMMAND_MAX_VALUE;
+			}
+			_digits++;
+			return;
+		}
+
+		finishNumber();
+	}
+
+	beginCommand(c);
+}
+
+
+/**
+* Get the number of malformed commands that have been dropped
+* @return Count of unknown bytes, numeric commands without a number, short hex colours and F0
+*/
+unsigned long RgbCommandParser::getErrorCount() {
+	return _errorCount;
+}
+
+
+bool RgbCommandParser::isInputWaiting() {
+	return _stream.available() > 0;
+}
+
+
+/**
+* Start a new command, or apply a colour code straight away
+* @param c First byte of the command
+*/
+void RgbCommandParser::beginCommand(char c) {
+	switch (c) {
+		case ' ':
+		case ',':
+		case ';':
+		case '\r':
+		case '\n':
+			return;
+
+		case '#':
+		case 'B':
+		case 'T':
+		case 'S':
+		case 'F':
+			_command = c;
+			_digits = 0;
+			_value = 0;
+			return;
+
+		default:
+			if (_strip.getColourIndex(c) != NO_COLOUR) {
+				_strip.setTargetColour(c);
+			} else {
+				_errorCount++;
+			}
+			return;
+	}
+}
+
+
+/**
+* Apply the numeric command that has just ended
+*/
+void RgbCommandParser::finishNumber() {
+	char command = _command;
+	_command = 0;
+
+	if (_digits == 0) {
+		_errorCount++;
+		return;
+	}
+
+	switch (command) {
+		case 'B':
+			// Clamp here: values above 32767 would turn negative as an int on AVR and switch the strip off
+			_strip.setBrightness(_value > FULL_BRIGHTNESS ? FULL_BRIGHTNESS : _value);
+			break;
+
+		case 'T':
+			_strip.setTransitionPeriod(_value);
+			break;
+
+		case 'S':
+			if (_value == 0) {
+				_strip.disableStrobe();
+			} else {
+				_strip.setStrobePeriod(_value);
+				_strip.enableStrobe();
+			}
+			break;
+
+		case 'F':
+			// F0 is malformed; RgbStrip::flash() refuses it as well
+			if (_value == 0) {
+				_errorCount++;
+			} else {
+				_strip.flash(_value > RGBCOMMAND_MAX_FLASHES ? RGBCOMMAND_MAX_FLASHES : _value);
+			}
+			break;
+	}
+}
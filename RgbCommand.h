@@ -0,0 +1,79 @@
+/*
+* RgbCommand.h
+*
+* Incremental command parser that controls an RgbStrip from a Stream (e.g. Serial).
+* Bytes are consumed as they arrive, a bounded number per update(), so a slow or
+* chatty sender never stalls transitions. The parser holds no buffers; partial
+* commands are kept as a few bytes of state between calls.
+*
+* Commands:
+*   z r g b w y c m o p    Colour code from COLOUR_MAP (see RGB.h), or from the strip's palette
+*                          (codes that clash with the commands below can't be sent)
+*   #RRGGBB                Hex colour
+*   B<n>                   Brightness in percent, values above 100 give full brightness
+*   T<n>                   Transition period in ms
+*   S<n>                   Strobe period in ms; S0 turns strobing off
+*   F<n>                   Flash n times (1-RGBCOMMAND_MAX_FLASHES)
+* Numbers end at the first non-digit, so commands can be sent back to back
+* ("B50r", "#FF8000F3"). Spaces, commas, semicolons and line endings are ignored
+* between commands. Malformed commands are dropped and counted.
+*
+* Example:
+*   RgbStrip strip(9, 10, 11);
+*   RgbCommandParser commands(Serial, strip);
+*
+*   void setup() { Serial.begin(9600); strip.setCommandParser(&commands); }
+*   void loop() { strip.update(); }
+*/
+
+
+#ifndef RGBCOMMAND_H_
+#define RGBCOMMAND_H_
+
+#include "RgbHal.h"
+#include "RgbStrip.h"
+
+#ifndef RGBCOMMAND_MAX_BYTES
+#define RGBCOMMAND_MAX_BYTES 16	// Most bytes read from the stream per update()
+#endif
+
+#define RGBCOMMAND_MAX_VALUE 65535	// Numbers saturate at this value
+#define RGBCOMMAND_MAX_FLASHES 255	// Largest flash count accepted by F<n>
+
+class RgbCommandParser
+{
+	public:
+	// Constructor. Commands read from the stream are applied to the strip
+	RgbCommandParser(Stream& stream, RgbStrip& strip);
+
+	// Read and apply up to RGBCOMMAND_MAX_BYTES waiting bytes. Called by RgbStrip::update() once attached
+	void update();
+
+	// Parse a single byte, for input that does not come from a Stream
+	void parse(char c);
+
+	// Get the number of malformed commands that were dropped
+	unsigned long getErrorCount();
+
+	// Determine if bytes are waiting to be read from the stream
+	bool isInputWaiting();
+
+	private:
+
+	// Start a new command with the given byte
+	void beginCommand(char c);
+
+	// Apply a numeric command once its number has ended
+	void finishNumber();
+
+	Stream& _stream;
+	RgbStrip& _strip;
+
+	char _command;	// Command being parsed, or 0 between commands
+	byte _digits;	// Digits received for the current command
+	uint32_t _value;
+	unsigned long _errorCount;
+};
+
+
+#endif /* RGBCOMMAND_H_ */
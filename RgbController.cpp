@@ -0,0 +1,149 @@
+/*
+* RgbController.cpp
+*
+* Thread-safe strip front end. See RgbController.h.
+* Compiled out on AVR, where the controller isn't available.
+*/
+
+#if !defined(__AVR__)
+
+#include "RgbController.h"
+
+
+/**
+* Constructor
+* @param strip Strip to control. Only the thread calling update() may use it from now on
+*/
+RgbStripController::RgbStripController(RgbStrip& strip) : _strip(strip) {
+	_droppedCount = 0;
+	_appliedCount = 0;
+}
+
+
+bool RgbStripController::setTargetColour(RGB colour) {
+	StripCommand command;
+	command.type = STRIP_TARGET_COLOUR;
+	command.colour = colour;
+	command.value = 0;
+	return send(command);
+}
+
+
+bool RgbStripController::setBrightness(int percentage) {
+	return send(STRIP_BRIGHTNESS, percentage);
+}
+
+
+/**
+* Queue a flash
+* @param numFlashes The amount of times the lights will flash
+* @return True if the flash was queued; false if numFlashes is not positive or the queue was full
+*/
+bool RgbStripController::flash(int numFlashes) {
+	if (numFlashes <= 0) {
+		return false;
+	}
+
+	return send(STRIP_FLASH, numFlashes);
+}
+
+
+bool RgbStripController::enableTransitions() {
+	return send(STRIP_TRANSITIONS, 1);
+}
+
+
+bool RgbStripController::disableTransitions() {
+	return send(STRIP_TRANSITIONS, 0);
+}
+
+
+bool RgbStripController::enableStrobe() {
+	return send(STRIP_STROBE, 1);
+}
+
+
+bool RgbStripController::disableStrobe() {
+	return send(STRIP_STROBE, 0);
+}
+
+
+bool RgbStripController::setTransitionPeriod(long period) {
+	return send(STRIP_TRANSITION_PERIOD, period);
+}
+
+
+bool RgbStripController::setStrobePeriod(long period) {
+	return send(STRIP_STROBE_PERIOD, period);
+}
+
+
+/**
+* Queue a command for the next update
+* Commands from one thread are applied in the order they were sent; commands from different
+* threads are applied in the order they claimed a place in the queue.
+* @param command Command to apply to the strip
+* @return True if the command was queued; false if the queue was full and the command was dropped
+*/
+bool RgbStripController::send(const StripCommand& command) {
+	if (!_queue.push(command)) {
+		__atomic_fetch_add(&_droppedCount, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	return true;
+}
+
+
+bool RgbStripController::send(byte type, long value) {
+	StripCommand command;
+	command.type = type;
+	command.colour = COLOURS[OFF];
+	command.value = value;
+	return send(command);
+}
+
+
+unsigned long RgbStripController::getDroppedCount() {
+	return __atomic_load_n(&_droppedCount, __ATOMIC_RELAXED);
+}
+
+
+/**
+* Apply queued commands, then update the strip
+* At most RGBCONTROLLER_QUEUE_SIZE commands are applied per update, so producers that keep
+* sending can't starve the strip's timer events.
+*/
+void RgbStripController::update() {
+	StripCommand command;
+
+	for (unsigned int i = 0; i < RGBCONTROLLER_QUEUE_SIZE && _queue.pop(command); i++) {
+		applyStripCommand(_strip, command);
+		_appliedCount++;
+	}
+
+	_strip.update();
+}
+
+
+/**
+* Get how long the render thread can sleep
+* Commands sent while it sleeps wait until it wakes, and nothing wakes it early, so the time is
+* capped at RGBCONTROLLER_MAX_SLEEP even when the strip has nothing scheduled.
+* @return Time in ms until the next event, up to RGBCONTROLLER_MAX_SLEEP, or 0 if commands are waiting
+*/
+unsigned long RgbStripController::msUntilNextEvent() {
+	if (!_queue.isEmpty()) {
+		return 0;
+	}
+
+	unsigned long ms = _strip.msUntilNextEvent();
+	return (ms < RGBCONTROLLER_MAX_SLEEP) ? ms : RGBCONTROLLER_MAX_SLEEP;
+}
+
+
+unsigned long RgbStripController::getAppliedCount() {
+	return _appliedCount;
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+* RgbController.h
+*
+* Thread-safe front end for a strip on multi-core hosts. Any number of threads
+* (e.g. network handlers) queue commands without locks; the thread that renders
+* the strip applies them in a batch at the start of each update().
+*
+* Only the render thread touches the strip and its SimpleTimer, so the strip
+* itself needs no synchronization. Other threads must use the controller, not
+* the strip.
+*
+* The queue needs 32-bit atomics, so the controller is not available on AVR;
+* call the strip from loop() there, with RgbIsrDriver (RgbIsr.h) to latch its
+* output from a timer interrupt if needed.
+*
+* Example:
+*   SimpleTimer timer;
+*   RgbStrip strip(3, 5, 6, timer);
+*   RgbStripController controller(strip);
+*
+*   // network thread
+*   controller.setTargetColour(colour);
+*
+*   // render thread
+*   for (;;) { controller.update(); HostHal::idle(controller.msUntilNextEvent()); }
+*/
+
+
+#ifndef RGBCONTROLLER_H_
+#define RGBCONTROLLER_H_
+
+#include "RgbHal.h"
+#include "RgbStrip.h"
+#include "RgbQueue.h"
+
+#if defined(__AVR__)
+#error "RgbStripController needs 32-bit atomics, which AVR doesn't have; call the strip from loop() instead"
+#endif
+
+#ifndef RGBCONTROLLER_QUEUE_SIZE
+#define RGBCONTROLLER_QUEUE_SIZE 64	// Commands that can wait between updates. Power of two
+#endif
+
+#ifndef RGBCONTROLLER_MAX_SLEEP
+#define RGBCONTROLLER_MAX_SLEEP 10	// Longest time msUntilNextEvent() returns in ms, bounding the latency of commands sent during a sleep
+#endif
+
+class RgbStripController
+{
+	public:
+	// Constructor. The strip is updated through the controller from now on
+	RgbStripController(RgbStrip& strip);
+
+	// Queue commands for the strip (any thread). Each returns false, and counts a drop, if the queue is full.
+	// flash() also returns false, without queueing anything, for counts that are not positive
+	bool setTargetColour(RGB colour);
+	bool setBrightness(int percentage);
+	bool flash(int numFlashes);
+	bool enableTransitions();
+	bool disableTransitions();
+	bool enableStrobe();
+	bool disableStrobe();
+	bool setTransitionPeriod(long period);
+	bool setStrobePeriod(long period);
+
+	// Queue any command (any thread). Returns false if the queue is full
+	bool send(const StripCommand& command);
+
+	// Get the number of commands refused because the queue was full (any thread)
+	unsigned long getDroppedCount();
+
+	// Apply queued commands, then update the strip (render thread only)
+	void update();
+
+	// Time until the strip next has work to do, as RgbStrip::msUntilNextEvent() capped at RGBCONTROLLER_MAX_SLEEP, or 0 if commands are waiting (render thread only)
+	unsigned long msUntilNextEvent();
+
+	// Get the number of commands applied (render thread only)
+	unsigned long getAppliedCount();
+
+	private:
+	RgbStripController(const RgbStripController&);
+	RgbStripController& operator=(const RgbStripController&);
+
+	// Queue a command with a value
+	bool send(byte type, long value);
+
+	RgbStrip& _strip;
+	StripCommandMpscQueue<RGBCONTROLLER_QUEUE_SIZE> _queue;
+	unsigned long _droppedCount;	// Updated atomically by producers
+	unsigned long _appliedCount;	// Render thread only
+};
+
+
+#endif /* RGBCONTROLLER_H_ */
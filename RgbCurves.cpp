@@ -0,0 +1,22 @@
+/*
+* RgbCurves.cpp
+*
+* Compile-time generated output curve tables.
+*/
+
+#include "RgbCurves.h"
+
+// Expand a generator over 257 consecutive points
+#define CURVE_4(f, n) f(n), f(n + 1), f(n + 2), f(n + 3)
+#define CURVE_16(f, n) CURVE_4(f, n), CURVE_4(f, n + 4), CURVE_4(f, n + 8), CURVE_4(f, n + 12)
+#define CURVE_64(f, n) CURVE_16(f, n), CURVE_16(f, n + 16), CURVE_16(f, n + 32), CURVE_16(f, n + 48)
+#define CURVE_257(f) CURVE_64(f, 0), CURVE_64(f, 64), CURVE_64(f, 128), CURVE_64(f, 192), f(256)
+
+// Every entry is a constant expression, so the tables are constant-initialised
+// and never computed at run time
+const uint16_t OUTPUT_CURVE_TABLES[NUM_OUTPUT_CURVES - 1][CURVE_POINTS] PROGMEM = {
+	{ CURVE_257(gammaPoint) },
+	{ CURVE_257(ciePoint) }
+};
+
+static_assert(gammaPoint(256) == 65535 && ciePoint(256) == 65535, "Output curves must map full scale to full scale");
@@ -0,0 +1,129 @@
+/*
+* RgbCurves.h
+*
+* Output curves applied to each colour channel just before it is written.
+* The tables are generated at compile time from the constexpr functions
+* below and stored in program memory. Each table holds 257 16-bit points
+* spaced 256 input levels apart; applying a curve costs two table reads and
+* a linear interpolation per channel.
+*/
+
+
+#ifndef RGBCURVES_H_
+#define RGBCURVES_H_
+
+#include "RgbHal.h"
+
+// Exponent used by CURVE_GAMMA
+#ifndef RGBSTRIP_GAMMA
+#define RGBSTRIP_GAMMA 2.2
+#endif
+
+/**
+* Output curves available to RgbStrip::setOutputCurve()
+*/
+enum OUTPUT_CURVES{
+	CURVE_LINEAR = 0,	// Levels are written unchanged (no table)
+	CURVE_GAMMA = 1,	// Power law with exponent RGBSTRIP_GAMMA
+	CURVE_CIE_LIGHTNESS = 2,	// CIE 1976 L* to luminance
+	NUM_OUTPUT_CURVES = 3
+};
+
+// Number of points in each curve table
+#define CURVE_POINTS 257
+
+/**
+* Curve tables, indexed by [curve - 1][input level / 256]. Stored in PROGMEM.
+* CURVE_LINEAR has no table; it is applied by skipping the curve stage.
+*/
+extern const uint16_t OUTPUT_CURVE_TABLES[NUM_OUTPUT_CURVES - 1][CURVE_POINTS] PROGMEM;
+
+/**
+* Map a 16-bit level through a curve table
+* Curves are monotonic, so the step between neighbouring points is never negative.
+* The fraction is stretched from 0-255 to 0-256 so that full scale maps exactly onto the last point.
+* @param table Row of OUTPUT_CURVE_TABLES
+* @param level Input level from 0 to 65535
+* @return Output level from 0 to 65535
+*/
+inline uint16_t applyOutputCurve(const uint16_t* table, uint16_t level){
+	byte index = level >> 8;
+	uint16_t fraction = level & 0xFF;
+	uint16_t low = pgm_read_word(table + index);
+	uint16_t high = pgm_read_word(table + index + 1);
+
+	fraction += fraction >> 7;
+	return low + (uint16_t)(((uint32_t)(high - low) * fraction) >> 8);
+}
+
+
+namespace RgbCurveMath {
+	// ln(2)
+	constexpr double LN_2 = 0.69314718055994531;
+
+	// Sum of y^(2n+1) / (2n+1) for n up to 20: atanh(y) for |y| <= 1/3
+	constexpr double atanhSeries(double power, double y2, int n) {
+		return n > 20 ? 0.0 : power / (2 * n + 1) + atanhSeries(power * y2, y2, n + 1);
+	}
+
+	// Natural log of m in [0.5, 1], using ln(m) = 2 atanh((m - 1) / (m + 1))
+	constexpr double lnReduced(double y) {
+		return 2.0 * atanhSeries(y, y * y, 0);
+	}
+
+	// Natural log of x in (0, 1], halving the range down to [0.5, 1]
+	constexpr double ln(double x, int octaves = 0) {
+		return x < 0.5 ? ln(x * 2.0, octaves + 1) : lnReduced((x - 1.0) / (x + 1.0)) - octaves * LN_2;
+	}
+
+	// Taylor series of exp(z) for |z| <= 1/4
+	constexpr double expSeries(double z, double term, int n) {
+		return n > 14 ? 0.0 : term + expSeries(z, term * z / (n + 1), n + 1);
+	}
+
+	constexpr double square(double v) {
+		return v * v;
+	}
+
+	// exp(z * 2^squarings), evaluated as exp(z) squared repeatedly
+	constexpr double expSquared(double z, int squarings) {
+		return squarings == 0 ? expSeries(z, 1.0, 0) : square(expSquared(z, squarings - 1));
+	}
+
+	// exp(z) for -16 <= z <= 0. Few squarings keep rounding error low on 32-bit double targets (AVR)
+	constexpr double exp(double z) {
+		return expSquared(z / 64.0, 6);
+	}
+
+	// x^e for x in [0, 1]
+	constexpr double pow(double x, double e) {
+		return x <= 0.0 ? 0.0 : exp(e * ln(x));
+	}
+
+	// Relative luminance of CIE L* (x = L* / 100)
+	constexpr double cieLuminance(double x) {
+		return x <= 0.08 ? x * 100.0 / 903.3 : square((x * 100.0 + 16.0) / 116.0) * ((x * 100.0 + 16.0) / 116.0);
+	}
+
+	// Input of table point n as a [0, 1] value
+	constexpr double pointInput(int point) {
+		return point >= 256 ? 1.0 : point / 256.0;
+	}
+
+	// Scale a [0, 1] value to a 16-bit level
+	constexpr uint16_t toLevel(double v) {
+		return (uint16_t)(v * 65535.0 + 0.5);
+	}
+}
+
+// Table point generators for each curve
+constexpr uint16_t gammaPoint(int point) {
+	return RgbCurveMath::toLevel(RgbCurveMath::pow(RgbCurveMath::pointInput(point), RGBSTRIP_GAMMA));
+}
+
+constexpr uint16_t ciePoint(int point) {
+	return RgbCurveMath::toLevel(RgbCurveMath::cieLuminance(RgbCurveMath::pointInput(point)));
+}
+
+
+#endif /* RGBCURVES_H_ */
@@ -0,0 +1,129 @@
+/*
+* RgbEasing.cpp
+*
+* Fixed-point easing functions.
+*/
+
+#include "RgbEasing.h"
+
+// Expand a generator over 65 consecutive points
+#define EASING_4(f, n) f(n), f(n + 1), f(n + 2), f(n + 3)
+#define EASING_16(f, n) EASING_4(f, n), EASING_4(f, n + 4), EASING_4(f, n + 8), EASING_4(f, n + 12)
+#define EASING_65(f) EASING_16(f, 0), EASING_16(f, 16), EASING_16(f, 32), EASING_16(f, 48), f(64)
+
+// Ease-in curves that have no cheap integer form; out and in-out variants are derived from them
+static const uint16_t IN_SINE_TABLE[65] PROGMEM = { EASING_65(inSinePoint) };
+static const uint16_t IN_EXPO_TABLE[65] PROGMEM = { EASING_65(inExpoPoint) };
+
+static_assert(inSinePoint(64) == EASING_ONE && inExpoPoint(64) == EASING_ONE, "Easing curves must end at full progress");
+
+
+/**
+* Interpolate a 65-point easing table
+* @param table Easing table in PROGMEM
+* @param progress Fade progress from 0 to 32768
+*/
+static uint16_t easeFromTable(const uint16_t* table, uint16_t progress) {
+	if (progress >= EASING_ONE) {
+		return EASING_ONE;
+	}
+
+	byte index = progress >> 9;
+	uint16_t fraction = progress & 0x1FF;
+	uint16_t low = pgm_read_word(table + index);
+	uint16_t high = pgm_read_word(table + index + 1);
+
+	return low + (uint16_t)(((uint32_t)(high - low) * fraction) >> 9);
+}
+
+/**
+* Mirror an ease-in curve into an ease-out curve
+*/
+template <uint16_t (*easeIn)(uint16_t)>
+static uint16_t easeOutOf(uint16_t progress) {
+	return EASING_ONE - easeIn(EASING_ONE - progress);
+}
+
+/**
+* Join an ease-in curve and its mirror into an ease-in-out curve
+*/
+template <uint16_t (*easeIn)(uint16_t)>
+static uint16_t easeInOutOf(uint16_t progress) {
+	if (progress < EASING_ONE / 2) {
+		return easeIn(progress * 2) / 2;
+	}
+
+	return EASING_ONE - easeIn((uint16_t)(2 * EASING_ONE - 2UL * progress)) / 2;
+}
+
+
+uint16_t easeLinear(uint16_t progress) {
+	return progress;
+}
+
+uint16_t easeInQuad(uint16_t progress) {
+	return ((uint32_t)progress * progress) >> 15;
+}
+
+uint16_t easeOutQuad(uint16_t progress) {
+	return easeOutOf<easeInQuad>(progress);
+}
+
+uint16_t easeInOutQuad(uint16_t progress) {
+	return easeInOutOf<easeInQuad>(progress);
+}
+
+uint16_t easeInCubic(uint16_t progress) {
+	return ((uint32_t)easeInQuad(progress) * progress) >> 15;
+}
+
+uint16_t easeOutCubic(uint16_t progress) {
+	return easeOutOf<easeInCubic>(progress);
+}
+
+uint16_t easeInOutCubic(uint16_t progress) {
+	return easeInOutOf<easeInCubic>(progress);
+}
+
+uint16_t easeInSine(uint16_t progress) {
+	return easeFromTable(IN_SINE_TABLE, progress);
+}
+
+uint16_t easeOutSine(uint16_t progress) {
+	return easeOutOf<easeInSine>(progress);
+}
+
+uint16_t easeInOutSine(uint16_t progress) {
+	return easeInOutOf<easeInSine>(progress);
+}
+
+uint16_t easeInExpo(uint16_t progress) {
+	return easeFromTable(IN_EXPO_TABLE, progress);
+}
+
+uint16_t easeOutExpo(uint16_t progress) {
+	return easeOutOf<easeInExpo>(progress);
+}
+
+uint16_t easeInOutExpo(uint16_t progress) {
+	return easeInOutOf<easeInExpo>(progress);
+}
+
+
+easing_function getEasingFunction(byte curve) {
+	switch (curve) {
+		case EASE_IN_QUAD: return easeInQuad;
+		case EASE_OUT_QUAD: return easeOutQuad;
+		case EASE_IN_OUT_QUAD: return easeInOutQuad;
+		case EASE_IN_CUBIC: return easeInCubic;
+		case EASE_OUT_CUBIC: return easeOutCubic;
+		case EASE_IN_OUT_CUBIC: return easeInOutCubic;
+		case EASE_IN_SINE: return easeInSine;
+		case EASE_OUT_SINE: return easeOutSine;
+		case EASE_IN_OUT_SINE: return easeInOutSine;
+		case EASE_IN_EXPO: return easeInExpo;
+		case EASE_OUT_EXPO: return easeOutExpo;
+		case EASE_IN_OUT_EXPO: return easeInOutExpo;
+		default: return easeLinear;
+	}
+}
@@ -0,0 +1,96 @@
+/*
+* RgbEasing.h
+*
+* Easing curves for timed fades.
+* An easing function maps fade progress onto colour progress. Both are
+* fractions of 32768 (0 = start, 32768 = end). Polynomial curves are
+* evaluated with integer multiplies; sine and exponential curves are read
+* from 65-point PROGMEM tables generated at compile time and interpolated.
+* No floating point is used at run time.
+*/
+
+
+#ifndef RGBEASING_H_
+#define RGBEASING_H_
+
+#include "RgbHal.h"
+#include "RgbCurves.h"
+
+// Progress value at the end of a fade
+#define EASING_ONE 32768U
+
+typedef uint16_t (*easing_function)(uint16_t progress);
+
+/**
+* Built-in easing curves, for use where a curve has to be stored as a number (e.g. PROGMEM sequences)
+*/
+enum EASING_CURVES{
+	EASE_LINEAR = 0,
+	EASE_IN_QUAD = 1,
+	EASE_OUT_QUAD = 2,
+	EASE_IN_OUT_QUAD = 3,
+	EASE_IN_CUBIC = 4,
+	EASE_OUT_CUBIC = 5,
+	EASE_IN_OUT_CUBIC = 6,
+	EASE_IN_SINE = 7,
+	EASE_OUT_SINE = 8,
+	EASE_IN_OUT_SINE = 9,
+	EASE_IN_EXPO = 10,
+	EASE_OUT_EXPO = 11,
+	EASE_IN_OUT_EXPO = 12,
+	NUM_EASING_CURVES = 13
+};
+
+// Easing functions
+uint16_t easeLinear(uint16_t progress);
+uint16_t easeInQuad(uint16_t progress);
+uint16_t easeOutQuad(uint16_t progress);
+uint16_t easeInOutQuad(uint16_t progress);
+uint16_t easeInCubic(uint16_t progress);
+uint16_t easeOutCubic(uint16_t progress);
+uint16_t easeInOutCubic(uint16_t progress);
+uint16_t easeInSine(uint16_t progress);
+uint16_t easeOutSine(uint16_t progress);
+uint16_t easeInOutSine(uint16_t progress);
+uint16_t easeInExpo(uint16_t progress);
+uint16_t easeOutExpo(uint16_t progress);
+uint16_t easeInOutExpo(uint16_t progress);
+
+// Get the function for one of EASING_CURVES. Unknown curves give easeLinear
+easing_function getEasingFunction(byte curve);
+
+
+namespace RgbEasingMath {
+	constexpr double PI_VALUE = 3.14159265358979324;
+
+	// Taylor series of cos(x) for 0 <= x <= pi
+	constexpr double cosSeries(double x2, double term, int n) {
+		return n > 12 ? 0.0 : term + cosSeries(x2, -term * x2 / ((2 * n + 1) * (2 * n + 2)), n + 1);
+	}
+
+	constexpr double cos(double x) {
+		return cosSeries(x * x, 1.0, 0);
+	}
+
+	// Input of table point n as a [0, 1] value
+	constexpr double pointInput(int point) {
+		return point / 64.0;
+	}
+
+	// Scale a [0, 1] value to a fraction of 32768
+	constexpr uint16_t toProgress(double v) {
+		return (uint16_t)(v * 32768.0 + 0.5);
+	}
+}
+
+// Table point generators
+constexpr uint16_t inSinePoint(int point) {
+	return RgbEasingMath::toProgress(1.0 - RgbEasingMath::cos(RgbEasingMath::pointInput(point) * RgbEasingMath::PI_VALUE / 2.0));
+}
+
+constexpr uint16_t inExpoPoint(int point) {
+	return point == 0 ? 0 : RgbEasingMath::toProgress(RgbCurveMath::exp(10.0 * (RgbEasingMath::pointInput(point) - 1.0) * RgbCurveMath::LN_2));
+}
+
+
+#endif /* RGBEASING_H_ */
@@ -0,0 +1,323 @@
+/*
+* RgbEffect.cpp
+*
+* Decoder and encoder for the packed effect format described in RgbEffect.h.
+*/
+
+#include "RgbEffect.h"
+
+#if !defined(ARDUINO)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+// Decoding
+
+/**
+* Read one byte of effect data
+* @return False if the end of the data has been reached
+*/
+static bool readByte(EffectReader& reader, byte& value) {
+	if (reader.position >= reader.end) {
+		return false;
+	}
+
+	value = reader.progmem ? pgm_read_byte(reader.position) : *reader.position;
+	reader.position++;
+	return true;
+}
+
+/**
+* Read an unsigned LEB128 varint of up to 32 bits
+*/
+static bool readVarint(EffectReader& reader, uint32_t& value) {
+	byte b;
+	value = 0;
+
+	for (byte shift = 0; shift < 32; shift += 7) {
+		if (!readByte(reader, b)) {
+			return false;
+		}
+
+		value |= (uint32_t)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+* Read a zigzag encoded channel delta and apply it to a channel
+*/
+static bool readChannel(EffectReader& reader, byte& channel) {
+	uint32_t zigzag;
+	if (!readVarint(reader, zigzag)) {
+		return false;
+	}
+
+	int delta = (zigzag & 1) ? -(int)((zigzag + 1) >> 1) : (int)(zigzag >> 1);
+	channel = (byte)(channel + delta);
+	return true;
+}
+
+static bool readTime(EffectReader& reader, uint16_t& time) {
+	uint32_t value;
+	if (!readVarint(reader, value)) {
+		return false;
+	}
+
+	time = (value > 0xFFFF) ? 0xFFFF : value;
+	return true;
+}
+
+/**
+* Check the header of an effect and set the reader up at its first cue
+* @param reader Reader to set up
+* @param data Start of the effect
+* @param length Length of the effect in bytes
+* @param progmem True if the effect is stored in PROGMEM
+* @return True if the data starts with a valid header
+*/
+bool effectBegin(EffectReader& reader, const byte* data, size_t length, bool progmem) {
+	byte magic0, magic1, version;
+	uint32_t numCues;
+
+	reader.position = data;
+	reader.end = data + length;
+	reader.progmem = progmem;
+
+	if (!readByte(reader, magic0) || !readByte(reader, magic1) || !readByte(reader, version)) {
+		return false;
+	}
+	if (magic0 != EFFECT_MAGIC_0 || magic1 != EFFECT_MAGIC_1 || version != EFFECT_VERSION) {
+		return false;
+	}
+	if (!readVarint(reader, numCues) || numCues > 0xFFFF) {
+		return false;
+	}
+
+	reader.data = reader.position;
+	reader.numCues = numCues;
+	effectRewind(reader);
+	return true;
+}
+
+/**
+* Move the reader back to the first cue and reset the decoding state
+*/
+void effectRewind(EffectReader& reader) {
+	reader.position = reader.data;
+	reader.cuesLeft = reader.numCues;
+
+	reader.cue.colour.r = 0;
+	reader.cue.colour.g = 0;
+	reader.cue.colour.b = 0;
+	reader.cue.brightness = 100;
+	reader.cue.easing = 0;
+	reader.cue.fadeTime = 0;
+	reader.cue.holdTime = 0;
+}
+
+/**
+* Decode the next cue of an effect
+* @param reader Reader positioned at the cue
+* @param cue Filled with the decoded cue
+* @return True if a cue was decoded; false at the end of the effect or on truncated data
+*/
+bool effectNextCue(EffectReader& reader, Keyframe& cue) {
+	byte control;
+
+	if (reader.cuesLeft == 0 || !readByte(reader, control)) {
+		return false;
+	}
+
+	Keyframe next = reader.cue;
+	bool ok = true;
+
+	if (control & EFFECT_RED) {
+		ok = ok && readChannel(reader, next.colour.r);
+	}
+	if (control & EFFECT_GREEN) {
+		ok = ok && readChannel(reader, next.colour.g);
+	}
+	if (control & EFFECT_BLUE) {
+		ok = ok && readChannel(reader, next.colour.b);
+	}
+	if (control & EFFECT_BRIGHTNESS) {
+		ok = ok && readByte(reader, next.brightness);
+	}
+	if (control & EFFECT_EASING) {
+		ok = ok && readByte(reader, next.easing);
+	}
+	if (control & EFFECT_FADE) {
+		ok = ok && readTime(reader, next.fadeTime);
+	}
+	if (control & EFFECT_HOLD) {
+		ok = ok && readTime(reader, next.holdTime);
+	}
+
+	if (!ok) {
+		reader.cuesLeft = 0;
+		return false;
+	}
+
+	reader.cue = next;
+	reader.cuesLeft--;
+	cue = next;
+	return true;
+}
+
+
+// Encoding
+
+static size_t writeVarint(byte* buffer, uint32_t value) {
+	size_t length = 0;
+
+	do {
+		byte b = value & 0x7F;
+		value >>= 7;
+		buffer[length++] = value ? (b | 0x80) : b;
+	} while (value);
+
+	return length;
+}
+
+static size_t writeChannelDelta(byte* buffer, byte previous, byte current) {
+	int delta = (int)current - previous;
+	uint32_t zigzag = (delta < 0) ? ((uint32_t)(-delta) << 1) - 1 : (uint32_t)delta << 1;
+	return writeVarint(buffer, zigzag);
+}
+
+/**
+* Encode a list of cues
+* Each cue only stores the fields that differ from the previous one.
+* @param cues Cues to encode (in RAM)
+* @param numCues Number of cues
+* @param buffer Output buffer
+* @param capacity Size of the output buffer in bytes
+* @return Number of bytes written, or 0 if the buffer is too small
+*/
+size_t encodeEffect(const Keyframe* cues, uint16_t numCues, byte* buffer, size_t capacity) {
+	byte scratch[EFFECT_MAX_CUE_SIZE];
+	size_t length = 0;
+
+	if (capacity < 3 + 3) {
+		return 0;
+	}
+
+	buffer[length++] = EFFECT_MAGIC_0;
+	buffer[length++] = EFFECT_MAGIC_1;
+	buffer[length++] = EFFECT_VERSION;
+	length += writeVarint(buffer + length, numCues);
+
+	Keyframe previous;
+	previous.colour.r = 0;
+	previous.colour.g = 0;
+	previous.colour.b = 0;
+	previous.brightness = 100;
+	previous.easing = 0;
+	previous.fadeTime = 0;
+	previous.holdTime = 0;
+
+	for (uint16_t i = 0; i < numCues; i++) {
+		const Keyframe& cue = cues[i];
+		byte control = 0;
+		size_t cueLength = 1;
+
+		if (cue.colour.r != previous.colour.r) {
+			control |= EFFECT_RED;
+			cueLength += writeChannelDelta(scratch + cueLength, previous.colour.r, cue.colour.r);
+		}
+		if (cue.colour.g != previous.colour.g) {
+			control |= EFFECT_GREEN;
+			cueLength += writeChannelDelta(scratch + cueLength, previous.colour.g, cue.colour.g);
+		}
+		if (cue.colour.b != previous.colour.b) {
+			control |= EFFECT_BLUE;
+			cueLength += writeChannelDelta(scratch + cueLength, previous.colour.b, cue.colour.b);
+		}
+		if (cue.brightness != previous.brightness) {
+			control |= EFFECT_BRIGHTNESS;
+			scratch[cueLength++] = cue.brightness;
+		}
+		if (cue.easing != previous.easing) {
+			control |= EFFECT_EASING;
+			scratch[cueLength++] = cue.easing;
+		}
+		if (cue.fadeTime != previous.fadeTime) {
+			control |= EFFECT_FADE;
+			cueLength += writeVarint(scratch + cueLength, cue.fadeTime);
+		}
+		if (cue.holdTime != previous.holdTime) {
+			control |= EFFECT_HOLD;
+			cueLength += writeVarint(scratch + cueLength, cue.holdTime);
+		}
+		scratch[0] = control;
+
+		if (length + cueLength > capacity) {
+			return 0;
+		}
+		memcpy(buffer + length, scratch, cueLength);
+		length += cueLength;
+		previous = cue;
+	}
+
+	return length;
+}
+
+
+#if !defined(ARDUINO)
+
+// Memory-mapped effect files
+
+EffectFile::EffectFile() : _data(NULL), _length(0) {
+}
+
+EffectFile::~EffectFile() {
+	close();
+}
+
+/**
+* Map an effect file into memory, read-only
+* @param path Path of the file
+* @return True if the file was mapped
+*/
+bool EffectFile::open(const char* path) {
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+
+	_data = (const byte*) mapping;
+	_length = info.st_size;
+	return true;
+}
+
+void EffectFile::close() {
+	if (_data != NULL) {
+		munmap((void*) _data, _length);
+		_data = NULL;
+		_length = 0;
+	}
+}
+
+#endif
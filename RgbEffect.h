@@ -0,0 +1,102 @@
+/*
+* RgbEffect.h
+*
+* Packed binary effect format for long cue lists.
+* Effects are decoded one cue at a time straight from where they are stored
+* (PROGMEM on AVR, RAM or a memory-mapped file on a host), so shows of
+* thousands of cues never need to fit in SRAM.
+*
+* Format (all multi-byte numbers are unsigned LEB128 varints):
+*   Header:  'R' 'F' version(1) varint(number of cues)
+*   Cue:     control byte, then the fields flagged in it, in this order:
+*              EFFECT_RED / EFFECT_GREEN / EFFECT_BLUE  zigzag varint channel delta
+*              EFFECT_BRIGHTNESS                        brightness byte (percent)
+*              EFFECT_EASING                            easing byte (EASING_CURVES)
+*              EFFECT_FADE                              varint fade time in ms
+*              EFFECT_HOLD                              varint hold time in ms
+*            Fields that are not flagged keep their value from the previous cue.
+*            Decoding starts from black, 100% brightness, linear easing and zero times.
+*/
+
+
+#ifndef RGBEFFECT_H_
+#define RGBEFFECT_H_
+
+#include "RgbHal.h"
+#include "RgbSequence.h"
+
+#define EFFECT_MAGIC_0 'R'
+#define EFFECT_MAGIC_1 'F'
+#define EFFECT_VERSION 1
+
+// Cue control byte flags
+#define EFFECT_RED 0x01
+#define EFFECT_GREEN 0x02
+#define EFFECT_BLUE 0x04
+#define EFFECT_BRIGHTNESS 0x08
+#define EFFECT_EASING 0x10
+#define EFFECT_FADE 0x20
+#define EFFECT_HOLD 0x40
+
+// Largest encoding of a single cue: control byte, 3 x 2-byte deltas, brightness, easing, 2 x 3-byte times
+#define EFFECT_MAX_CUE_SIZE 15
+
+/**
+* Decoding state of an effect
+* The reader only holds a position in the effect data and the previous cue.
+*/
+struct EffectReader{
+	const byte* data;	// First cue
+	const byte* end;	// End of the effect data
+	const byte* position;	// Next cue
+	bool progmem;	// Effect data is in PROGMEM
+	uint16_t numCues;
+	uint16_t cuesLeft;
+	Keyframe cue;	// Last decoded cue
+};
+
+// Check the header of an effect and prepare to read its first cue. Returns false if the data is not a valid effect
+bool effectBegin(EffectReader& reader, const byte* data, size_t length, bool progmem);
+
+// Go back to the first cue
+void effectRewind(EffectReader& reader);
+
+// Decode the next cue. Returns false at the end of the effect or if the data is truncated
+bool effectNextCue(EffectReader& reader, Keyframe& cue);
+
+// Encode cues into a buffer. Returns the number of bytes written, or 0 if the buffer is too small
+size_t encodeEffect(const Keyframe* cues, uint16_t numCues, byte* buffer, size_t capacity);
+
+
+#if !defined(ARDUINO)
+
+/**
+* Read-only memory mapping of an effect file, for host builds
+* The mapped data can be passed straight to RgbStrip::playEffect() with progmem set to false.
+*/
+class EffectFile {
+	public:
+	EffectFile();
+	~EffectFile();
+
+	// Map a file. Returns false if it can't be opened or mapped
+	bool open(const char* path);
+
+	// Unmap the file
+	void close();
+
+	const byte* data() const { return _data; }
+	size_t length() const { return _length; }
+
+	private:
+	EffectFile(const EffectFile&);
+	EffectFile& operator=(const EffectFile&);
+
+	const byte* _data;
+	size_t _length;
+};
+
+#endif
+
+
+#endif /* RGBEFFECT_H_ */
@@ -0,0 +1,22 @@
+/*
+* RgbHal.h
+*
+* Hardware abstraction for the RgbStrip library.
+* Arduino builds use the core directly. Everything else (Linux host builds,
+* benchmarks, tests) is routed through the HostHal shim, which provides a
+* virtual clock and records PWM writes.
+*/
+
+
+#ifndef RGBHAL_H_
+#define RGBHAL_H_
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include <Arduino.h>
+#elif defined(ARDUINO)
+#include <WProgram.h>
+#else
+#include "HostHal.h"
+#endif
+
+#endif /* RGBHAL_H_ */
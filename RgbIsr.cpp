@@ -0,0 +1,109 @@
+/*
+* RgbIsr.cpp
+*
+* Interrupt-latched strip backend. See RgbIsr.h.
+*/
+
+#include "RgbIsr.h"
+
+
+/**
+* Set the duty cycle of a pin in a set of levels, replacing any earlier one for the same pin
+*/
+static void mergeLevel(StripLevels& levels, byte pin, uint16_t duty) {
+	byte i = 0;
+	while (i < levels.count && levels.pins[i] != pin) {
+		i++;
+	}
+
+	if (i == levels.count) {
+		// A strip has three pins, so there is always room for a new one
+		levels.pins[i] = pin;
+		levels.count++;
+	}
+	levels.duty[i] = duty;
+}
+
+
+/**
+* Constructor
+* @param strip Strip whose output is latched by tick(). Only loop() may call it from now on
+*/
+RgbIsrDriver::RgbIsrDriver(RgbStrip& strip) : _strip(strip) {
+	_pending.count = 0;
+	_tickCount = 0;
+	_strip.setOutputWriter(writeLevel, this);
+}
+
+
+/**
+* Output writer of the strip
+* Commits made between two update() calls merge into one set of levels, so the queue takes one
+* entry per update() at most.
+* @param instance The driver that set the writer
+* @param pin Pin the strip would have written
+* @param duty Duty cycle for the pin
+*/
+void RgbIsrDriver::writeLevel(void* instance, int pin, uint16_t duty) {
+	RgbIsrDriver* thisInstance = (RgbIsrDriver*) instance;
+
+	mergeLevel(thisInstance->_pending, pin, duty);
+}
+
+
+/**
+* Update the strip, then queue the duty cycles written since the last update
+* If the queue is full the levels are kept, and later writes merge into them, until a tick makes
+* room. Nothing is lost; the interrupt just shows the latest levels a tick or more later.
+*/
+void RgbIsrDriver::update() {
+	_strip.update();
+
+	if (_pending.count > 0 && _queue.push(_pending)) {
+		_pending.count = 0;
+	}
+}
+
+
+unsigned long RgbIsrDriver::msUntilNextEvent() {
+	if (_pending.count > 0) {
+		return 0;
+	}
+
+	return _strip.msUntilNextEvent();
+}
+
+
+bool RgbIsrDriver::isIdle() {
+	return _pending.count == 0 && _queue.isEmpty();
+}
+
+
+/**
+* Latch the queued duty cycles
+* Takes at most RGBISR_QUEUE_SIZE sets of levels, so a producer that keeps queueing can't hold
+* the interrupt, and merges them so each pin is written once with its latest duty cycle. When
+* nothing is queued this is a couple of comparisons, so the interrupt can run every millisecond
+* or faster.
+*/
+void RgbIsrDriver::tick() {
+	StripLevels levels;
+	StripLevels latched;
+	latched.count = 0;
+
+	for (byte i = 0; i < RGBISR_QUEUE_SIZE && _queue.pop(levels); i++) {
+		for (byte j = 0; j < levels.count; j++) {
+			mergeLevel(latched, levels.pins[j], levels.duty[j]);
+		}
+	}
+
+	for (byte i = 0; i < latched.count; i++) {
+		analogWrite(latched.pins[i], latched.duty[i]);
+	}
+	_tickCount++;
+}
+
+
+unsigned long RgbIsrDriver::getTickCount() {
+	return _tickCount;
+}
@@ -0,0 +1,87 @@
+/*
+* RgbIsr.h
+*
+* Optional backend that latches a strip's output from a hardware timer
+* interrupt, so the pins change on a steady tick however long loop() takes.
+*
+* loop() owns the strip: it calls the strip's methods as usual and then the
+* driver's update(), which runs the strip's update() (timer events, fades,
+* sequences, interpolation and dithering). The duty cycles the strip commits
+* are not written to the pins there; the driver queues them in a lock-free
+* single-producer/single-consumer ring. Every tick the interrupt drains the
+* ring and writes each pin at most once with its latest duty cycle, which is
+* all it does, so it stays short. Nothing blocks or disables interrupts.
+*
+* Rules while a strip is latched from an interrupt:
+* - Call the strip and the driver from loop() only, apart from tick().
+* - Pins written by the interrupt must not be shared with the timer that
+*   generates it (e.g. Timer1 drives PWM on pins 9 and 10 of an Uno).
+*
+* Example (AVR, with the TimerOne library):
+*   RgbStrip strip(3, 5, 6);
+*   RgbIsrDriver driver(strip);
+*
+*   void tick() { driver.tick(); }
+*   void setup() { Timer1.initialize(1000); Timer1.attachInterrupt(tick); }
+*   void loop() { ... strip.setTargetColour(COLOURS[RED]); ... driver.update(); }
+*
+* On a host, HostHal::TimerThread calls tick() from a POSIX thread instead.
+*/
+
+
+#ifndef RGBISR_H_
+#define RGBISR_H_
+
+#include "RgbHal.h"
+#include "RgbStrip.h"
+#include "RgbQueue.h"
+
+#ifndef RGBISR_QUEUE_SIZE
+#define RGBISR_QUEUE_SIZE 8	// Commits that can wait between ticks. Power of two, up to 128
+#endif
+
+/**
+* Duty cycles of one commit, on their way from loop() to the interrupt
+*/
+struct StripLevels {
+	byte count;	// Pins written by the commit, up to one per channel
+	byte pins[3];
+	uint16_t duty[3];
+};
+
+class RgbIsrDriver
+{
+	public:
+	// Constructor. Duty cycles the strip writes from now on are latched by tick()
+	RgbIsrDriver(RgbStrip& strip);
+
+	// Update the strip and queue the duty cycles it committed for the next tick (loop() only)
+	void update();
+
+	// Get the time until update() next has work to do in ms. 0 while duty cycles wait for the queue (loop() only)
+	unsigned long msUntilNextEvent();
+
+	// Determine if every committed duty cycle has been written to the pins (loop() only)
+	bool isIdle();
+
+	// Write the queued duty cycles to the pins. Call from the timer interrupt only
+	void tick();
+
+	// Get the number of ticks run (interrupt context only, or once ticks have stopped)
+	unsigned long getTickCount();
+
+	private:
+	RgbIsrDriver(const RgbIsrDriver&);
+	RgbIsrDriver& operator=(const RgbIsrDriver&);
+
+	// Output writer of the strip. Collects duty cycles until update() queues them
+	static void writeLevel(void* instance, int pin, uint16_t duty);
+
+	RgbStrip& _strip;
+	SpscQueue<StripLevels, RGBISR_QUEUE_SIZE> _queue;
+	StripLevels _pending;	// Duty cycles not queued yet, written by loop() only
+	unsigned long _tickCount;	// Written by the interrupt only
+};
+
+
+#endif /* RGBISR_H_ */
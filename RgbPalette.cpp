@@ -0,0 +1,238 @@
+/*
+* RgbPalette.cpp
+*
+* Runtime colour palettes. See RgbPalette.h.
+*/
+
+#include "RgbPalette.h"
+
+
+/**
+* Constructor, called by RgbPaletteT with its storage
+*/
+RgbPalette::RgbPalette(RGB* colours, uint16_t* nameHashes, byte* codeIndexes, byte capacity) {
+	_colours = colours;
+	_nameHashes = nameHashes;
+	_codeIndexes = codeIndexes;
+	_capacity = capacity;
+	_size = 0;
+}
+
+
+// Adding colours
+/**
+* Add a colour to the palette
+* @param colour Colour to add
+* @param code Single character code (7-bit ASCII), or 0 for none
+* @param name Name to find the colour by, or NULL for none
+* @return Index of the new entry, or -1 if the palette is full or the code or name is already in use
+*/
+int RgbPalette::add(RGB colour, char code, const char* name) {
+	return addHashed(colour, code, (name != NULL) ? colourNameHash(name) : NO_COLOUR_NAME);
+}
+
+
+/**
+* Add a colour given in HSV
+* @param colour HSV colour to add (see hsvToRgb() in RGB.h)
+*/
+int RgbPalette::addHsv(HSV colour, char code, const char* name) {
+	return add(hsvToRgb(colour), code, name);
+}
+
+
+/**
+* Add a colour given as hex text
+* @param hex Colour as "#RRGGBB" or "RRGGBB"
+* @return Index of the new entry, or -1 if the text is not a hex colour or the colour can't be added
+*/
+int RgbPalette::addHex(const char* hex, char code, const char* name) {
+	RGB colour;
+	if (!parseHexColour(hex, colour)) {
+		return -1;
+	}
+
+	return add(colour, code, name);
+}
+
+
+/**
+* Add a colour with a name hash worked out in advance, e.g. with colourNameHash() at compile time
+* @param nameHash Hash of the entry's name, or NO_COLOUR_NAME
+*/
+int RgbPalette::addHashed(RGB colour, char code, uint16_t nameHash) {
+	if (_size >= _capacity || (byte)code >= COLOUR_CODE_TABLE_SIZE) {
+		return -1;
+	}
+	if (code != 0 && _codeIndexes[(byte)code] != NO_COLOUR) {
+		return -1;
+	}
+	if (nameHash != NO_COLOUR_NAME && indexOfHash(nameHash) != NO_COLOUR) {
+		return -1;
+	}
+
+	byte index = _size;
+	_colours[index] = colour;
+	_nameHashes[index] = nameHash;
+	if (code != 0) {
+		_codeIndexes[(byte)code] = index;
+	}
+
+	_size++;
+	return index;
+}
+
+
+/**
+* Add entries from an array in PROGMEM
+* Entries that can't be added (palette full, code or name already in use) are skipped.
+* @param entries Array of entries in PROGMEM
+* @param numEntries Number of entries in the array
+* @return Number of entries added
+*/
+int RgbPalette::load(const PaletteEntry* entries, int numEntries) {
+	int added = 0;
+
+	for (int i = 0; i < numEntries; i++) {
+		PaletteEntry entry;
+		memcpy_P(&entry, entries + i, sizeof(PaletteEntry));
+
+		if (addHashed(entry.colour, entry.code, entry.nameHash) >= 0) {
+			added++;
+		}
+	}
+
+	return added;
+}
+
+
+/**
+* Change the colour of an entry
+* Strips pick up the new colour the next time they look the entry up.
+* @return False if there is no entry at the index
+*/
+bool RgbPalette::set(byte index, RGB colour) {
+	if (index >= _size) {
+		return false;
+	}
+
+	_colours[index] = colour;
+	return true;
+}
+
+
+// Lookups
+/**
+* Get the colour of an entry
+* @return Colour of the entry, or black if there is no entry at the index
+*/
+RGB RgbPalette::get(byte index) {
+	if (index >= _size) {
+		RGB black = {0, 0, 0};
+		return black;
+	}
+
+	return _colours[index];
+}
+
+
+/**
+* Find a colour by its single character code
+* @return Index of the colour, or NO_COLOUR
+*/
+byte RgbPalette::indexOf(char code) {
+	return ((byte)code < COLOUR_CODE_TABLE_SIZE) ? _codeIndexes[(byte)code] : NO_COLOUR;
+}
+
+
+/**
+* Find a colour by name
+* @return Index of the colour, or NO_COLOUR
+*/
+byte RgbPalette::indexOfName(const char* name) {
+	return (name != NULL) ? indexOfHash(colourNameHash(name)) : NO_COLOUR;
+}
+
+
+/**
+* Find a colour by the hash of its name
+* @return Index of the colour, or NO_COLOUR
+*/
+byte RgbPalette::indexOfHash(uint16_t nameHash) {
+	if (nameHash == NO_COLOUR_NAME) {
+		return NO_COLOUR;
+	}
+
+	for (byte i = 0; i < _size; i++) {
+		if (_nameHashes[i] == nameHash) {
+			return i;
+		}
+	}
+
+	return NO_COLOUR;
+}
+
+
+byte RgbPalette::size() {
+	return _size;
+}
+
+
+byte RgbPalette::capacity() {
+	return _capacity;
+}
+
+
+/**
+* Remove every colour from the palette
+*/
+void RgbPalette::clear() {
+	_size = 0;
+	memset(_codeIndexes, NO_COLOUR, COLOUR_CODE_TABLE_SIZE);
+}
+
+
+// Hex colours
+static int hexDigit(char c) {
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	} else if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	} else if (c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+
+/**
+* Parse a hex colour
+* @param hex Text of the form "#RRGGBB" or "RRGGBB", with nothing after it
+* @param colour Set to the colour on success
+* @return True if the text is a hex colour
+*/
+bool parseHexColour(const char* hex, RGB& colour) {
+	if (hex == NULL) {
+		return false;
+	}
+	if (*hex == '#') {
+		hex++;
+	}
+
+	uint32_t value = 0;
+	for (byte i = 0; i < 6; i++) {
+		int digit = hexDigit(hex[i]);
+		if (digit < 0) {
+			return false;
+		}
+		value = (value << 4) | digit;
+	}
+	if (hex[6] != '\0') {
+		return false;
+	}
+
+	colour.r = value >> 16;
+	colour.g = value >> 8;
+	colour.b = value;
+	return true;
+}
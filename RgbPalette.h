@@ -0,0 +1,145 @@
+/*
+* RgbPalette.h
+*
+* Palettes of colours that can be filled at startup and changed while strips run.
+* Colours are stored packed at 3 bytes each and can be found by index, by single
+* character code (one PROGMEM-style table read) or by the hash of a name.
+*
+* A strip reads from its palette every time setTargetColour() is called with an
+* index, code or name, so entries can be edited or whole palettes swapped with
+* RgbStrip::setPalette() between updates without disturbing fades in progress.
+*
+* Example:
+*   const PaletteEntry STAGE_COLOURS[] PROGMEM = {
+*       {{255, 147, 41}, 'a', colourNameHash("amber")},
+*       {{0, 64, 255}, 'd', colourNameHash("deep blue")}
+*   };
+*   RgbPaletteT<64> palette;
+*
+*   palette.load(STAGE_COLOURS, 2);
+*   palette.addHex("#FF00AA", 'k', "pink");
+*   strip.setPalette(&palette);
+*   strip.setTargetColour("amber");
+*/
+
+
+#ifndef RGBPALETTE_H_
+#define RGBPALETTE_H_
+
+#include "RgbHal.h"
+#include "RGB.h"
+
+// Largest number of colours in one palette; index 255 is reserved for NO_COLOUR
+#define PALETTE_MAX_COLOURS 255
+
+// Name hash of entries that have no name
+#define NO_COLOUR_NAME 0
+
+/**
+* Hash a colour name at compile time or run time
+* 32-bit FNV-1a, ignoring ASCII case so "Amber" and "amber" match, folded to 16 bits by XORing its
+* halves. Never returns NO_COLOUR_NAME.
+*/
+constexpr uint32_t colourNameHashStep(const char* name, uint32_t hash){
+	return (*name == '\0') ? hash
+		: colourNameHashStep(name + 1, (hash ^ (byte)((*name >= 'A' && *name <= 'Z') ? *name + ('a' - 'A') : *name)) * 16777619UL);
+}
+
+constexpr uint16_t colourNameHashFold(uint32_t hash){
+	return ((hash >> 16) ^ (hash & 0xFFFF)) == NO_COLOUR_NAME ? 1 : ((hash >> 16) ^ (hash & 0xFFFF));
+}
+
+constexpr uint16_t colourNameHash(const char* name){
+	return colourNameHashFold(colourNameHashStep(name, 2166136261UL));
+}
+
+/**
+* A palette entry as stored in PROGMEM for RgbPalette::load()
+* @param colour Colour of the entry
+* @param code Single character code, or 0 for none
+* @param nameHash colourNameHash() of the entry's name, or NO_COLOUR_NAME
+*/
+struct PaletteEntry{
+	RGB colour;
+	char code;
+	uint16_t nameHash;
+};
+
+/**
+* Palette interface shared by palettes of every capacity
+* Storage is provided by RgbPaletteT; this class only holds pointers to it, so strips can refer to
+* any palette through an RgbPalette pointer.
+*/
+class RgbPalette
+{
+	public:
+	// Add a colour. Returns its index, or -1 if the palette is full or the code or name is already taken
+	int add(RGB colour, char code = 0, const char* name = NULL);
+	int addHsv(HSV colour, char code = 0, const char* name = NULL);
+	int addHex(const char* hex, char code = 0, const char* name = NULL);
+
+	// Add a colour with a precomputed name hash
+	int addHashed(RGB colour, char code, uint16_t nameHash);
+
+	// Add entries from a PROGMEM array. Returns the number of entries added
+	int load(const PaletteEntry* entries, int numEntries);
+
+	// Change the colour of an existing entry
+	bool set(byte index, RGB colour);
+
+	// Get a colour by index. Out of range indexes give black
+	RGB get(byte index);
+
+	// Find a colour. Each returns the palette index, or NO_COLOUR
+	byte indexOf(char code);
+	byte indexOfName(const char* name);
+	byte indexOfHash(uint16_t nameHash);
+
+	// Number of colours in the palette
+	byte size();
+
+	// Number of colours the palette can hold
+	byte capacity();
+
+	// Remove every colour
+	void clear();
+
+	protected:
+	RgbPalette(RGB* colours, uint16_t* nameHashes, byte* codeIndexes, byte capacity);
+
+	private:
+	RgbPalette(const RgbPalette&);
+	RgbPalette& operator=(const RgbPalette&);
+
+	RGB* _colours;
+	uint16_t* _nameHashes;
+	byte* _codeIndexes;	// COLOUR_CODE_TABLE_SIZE entries
+	byte _capacity;
+	byte _size;
+};
+
+/**
+* Palette with room for a fixed number of colours
+* RAM use is 5 bytes per colour plus a 128 byte code table.
+*/
+template <byte Capacity>
+class RgbPaletteT : public RgbPalette
+{
+	static_assert(Capacity > 0 && Capacity <= PALETTE_MAX_COLOURS, "Palette capacity must be 1-255");
+
+	public:
+	RgbPaletteT() : RgbPalette(_colourStorage, _nameHashStorage, _codeIndexStorage, Capacity) {
+		clear();
+	}
+
+	private:
+	RGB _colourStorage[Capacity];
+	uint16_t _nameHashStorage[Capacity];
+	byte _codeIndexStorage[COLOUR_CODE_TABLE_SIZE];
+};
+
+// Parse a "#RRGGBB" or "RRGGBB" hex colour. Returns false if the text is not a hex colour
+bool parseHexColour(const char* hex, RGB& colour);
+
+
+#endif /* RGBPALETTE_H_ */
@@ -0,0 +1,64 @@
+/*
+* RgbQueue.cpp
+*
+* Applying queued strip commands. See RgbQueue.h.
+*/
+
+#include "RgbQueue.h"
+#include "RgbStrip.h"
+
+
+/**
+* Apply a command to a strip
+* Must be called from the context that owns the strip. Unknown commands and flash counts that
+* are not positive are ignored.
+* @param strip Strip to change
+* @param command Command to apply
+*/
+void applyStripCommand(RgbStrip& strip, const StripCommand& command) {
+	switch (command.type) {
+		case STRIP_TARGET_COLOUR:
+			strip.setTargetColour(command.colour);
+			break;
+
+		// Values are clamped while still long; passed as an int on AVR they would lose their top 16 bits
+		case STRIP_BRIGHTNESS:
+			if (command.value > FULL_BRIGHTNESS) {
+				strip.setBrightness(FULL_BRIGHTNESS);
+			} else {
+				strip.setBrightness(command.value < 0 ? 0 : command.value);
+			}
+			break;
+
+		case STRIP_FLASH:
+			// A flash with no runs would schedule a timer that never ends
+			if (command.value > 0) {
+				strip.flash(command.value > MAX_FLASHES ? MAX_FLASHES : command.value);
+			}
+			break;
+
+		case STRIP_TRANSITIONS:
+			if (command.value) {
+				strip.enableTransitions();
+			} else {
+				strip.disableTransitions();
+			}
+			break;
+
+		case STRIP_STROBE:
+			if (command.value) {
+				strip.enableStrobe();
+			} else {
+				strip.disableStrobe();
+			}
+			break;
+
+		case STRIP_TRANSITION_PERIOD:
+			strip.setTransitionPeriod(command.value);
+			break;
+
+		case STRIP_STROBE_PERIOD:
+			strip.setStrobePeriod(command.value);
+			break;
+	}
+}
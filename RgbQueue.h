@@ -0,0 +1,190 @@
+/*
+* RgbQueue.h
+*
+* Strip commands that can be handed from one execution context to another,
+* and lock-free queues to carry them: a single-producer/single-consumer queue,
+* e.g. of output levels from loop() to a timer interrupt, and a
+* multi-producer/single-consumer queue for threads on multi-core hosts (not
+* available on AVR).
+*
+* The queues use the GCC __atomic builtins, which avr-gcc, arm-none-eabi-gcc
+* and host compilers all provide. On AVR the byte sized indices of the
+* single-producer queue compile to plain loads and stores; on hosts they carry
+* acquire/release ordering, so ThreadSanitizer can check the handoff.
+*/
+
+
+#ifndef RGBQUEUE_H_
+#define RGBQUEUE_H_
+
+#include "RgbHal.h"
+#include "RGB.h"
+
+class RgbStrip;
+
+/**
+* Operations a strip command can carry
+*/
+enum STRIP_COMMANDS{
+	STRIP_TARGET_COLOUR = 0,	// setTargetColour(colour)
+	STRIP_BRIGHTNESS = 1,	// setBrightness(value)
+	STRIP_FLASH = 2,	// flash(value), for values of 1 or more
+	STRIP_TRANSITIONS = 3,	// enableTransitions() if value is non-zero, else disableTransitions()
+	STRIP_STROBE = 4,	// enableStrobe() if value is non-zero, else disableStrobe()
+	STRIP_TRANSITION_PERIOD = 5,	// setTransitionPeriod(value)
+	STRIP_STROBE_PERIOD = 6	// setStrobePeriod(value)
+};
+
+/**
+* A single queued strip command
+*/
+struct StripCommand {
+	byte type;	// One of STRIP_COMMANDS
+	RGB colour;	// STRIP_TARGET_COLOUR only
+	long value;
+};
+
+// Apply a command to a strip
+void applyStripCommand(RgbStrip& strip, const StripCommand& command);
+
+/**
+* Lock-free queue with one producer and one consumer
+* push() may only be called from one context and pop() from one other context; neither ever blocks.
+* Indices run freely over 0-255 and are masked, so a full queue holds all Size items.
+*/
+template <typename T, byte Size>
+class SpscQueue
+{
+	static_assert(Size > 0 && Size <= 128 && (Size & (Size - 1)) == 0, "Queue size must be a power of two up to 128");
+
+	public:
+	SpscQueue() : _head(0), _tail(0) {}
+
+	// Add an item (producer). Returns false if the queue is full
+	bool push(const T& item) {
+		byte tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+		byte head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+		if ((byte)(tail - head) == Size) {
+			return false;
+		}
+
+		_items[tail & (Size - 1)] = item;
+		__atomic_store_n(&_tail, (byte)(tail + 1), __ATOMIC_RELEASE);
+		return true;
+	}
+
+	// Take the oldest item (consumer). Returns false if the queue is empty
+	bool pop(T& item) {
+		byte head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+		byte tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+		if (head == tail) {
+			return false;
+		}
+
+		item = _items[head & (Size - 1)];
+		__atomic_store_n(&_head, (byte)(head + 1), __ATOMIC_RELEASE);
+		return true;
+	}
+
+	// Determine if the queue holds no items. Exact from the consumer, a snapshot from the producer
+	bool isEmpty() {
+		return __atomic_load_n(&_head, __ATOMIC_ACQUIRE) == __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+	}
+
+	private:
+	T _items[Size];
+	byte _head;	// Next item to pop, written by the consumer
+	byte _tail;	// Next free slot, written by the producer
+};
+
+// Single-producer/single-consumer queue of strip commands
+template <byte Size>
+using StripCommandQueue = SpscQueue<StripCommand, Size>;
+
+
+#if !defined(__AVR__)
+
+/**
+* Lock-free queue of strip commands with any number of producers and one consumer
+* Each slot carries a sequence number (a bounded Vyukov queue): producers claim a slot with one
+* compare-and-swap on the tail and publish it by advancing the slot's sequence, and the consumer
+* only takes slots that have been published. A producer that is preempted between claiming and
+* publishing delays the consumer until it resumes, but never blocks other producers.
+* Relies on 32-bit compare-and-swap, which AVR can't do atomically, so it is left out of AVR builds.
+*/
+template <unsigned int Size>
+class StripCommandMpscQueue
+{
+	static_assert(Size > 1 && (Size & (Size - 1)) == 0, "Queue size must be a power of two");
+
+	public:
+	StripCommandMpscQueue() : _tail(0), _head(0) {
+		for (unsigned int i = 0; i < Size; i++) {
+			_slots[i].sequence = i;
+		}
+	}
+
+	// Add a command (any producer). Returns false if the queue is full
+	bool push(const StripCommand& command) {
+		uint32_t position = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+		Slot* slot;
+
+		for (;;) {
+			slot = &_slots[position & (Size - 1)];
+			int32_t ready = (int32_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - position);
+
+			if (ready == 0) {
+				// The slot is free for this position; claim it. On failure position is reloaded
+				if (__atomic_compare_exchange_n(&_tail, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+					break;
+				}
+			} else if (ready < 0) {
+				// The consumer has not freed this slot from the previous lap
+				return false;
+			} else {
+				position = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+			}
+		}
+
+		slot->command = command;
+		__atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+	// Take the oldest published command (the consumer only). Returns false if there is none
+	bool pop(StripCommand& command) {
+		Slot* slot = &_slots[_head & (Size - 1)];
+		if ((int32_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (_head + 1)) < 0) {
+			return false;
+		}
+
+		command = slot->command;
+		__atomic_store_n(&slot->sequence, _head + Size, __ATOMIC_RELEASE);
+		_head++;
+		return true;
+	}
+
+	// Determine if no published command is waiting (the consumer only)
+	bool isEmpty() {
+		Slot* slot = &_slots[_head & (Size - 1)];
+		return (int32_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (_head + 1)) < 0;
+	}
+
+	private:
+	StripCommandMpscQueue(const StripCommandMpscQueue&);
+	StripCommandMpscQueue& operator=(const StripCommandMpscQueue&);
+
+	struct Slot {
+		uint32_t sequence;	// Position the slot is free for, or that position + 1 once published
+		StripCommand command;
+	};
+
+	Slot _slots[Size];
+	uint32_t _tail;	// Next position to claim, shared by the producers
+	uint32_t _head;	// Next position to take, consumer only
+};
+
+#endif
+
+
+#endif /* RGBQUEUE_H_ */
@@ -0,0 +1,58 @@
+/*
+* RgbSequence.h
+*
+* Keyframe sequences that an RgbStrip plays by itself from update().
+* Sequences are arrays of Keyframe kept in PROGMEM; the strip reads one
+* keyframe at a time and never copies the sequence into RAM.
+*
+* Example:
+*   const Keyframe SUNRISE[] PROGMEM = {
+*       // colour          brightness  fade   hold  easing
+*       {{255, 0, 0},      20,         2000,  500,  EASE_IN_OUT_SINE},
+*       {{255, 128, 0},    60,         3000,  500,  EASE_IN_OUT_SINE},
+*       {{255, 255, 255},  100,        3000,  0,    EASE_OUT_CUBIC}
+*   };
+*   strip.playSequence(SUNRISE, 3, SEQUENCE_PING_PONG);
+*/
+
+
+#ifndef RGBSEQUENCE_H_
+#define RGBSEQUENCE_H_
+
+#include "RgbHal.h"
+#include "RGB.h"
+#include "RgbEasing.h"
+
+/**
+* A single step of a sequence
+* @param colour Colour to fade to
+* @param brightness Percentage brightness of the colour, applied on top of the strip brightness
+* @param fadeTime Time in ms to fade from the previous step to this one
+* @param holdTime Time in ms to hold this step once it is reached
+* @param easing Easing curve of the fade (see EASING_CURVES in RgbEasing.h)
+*/
+struct Keyframe{
+	RGB colour;
+	byte brightness;
+	uint16_t fadeTime;
+	uint16_t holdTime;
+	byte easing;
+};
+
+/**
+* What to do after the last step of a sequence
+*/
+enum SEQUENCE_MODES{
+	SEQUENCE_ONCE = 0,	// Stop on the last step
+	SEQUENCE_LOOP = 1,	// Start again from the first step
+	SEQUENCE_PING_PONG = 2	// Play the steps backwards, then forwards again
+};
+
+// Step number passed to sequence callbacks when a SEQUENCE_ONCE sequence ends
+#define SEQUENCE_FINISHED -1
+
+// Called with the callback context and the step number whenever a step starts
+typedef void (*sequence_callback)(void* context, int step);
+
+
+#endif /* RGBSEQUENCE_H_ */
@@ -1,27 +1,92 @@
 #include "RgbStrip.h"
+#include "RgbCommand.h"
 
-void* pt2Object;
+// Transition step in 16-bit channel units
+#define TRANSITION_STEP_16 (TRANSITION_STEP * 257)
 
-RgbStrip::RgbStrip(int redPin, int greenPin, int bluePin) {
+// 4x4 Bayer matrix unrolled into a sequence of thresholds (0-15) over time
+static const byte ORDERED_DITHER_PATTERN[16] PROGMEM = {0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5};
+
+/**
+* Create an RGB strip that schedules its events on a timer of its own
+*/
+RgbStrip::RgbStrip(int redPin, int greenPin, int bluePin) : StripControl(_ownTimer) {
+	init(redPin, greenPin, bluePin);
+}
+
+
+/**
+* Create an RGB strip that schedules its events on an existing timer
+* Strips can share one scheduler; each strip uses up to three timer slots, so a SimpleTimer serves
+* three strips. Temporal dithering takes a fourth (see setDitherMode()). Check isScheduled() if the
+* scheduler may be full.
+* @param timer The scheduler for transition, strobe and flash events
+*/
+RgbStrip::RgbStrip(int redPin, int greenPin, int bluePin, SimpleTimer& timer) : StripControl(timer) {
+	init(redPin, greenPin, bluePin);
+}
+
+
+/**
+* Set up the pins, output pipeline and timer events
+*/
+void RgbStrip::init(int redPin, int greenPin, int bluePin) {
 	// Pin assignments
-	_redPin = redPin;
-	_greenPin = greenPin;
-	_bluePin = bluePin;
-	pinMode(_redPin, OUTPUT);
-	pinMode(_greenPin, OUTPUT);
-	pinMode(_bluePin, OUTPUT);
+	_red.pin = redPin;
+	_green.pin = greenPin;
+	_blue.pin = bluePin;
+	pinMode(_red.pin, OUTPUT);
+	pinMode(_green.pin, OUTPUT);
+	pinMode(_blue.pin, OUTPUT);
+	
+	// Nothing has been written to the pins yet
+	_red.dutyValid = false;
+	_green.dutyValid = false;
+	_blue.dutyValid = false;
+	resetWriteCounts();
+	_doubleBuffered = false;
+	_commitPending = false;
+	_outputWriter = NULL;
+	_outputContext = NULL;
+	
+	// Offset the channels in the ordered dither pattern so they don't step together
+	_red.phase = 0;
+	_green.phase = 5;
+	_blue.phase = 10;
+
+	// Set up the output pipeline
+	setOutputCurve(CURVE_LINEAR);
+	setOutputResolution(RGBSTRIP_PWM_BITS);
+	_ditherMode = DITHER_NONE;
+	_ditherStep = 0;
+	_ditherEventID = -1;
 
 	// Set initial brightness and colour
-	_brightness = DEFAULT_BRIGHTNESS;
+	_fadeActive = false;
+	_transitionSpace = COLOUR_SPACE_RGB;
+	_hueTransition = false;
+	_sequence = NULL;
+	_sequencePlaying = false;
+	_sequenceCallback = NULL;
+	_sequenceContext = NULL;
+	_commandParser = NULL;
+	_palette = NULL;
+	_activeColour = toRGB16(COLOURS[OFF]);
+	setBrightness(DEFAULT_BRIGHTNESS);
 	setTargetColour(OFF);
 	
-	// Set up transition events
-	_transitionEventID = _timer.setInterval(DEFAULT_TRANSITION_PERIOD, transitionEvent_wrapper);
-	disableTransitions();
-	
-	// Set up strobe events
-	_strobeEventID = _timer.setInterval(DEFAULT_STROBE_PERIOD, strobeEvent_wrapper);
-	disableStrobe();
+	// Set up transition and strobe events
+	scheduleEvents();
+}
+
+
+/**
+* Get a scheduler that strips can share by passing it to the constructor
+* Capacity is set by SIMPLETIMER_MAX_TIMERS (see SimpleTimer.h): three strips with the default of 10.
+*/
+SimpleTimer& RgbStrip::sharedTimer(){
+	static SimpleTimer timer;
+	return timer;
 }
 
 
@@ -31,23 +96,35 @@ RgbStrip::RgbStrip(int redPin, int greenPin, int bluePin) {
 * @param colour RGB colour code of the desired colour
 */
 void RgbStrip::setTargetColour(RGB colour) {
-	_targetColour = colour;
+	_targetColour = toRGB16(colour);
+	_fadeActive = false;
+	
+	if (_transitionSpace == COLOUR_SPACE_HSV){
+		beginHueTransition(rgbToHsv(colour));
+	} else {
+		_hueTransition = false;
+	}
 	
 	// If transitions are not enabled, write the change in colour immediately
 	if (isTransitionsEnabled() == false){
-		setActiveColour(colour);
+		setActiveColour(_targetColour);
 	}
 }
 
 
 /**
 * Set the target colour of the RGB strip
-* The colour indexes that are used in this method are found in COLOUR_INDEXES in RGB.h
+* The colour indexes that are used in this method are found in COLOUR_INDEXES in RGB.h, or are indexes
+* into the palette set with setPalette().
 * Worded colours are mapped to their corresponding indexes. See RGB.h for more detail.
 * @param colourIndex The index of the desired colour according to the COLOUR_INDEXES enum.
 */
 void RgbStrip::setTargetColour(int colourIndex){
-	if (colourIndex < COLOUR_MAP.length()){
+	if (_palette != NULL){
+		if (colourIndex >= 0 && colourIndex < _palette->size()){
+			setTargetColour(_palette->get(colourIndex));
+		}
+	} else if (colourIndex >= 0 && colourIndex < NUM_COLOURS){
 		RGB colour = COLOURS[colourIndex];
 		setTargetColour(colour);
 	}
@@ -56,431 +133,1110 @@ void RgbStrip::setTargetColour(int colourIndex){
 
 /**
 * Set the target colour of the RGB strip
-* The colour indexes that are used in this method are found in COLOUR_MAP in RGB.h
-* Single characters are mapped to colour index entries found in
-* @param colourIndex The character index of the desired colour according to the COLOUR_MAP string in RGB.h
+* The colour indexes that are used in this method are found in COLOUR_MAP in RGB.h, or are the codes of
+* the palette set with setPalette().
+* Single characters are mapped to colour index entries by a table, with a single read per lookup
+* @param colourCode The character code of the desired colour according to the COLOUR_MAP string in RGB.h
 */
 void RgbStrip::setTargetColour(char colourCode){
-	int colourIndex = COLOUR_MAP.indexOf(colourCode);
-	if (colourIndex >= 0){
-		setTargetColour(colourIndex);
+	byte colourIndex = getColourIndex(colourCode);
+	if (colourIndex != NO_COLOUR){
+		setTargetColour((int)colourIndex);
 	}
 }
 
 
 /**
-* Set the active colour displayed directly (without transitioning)
-* @param colour RGB colour code of the desired active colour
+* Set the target colour of the RGB strip to a named palette colour
+* Names are matched by hash, ignoring case. The built in COLOURS have no names.
+* @param colourName Name given to the colour when it was added to the palette
 */
-void RgbStrip::setActiveColour(RGB colour) {
-	_activeColour = colour;
-	writeColour(_activeColour);
+void RgbStrip::setTargetColour(const char* colourName){
+	if (_palette != NULL){
+		byte colourIndex = _palette->indexOfName(colourName);
+		if (colourIndex != NO_COLOUR){
+			setTargetColour((int)colourIndex);
+		}
+	}
 }
 
 
 /**
-* Get the colour code for the actively displayed colour  
+* Set the palette that indexed, coded and named colours are read from
+* Colours are looked up when they are set, so the palette can be swapped or edited while the strip runs;
+* a fade in progress keeps going to the colour it started towards.
+* @param palette Palette to use, or NULL for the built in COLOURS and COLOUR_MAP codes
 */
-RGB RgbStrip::getActiveColour(){
-	return _activeColour;
+void RgbStrip::setPalette(RgbPalette* palette){
+	_palette = palette;
 }
 
-// Colour control - Private
 
 /**
-* Write the active colour to the RGB channels
+* Get the palette that colours are read from
+* @return Palette set with setPalette(), or NULL when the built in COLOURS are used
 */
-void RgbStrip::applyActiveColour() {
+RgbPalette* RgbStrip::getPalette(){
+	return _palette;
+}
+
+
+/**
+* Find a single character colour code in the current palette
+* @param colourCode Character code
+* @return Index of the colour, or NO_COLOUR
+*/
+byte RgbStrip::getColourIndex(char colourCode){
+	if (_palette != NULL){
+		return _palette->indexOf(colourCode);
+	}
+	return lookupColourCode(COLOUR_CODE_INDEXES, colourCode);
+}
+
+
+/**
+* Fade the RGB strip to a new colour over a fixed time
+* All channels move together and arrive exactly when the duration has elapsed. The active colour is
+* calculated from the elapsed time on every update(), so the fade stays on schedule however
+* irregularly update() is called. Transition events are not used and need not be enabled.
+* @param colour RGB colour code of the desired colour
+* @param duration Length of the fade in ms. A duration of zero changes the colour immediately.
+*/
+void RgbStrip::setTargetColour(RGB colour, unsigned long duration) {
+	setTargetColour(colour, duration, easeLinear);
+}
+
+
+/**
+* Fade the RGB strip to a new colour over a fixed time, following an easing curve
+* @param colour RGB colour code of the desired colour
+* @param duration Length of the fade in ms. A duration of zero changes the colour immediately.
+* @param easing Maps fade progress to colour progress, e.g. easeInOutSine or getEasingFunction(EASE_OUT_CUBIC)
+*/
+void RgbStrip::setTargetColour(RGB colour, unsigned long duration, easing_function easing) {
+	if (duration == 0){
+		setTargetColour(colour);
+		setActiveColour(_targetColour);
+		return;
+	}
 	
+	startFade(toRGB16(colour), millis(), duration, easing);
 }
 
 
 /**
-* Write the specified colour to the RGB PWM outputs
-* The global brightness factor is applied prior to writing the output to the colour channel pins
-* @param colour RGB object containing the desired colour code
+* Set the target colour of the RGB strip in HSV
+* In COLOUR_SPACE_HSV the transition follows the given hue exactly, so hue 0 and HUE_MAX - 1 are told apart
+* and fully desaturated colours keep their hue. In COLOUR_SPACE_RGB this is the same as setting the RGB colour.
+* @param colour HSV colour of the desired colour (see RGB.h)
 */
-void RgbStrip::writeColour(RGB colour) {
-	byte adjustedRed;
-	byte adjustedGreen;
-	byte adjustedBlue;
+void RgbStrip::setTargetColourHsv(HSV colour) {
+	setTargetColour(hsvToRgb(colour));
+	if (_transitionSpace == COLOUR_SPACE_HSV){
+		beginHueTransition(colour);
+	}
+}
 
-	// Apply global brightness level
-	adjustedRed = (colour.r * _brightness) / 100;
-	adjustedGreen = (colour.g * _brightness) / 100;
-	adjustedBlue = (colour.b * _brightness) / 100;
 
-	analogWrite(_redPin, adjustedRed);
-	analogWrite(_greenPin, adjustedGreen);
-	analogWrite(_bluePin, adjustedBlue);
+/**
+* Fade the RGB strip to a new HSV colour over a fixed time
+* @param colour HSV colour of the desired colour
+* @param duration Length of the fade in ms. A duration of zero changes the colour immediately.
+*/
+void RgbStrip::setTargetColourHsv(HSV colour, unsigned long duration) {
+	setTargetColourHsv(colour, duration, easeLinear);
 }
 
 
-// Brightness
 /**
-* Set the global intensity of the lights as a percentage.
-* Setting the brightness to zero will effectively turn the lights off.
-* @param percentage The percentage intensity of the lights. 100% is full brightness, whilst 0% is off
+* Fade the RGB strip to a new HSV colour over a fixed time, following an easing curve
+* @param colour HSV colour of the desired colour
+* @param duration Length of the fade in ms. A duration of zero changes the colour immediately.
+* @param easing Maps fade progress to colour progress
 */
-void RgbStrip::setBrightness(int percentage) {
-	if (percentage > 100) {
-		percentage = 100;
-		} else if (percentage <= 0) {
-		percentage = 0;
+void RgbStrip::setTargetColourHsv(HSV colour, unsigned long duration, easing_function easing) {
+	setTargetColour(hsvToRgb(colour), duration, easing);
+	if (_transitionSpace == COLOUR_SPACE_HSV){
+		beginHueTransition(colour);
 	}
+}
 
-	_brightness = percentage;
-	applyActiveColour();
+
+/**
+* Choose the colour space that transitions and fades move through
+* In COLOUR_SPACE_RGB each channel moves straight to its target, so e.g. red to cyan passes through grey.
+* In COLOUR_SPACE_HSV the hue turns the short way round the colour wheel while saturation and value move
+* straight, so colours stay saturated. Takes effect from the next target colour.
+* @param space One of COLOUR_SPACES. Unknown spaces are ignored.
+*/
+void RgbStrip::setTransitionSpace(byte space){
+	if (space == COLOUR_SPACE_RGB || space == COLOUR_SPACE_HSV){
+		_transitionSpace = space;
+	}
 }
 
 
 /**
-* Return the current brightness of the led strip
-* @return Percentage brightness of the strip  
+* Get the colour space that transitions and fades move through
+* @return One of COLOUR_SPACES
 */
-int RgbStrip::getBrightness(){
-	return _brightness;
+byte RgbStrip::getTransitionSpace(){
+	return _transitionSpace;
+}
+
+
+/**
+* Determine if a timed fade is in progress
+* @return True if a fade started by setTargetColour(colour, duration) has not finished
+*/
+bool RgbStrip::isFading(){
+	return _fadeActive;
 }
+
+
+// Sequences
+/**
+* Play a sequence of keyframes
+* The strip fades from its active colour to the first keyframe, then through the rest in order.
+* Keyframes are read from PROGMEM one step at a time, so sequences take no RAM, and each update()
+* does a constant amount of work. Steps are timed from the end of the previous step rather than from
+* when update() noticed it, so a sequence keeps its tempo however irregularly update() is called.
+* @param keyframes Array of keyframes in PROGMEM
+* @param numKeyframes Number of keyframes in the array
+* @param mode What to do after the last keyframe (see SEQUENCE_MODES)
+*/
+void RgbStrip::playSequence(const Keyframe* keyframes, int numKeyframes, byte mode){
+	if (keyframes == NULL || numKeyframes <= 0){
+		return;
+	}
 	
+	_sequence = keyframes;
+	_sequenceLength = numKeyframes;
+	_sequenceMode = mode;
+	_sequenceStep = 0;
+	_sequenceDirection = 1;
+	_sequencePlaying = true;
+	startSequenceStep(millis());
+}
+
+
+/**
+* Play a packed effect
+* Effects run through the same player as sequences, but their cues are decoded one at a time from
+* the data where it is stored, so the effect is never copied into RAM. Cues are delta-encoded and
+* can only be read forwards, so SEQUENCE_PING_PONG plays an effect as SEQUENCE_LOOP.
+* @param data Effect data, as written by encodeEffect() or extras/effect_encoder
+* @param length Length of the effect data in bytes
+* @param inProgmem True if the data is in PROGMEM, false if it is in RAM or a memory-mapped file
+* @param mode What to do after the last cue (see SEQUENCE_MODES)
+* @return False if the data is not a valid effect or has no cues
+*/
+bool RgbStrip::playEffect(const byte* data, size_t length, bool inProgmem, byte mode){
+	if (data == NULL || !effectBegin(_effect, data, length, inProgmem) || _effect.numCues == 0){
+		return false;
+	}
 	
+	_sequence = NULL;
+	_sequenceLength = _effect.numCues;
+	_sequenceMode = (mode == SEQUENCE_PING_PONG) ? (byte)SEQUENCE_LOOP : mode;
+	_sequenceStep = 0;
+	_sequenceDirection = 1;
+	_sequencePlaying = true;
+	startSequenceStep(millis());
+	return true;
+}
+
+
 /**
-* Set the brightness to a low level
-* This level is defined in RgbStrip.h. Default: 30%
+* Stop the sequence
+* The active colour stays where it is, part way through a fade if need be.
 */
-void RgbStrip::setLowBrightness(){
-	setBrightness(LOW_BRIGHTNESS);
+void RgbStrip::stopSequence(){
+	_sequencePlaying = false;
+	_fadeActive = false;
+	_targetColour = _activeColour;
 }
 
 
 /**
-* Set the global brightness to full
+* Determine if a sequence is playing
+* @return True if a sequence has been started and has not stopped or finished
 */
-void RgbStrip::setFullBrightness(){
-	setBrightness(FULL_BRIGHTNESS);
+bool RgbStrip::isSequencePlaying(){
+	return _sequencePlaying;
 }
 
 
 /**
-* Increase the intensity of the LEDs by a fixed percentage
-* By default, this is by steps of 10%
-* Intensity will increase to a maximum of 100%
+* Get the step of the sequence that is being played
+* @return Index of the current keyframe
 */
-void RgbStrip::increaseBrightness() {
-	setBrightness(_brightness + BRIGHTNESS_INCREMENT);
+int RgbStrip::getSequenceStep(){
+	return _sequenceStep;
 }
 
 
 /**
-* Decrease the intensity of the LEDs by a fixed percentage
-* By default, this is by steps of 10%
-* Intensity will decrease to a minimum of 0%
+* Set a function to be called whenever a sequence step starts
+* The function receives the context pointer and the step number, or SEQUENCE_FINISHED when a
+* SEQUENCE_ONCE sequence has finished its last step.
+* @param callback Function to call, or NULL for none
+* @param context Pointer passed back to the function
 */
-void RgbStrip::decreaseBrightness() {
-	setBrightness(_brightness - BRIGHTNESS_INCREMENT);
+void RgbStrip::setSequenceCallback(sequence_callback callback, void* context){
+	_sequenceCallback = callback;
+	_sequenceContext = context;
 }
 
 
 /**
-* Turn the lights off.
-* This is accomplished via setting brightness, rather than colour
+* Read the current keyframe from PROGMEM, or decode the next effect cue, and start fading towards it
+* The keyframe brightness is folded into the fade target, so brightness changes fade with the colour.
+* An effect that turns out to be truncated stops playing.
+* @param startTime Time at which the step started in ms
 */
-void RgbStrip::lightsOff() {
-	setBrightness(0);
+void RgbStrip::startSequenceStep(unsigned long startTime){
+	Keyframe keyframe;
+	if (_sequence != NULL){
+		memcpy_P(&keyframe, _sequence + _sequenceStep, sizeof(Keyframe));
+	} else {
+		if (_sequenceStep == 0){
+			effectRewind(_effect);
+		}
+		if (!effectNextCue(_effect, keyframe)){
+			_sequencePlaying = false;
+			return;
+		}
+	}
+	
+	if (keyframe.brightness > FULL_BRIGHTNESS){
+		keyframe.brightness = FULL_BRIGHTNESS;
+	}
+	uint16_t scale = ((uint32_t)keyframe.brightness * 65535 + 50) / 100;
+	RGB16 colour = toRGB16(keyframe.colour);
+	colour.r = ((uint32_t)colour.r * scale) >> 16;
+	colour.g = ((uint32_t)colour.g * scale) >> 16;
+	colour.b = ((uint32_t)colour.b * scale) >> 16;
+	
+	_sequenceStepStart = startTime;
+	_sequenceStepLength = (unsigned long)keyframe.fadeTime + keyframe.holdTime;
+	
+	if (keyframe.fadeTime > 0){
+		startFade(colour, startTime, keyframe.fadeTime, getEasingFunction(keyframe.easing));
+	} else {
+		_fadeActive = false;
+		_targetColour = colour;
+		setActiveColour(colour);
+	}
+	
+	if (_sequenceCallback != NULL){
+		_sequenceCallback(_sequenceContext, _sequenceStep);
+	}
 }
 
 
 /**
-* Update timer to call events if needed  
+* Move on to the next sequence step once the current one has been faded to and held
+* At most one step is started per call, so a long stall catches up over the following updates.
 */
-void RgbStrip::update(){
-	_timer.run();
+void RgbStrip::updateSequence(){
+	// Taken in 32 bits so that it stays right when millis() wraps, also where unsigned long is wider
+	uint32_t stepTime = millis() - _sequenceStepStart;
+	if (stepTime < _sequenceStepLength){
+		return;
+	}
+	
+	unsigned long nextStart = _sequenceStepStart + _sequenceStepLength;
+	int nextStep = _sequenceStep + _sequenceDirection;
+	
+	if (nextStep < 0 || nextStep >= _sequenceLength){
+		switch (_sequenceMode){
+			case SEQUENCE_LOOP:
+				nextStep = 0;
+				break;
+			
+			case SEQUENCE_PING_PONG:
+				_sequenceDirection = -_sequenceDirection;
+				nextStep = _sequenceStep + _sequenceDirection;
+				if (nextStep < 0 || nextStep >= _sequenceLength){
+					nextStep = _sequenceStep;
+				}
+				break;
+			
+			default:
+				_sequencePlaying = false;
+				if (_sequenceCallback != NULL){
+					_sequenceCallback(_sequenceContext, SEQUENCE_FINISHED);
+				}
+				return;
+		}
+	}
+	
+	_sequenceStep = nextStep;
+	startSequenceStep(nextStart);
 }
 
-// Transitions
+
 /**
-* Transitions all colour channels towards the target colour
-* Changes to the active colour are applied immediately
+* Set the active colour displayed directly (without transitioning)
+* @param colour 16-bit colour code of the desired active colour
 */
-void RgbStrip::stepTowardsTargetColour() {
-	stepTowardsRedTarget();
-	stepTowardsGreenTarget();
-	stepTowardsBlueTarget();
+void RgbStrip::setActiveColour(RGB16 colour) {
+	_activeColour = colour;
+	writeColour(_activeColour);
+}
 
-	applyActiveColour();
+
+/**
+* Get the colour code for the actively displayed colour  
+*/
+RGB RgbStrip::getActiveColour(){
+	return toRGB(_activeColour);
 }
 
+// Colour control - Private
 
 /**
-* Determines if the active colour is the same as target colour
-* @return True if the active colour is the same as the target colour
+* Write the active colour to the RGB channels
 */
-bool RgbStrip::isTargetColourReached() {
-	bool targetReached = false;
-	if (_targetColour.r == _activeColour.r) {
-		if (_targetColour.g == _activeColour.g) {
-			if (_targetColour.b == _activeColour.b) {
-				targetReached = true;
-			}
-		}
+void RgbStrip::applyActiveColour() {
+	writeColour(_activeColour);
+}
+
+
+/**
+* Write the specified colour to the RGB PWM outputs
+* The global brightness factor is applied prior to writing the output to the colour channel pins.
+* With double buffering enabled the colour is left in the back buffer (the active colour and the
+* output settings) and written by the next update() instead.
+* @param colour 16-bit colour code of the desired colour
+*/
+void RgbStrip::writeColour(RGB16 colour) {
+	if (_doubleBuffered) {
+		_commitPending = true;
+		return;
 	}
+	
+	latchColour(colour);
+}
 
-	return targetReached;
+
+/**
+* Run all three channels of a colour through the pipeline, then output them together
+* @param colour 16-bit colour code of the desired colour
+*/
+void RgbStrip::latchColour(RGB16 colour) {
+	setChannelLevel(_red, colour.r);
+	setChannelLevel(_green, colour.g);
+	setChannelLevel(_blue, colour.b);
+	
+	uint16_t fractionMask = (1U << (16 - _outputBits)) - 1;
+	_ditherPending = ((_red.level | _green.level | _blue.level) & fractionMask) != 0;
+	
+	outputChannels();
+	scheduleDither();
 }
 
 
 /**
-* Steps the active red channel towards the target colour
+* Run a single colour channel through the pipeline and store the result
+* The whole pipeline runs at 16 bits: brightness is applied as a fraction of 32768 (see setBrightness),
+* then the output curve (if any) is interpolated from its PROGMEM table. The result is stored in the
+* channel so that temporal dithering can output it again without repeating this work.
+* @param channel The output channel to set
+* @param level Channel level from 0 to 65535
 */
-void RgbStrip::stepTowardsRedTarget() {
-	// If the difference between current and target level is less than the transition step, just apply the target level
-	if (abs(_targetColour.r - _activeColour.r) > TRANSITION_STEP) {
-		if (_targetColour.r > _activeColour.r) {
-			_activeColour.r += TRANSITION_STEP;
-			} else {
-			_activeColour.r -= TRANSITION_STEP;
-		}
-		} else {
-		_activeColour.r = _targetColour.r;
+void RgbStrip::setChannelLevel(OutputChannel& channel, uint16_t level) {
+	// Apply global brightness level
+	level = ((uint32_t)level * _brightnessScale) >> 15;
+
+	// Apply output curve
+	if (_outputCurveTable != NULL) {
+		level = applyOutputCurve(_outputCurveTable, level);
 	}
 
+	// Rescale from 0-65535 to 0-(2^bits - 1) in units of the output LSB, without dividing.
+	// At 16 bits the correction is level >> 16, i.e. nothing; shifting by the full width is undefined on AVR.
+	if (_outputBits < 16) {
+		level -= level >> _outputBits;
+	}
+	channel.level = level;
 }
 
 
 /**
-* Steps the active green channel towards the target colour
+* Reduce the stored levels of all channels to the output resolution and write them
+* Every duty cycle is worked out before any pin is written, so the pins change back to back
+* and a colour is never shown with some channels from the old colour and some from the new.
 */
-void RgbStrip::stepTowardsGreenTarget() {
-	if (abs(_targetColour.g - _activeColour.g) > TRANSITION_STEP) {
-		if (_targetColour.g > _activeColour.g) {
-			_activeColour.g += TRANSITION_STEP;
-			} else {
-			_activeColour.g -= TRANSITION_STEP;
-		}
-		} else {
-		_activeColour.g = _targetColour.g;
+void RgbStrip::outputChannels() {
+	bool red = reduceChannel(_red);
+	bool green = reduceChannel(_green);
+	bool blue = reduceChannel(_blue);
+	
+	if (red) {
+		writePin(_red);
+	}
+	if (green) {
+		writePin(_green);
+	}
+	if (blue) {
+		writePin(_blue);
 	}
 }
 
 
 /**
-* Steps the active blue channel towards the target colour
+* Reduce the level of a channel to the output resolution
+* The rescaled level leaves exactly one output LSB of headroom below 65536, so adding the
+* dither error or threshold (both less than one LSB) cannot overflow.
+* The pin only needs writing if its duty cycle changes; analogWrite() reprograms the timer
+* compare registers on most cores, which is slow and can glitch the waveform.
+* @param channel The output channel to reduce
+* @return True if the duty cycle changed and the pin must be written
 */
-void RgbStrip::stepTowardsBlueTarget() {
-	if (abs(_targetColour.b - _activeColour.b) > TRANSITION_STEP) {
-		if (_targetColour.b > _activeColour.b) {
-			_activeColour.b += TRANSITION_STEP;
-			} else {
-			_activeColour.b -= TRANSITION_STEP;
+bool RgbStrip::reduceChannel(OutputChannel& channel) {
+	byte shift = 16 - _outputBits;
+	uint16_t fractionMask = (1U << shift) - 1;
+	uint16_t level = channel.level;
+
+	switch (_ditherMode) {
+		case DITHER_ERROR_DIFFUSION:
+			level += channel.error;
+			channel.error = level & fractionMask;
+			break;
+
+		case DITHER_ORDERED: {
+			byte threshold = pgm_read_byte(ORDERED_DITHER_PATTERN + ((_ditherStep + channel.phase) & 0x0F));
+			level += (shift >= 4) ? ((uint16_t)threshold << (shift - 4)) : (threshold >> (4 - shift));
+			break;
 		}
-		} else {
-		_activeColour.b = _targetColour.b;
+
+		default:
+			level += fractionMask - (fractionMask >> 1);
+			break;
+	}
+
+	uint16_t duty = level >> shift;
+	if (channel.dutyValid && channel.duty == duty) {
+		_elidedWriteCount++;
+		return false;
 	}
+	
+	channel.duty = duty;
+	channel.dutyValid = true;
+	return true;
 }
 
 
 /**
-* Callback event for the transition timer event
-* Steps the active colour one increment towards the target colour
+* Write the duty cycle of a channel to its pin, or hand it to the output writer
 */
-void RgbStrip::transitionEvent(){
-	stepTowardsTargetColour();
+void RgbStrip::writePin(OutputChannel& channel) {
+	_writeCount++;
+	if (_outputWriter != NULL) {
+		_outputWriter(_outputContext, channel.pin, channel.duty);
+	} else {
+		analogWrite(channel.pin, channel.duty);
+	}
 }
 
 
 /**
-* Static method wrapper for transition timer events
+* Output the stored channel levels again with the next dither step
+* Only does work when dithering is enabled and a channel sits between two output levels. A commit
+* waiting in the back buffer outputs the channels anyway, so the frame is left to it.
 */
-void RgbStrip::transitionEvent_wrapper(){
-	RgbStrip* thisInstance = (RgbStrip*) pt2Object;
-	
-	thisInstance->transitionEvent();
+void RgbStrip::refreshDither() {
+	if (_ditherMode == DITHER_NONE || !_ditherPending || _commitPending) {
+		return;
+	}
+
+	_ditherStep++;
+	outputChannels();
 }
 
 
 /**
-* Enable timed transition events to occur  
+* Enable the dither timer while a channel sits between two output levels, and disable it otherwise
+* A strip at an exact output level then has nothing scheduled for dithering, and can sleep.
 */
-void RgbStrip::enableTransitions(){
-	_timer.enable(_transitionEventID);
+void RgbStrip::scheduleDither() {
+	if (_ditherEventID < 0) {
+		return;
+	}
+	
+	if (_ditherPending) {
+		_timer.enable(_ditherEventID);
+	} else {
+		_timer.disable(_ditherEventID);
+	}
 }
 
 
 /**
-* Disable timed transition events  
+* Static method wrapper for dither timer events
+* @param instance The RgbStrip that registered the timer event
+* @param missed Number of frames missed since the last one, which are not made up
 */
-void RgbStrip::disableTransitions(){
-	_timer.disable(_transitionEventID);
+void RgbStrip::ditherEvent_wrapper(void* instance, unsigned int missed) {
+	(void) missed;
+	RgbStrip* thisInstance = (RgbStrip*) instance;
+	
+	thisInstance->refreshDither();
 }
 
 
 /**
-* Set the period for transition events
-* @param period Time between transition events in ms.  
+* Write the back buffer to the pins, timing how long it takes
+* A commit is one pass through the pipeline and at most three pin writes, however many changes
+* were made since the last one, so its cost does not grow when effects, strobe and commands pile up.
 */
-void RgbStrip::setTransitionPeriod(long period){
-	if (period < TRANSITION_PERIOD_STEP){
-		period = TRANSITION_PERIOD_STEP;
+void RgbStrip::commitOutput() {
+	// Timed in 32 bits so that it stays right when micros() wraps, also where unsigned long is wider
+	uint32_t start = micros();
+	
+	latchColour(_activeColour);
+	_commitPending = false;
+	
+	uint32_t elapsed = micros() - start;
+	_commitTime = elapsed;
+	if (elapsed > _maxCommitTime) {
+		_maxCommitTime = elapsed;
 	}
+}
+
+
+/**
+* Render colour and brightness changes into a back buffer and write them to the pins from update()
+* Changes made between updates, from any source, are written together by a single commit,
+* so a brightness change or strobe toggle in the middle of a transition can't be half applied.
+* Output lags changes by up to one update().
+*/
+void RgbStrip::enableDoubleBuffering() {
+	_doubleBuffered = true;
+}
+
+
+/**
+* Write changes to the pins as soon as they are made
+* Any change still waiting in the back buffer is written now.
+*/
+void RgbStrip::disableDoubleBuffering() {
+	_doubleBuffered = false;
 	
-	_timer.setTimerPeriod(_transitionEventID, period);
+	if (_commitPending) {
+		commitOutput();
+	}
+}
+
+
+bool RgbStrip::isDoubleBuffered() {
+	return _doubleBuffered;
 }
 
 
 /**
-* Get the transition period for the led strip  
-* @return Period between transition timer events in ms
+* Get the duration of the last commit
+* @return Time taken to write the back buffer to the pins, in microseconds
 */
-long RgbStrip::getTransitionPeriod(){
-	return _timer.getTimerPeriod(_transitionEventID);
+unsigned long RgbStrip::getCommitTime() {
+	return _commitTime;
 }
 
 
 /**
-* Increase the time between transition events by a set amount 
-* (default/TRANSITION_PERIOD_STEP: 2ms)  
+* Get the longest commit since the counters were reset
+* Use this to budget the update rate: a frame costs at least this much on top of the timer events.
+* @return Longest time taken to write the back buffer to the pins, in microseconds
 */
-void RgbStrip::increaseTransitionPeriod(){
-	setTransitionPeriod(getTransitionPeriod() + TRANSITION_PERIOD_STEP);
+unsigned long RgbStrip::getMaxCommitTime() {
+	return _maxCommitTime;
 }
 
 
 /**
-* Decrease the time between transition events by a set amount
-* (default/TRANSITION_PERIOD_STEP: 2ms)
-*/  
-void RgbStrip::decreaseTransitionPeriod(){
-	long transitionPeriod = getTransitionPeriod();
+* Hand the duty cycles of the strip to a function instead of writing them to the pins
+* The function is called wherever analogWrite() would be, and those calls are still counted
+* by getWriteCount(). Duty cycles already on the pins are not handed over again.
+* @param writer Function that takes each duty cycle, or NULL to write the pins with analogWrite()
+* @param context Pointer passed back to the function
+*/
+void RgbStrip::setOutputWriter(output_writer writer, void* context) {
+	_outputWriter = writer;
+	_outputContext = context;
+}
+
+
+// Brightness
+/**
+* Set the global intensity of the lights as a percentage.
+* Setting the brightness to zero will effectively turn the lights off.
+* The percentage is converted once into a scale factor out of 32768 so colour writes avoid dividing by 100.
+* @param percentage The percentage intensity of the lights. 100% is full brightness, whilst 0% is off
+*/
+void RgbStrip::setBrightness(int percentage) {
+	if (percentage > 100) {
+		percentage = 100;
+		} else if (percentage <= 0) {
+		percentage = 0;
+	}
+
+	_brightness = percentage;
+	_brightnessScale = ((uint32_t)percentage * 32768 + 50) / 100;
+	applyActiveColour();
+}
+
+
+/**
+* Return the current brightness of the led strip
+* @return Percentage brightness of the strip  
+*/
+int RgbStrip::getBrightness(){
+	return _brightness;
+}
+	
 	
-	transitionPeriod -= TRANSITION_PERIOD_STEP;
-	if(transitionPeriod < TRANSITION_PERIOD_STEP){
-		transitionPeriod = TRANSITION_PERIOD_STEP;
+/**
+* Select the curve used to map colour levels onto PWM duty cycles
+* CURVE_LINEAR writes levels unchanged. CURVE_GAMMA and CURVE_CIE_LIGHTNESS correct for the
+* eye's response so that fades and low brightness settings look even.
+* @param curve One of OUTPUT_CURVES (see RgbCurves.h). Unknown curves are ignored.
+*/
+void RgbStrip::setOutputCurve(byte curve){
+	if (curve < NUM_OUTPUT_CURVES){
+		_outputCurve = curve;
+		_outputCurveTable = (curve == CURVE_LINEAR) ? NULL : OUTPUT_CURVE_TABLES[curve - 1];
+	}
+}
+
+
+/**
+* Set the resolution of the PWM outputs
+* This does not change the hardware resolution; on boards that support it, call
+* analogWriteResolution() with the same number of bits. The colour pipeline always runs at 16 bits;
+* see setDitherMode() for how it is reduced to the output resolution.
+* @param bits Output resolution, from 1 to 16 bits. Default: RGBSTRIP_PWM_BITS (8)
+*/
+void RgbStrip::setOutputResolution(byte bits){
+	if (bits < 1){
+		bits = 1;
+	} else if (bits > 16){
+		bits = 16;
 	}
 	
-	setTransitionPeriod(transitionPeriod);
+	_outputBits = bits;
+	_red.error = 0;
+	_green.error = 0;
+	_blue.error = 0;
+	_ditherPending = false;
+	
+	// Duty cycles written at the old resolution can't be compared with new ones
+	_red.dutyValid = false;
+	_green.dutyValid = false;
+	_blue.dutyValid = false;
 }
 
 
 /**
-* Determine if transition events are enabled
-* @return True if events are allowed to occur; otherwise false  
+* Get the resolution of the PWM outputs
+* @return Output resolution in bits
 */
-bool RgbStrip::isTransitionsEnabled(){
-	return _timer.isEnabled(_transitionEventID);
+byte RgbStrip::getOutputResolution(){
+	return _outputBits;
 }
 
 
-//Strobe
 /**
-* Callback for the strobe timer event
-* The strobe event toggles the brightness between off and its initial value.  
+* Set how the 16-bit colour levels are reduced to the output resolution
+* DITHER_NONE (default) rounds each channel to the nearest output level and never rewrites it.
+* With DITHER_ERROR_DIFFUSION or DITHER_ORDERED, channels that fall between two output levels are
+* written again every RGBSTRIP_DITHER_PERIOD ms, alternating between the neighbouring levels so that
+* the average matches the 16-bit level. The frames run on a timer slot of their own, taken here and
+* given back when dithering is turned off, so they don't depend on how often update() is called.
+* @param mode One of DITHER_MODES. Unknown modes are ignored.
+* @return True if the mode was set; false if it is unknown, or dithering needs a timer slot and none was free
 */
-void RgbStrip::strobeEvent(){
-	if (_brightness == _strobeBrightness){
-		lightsOff();
-		}else{
-		setBrightness(_strobeBrightness);
+bool RgbStrip::setDitherMode(byte mode){
+	if (mode > DITHER_ORDERED){
+		return false;
+	}
+	
+	if (mode == DITHER_NONE && _ditherEventID >= 0){
+		_timer.deleteTimer(_ditherEventID);
+		_ditherEventID = -1;
+	} else if (mode != DITHER_NONE && _ditherEventID < 0){
+		_ditherEventID = _timer.setInterval(msToTicks(RGBSTRIP_DITHER_PERIOD), ditherEvent_wrapper, this);
+		if (_ditherEventID < 0){
+			return false;
+		}
+		_timer.disable(_ditherEventID);
 	}
+	
+	_ditherMode = mode;
+	_red.error = 0;
+	_green.error = 0;
+	_blue.error = 0;
+	applyActiveColour();
+	return true;
 }
 
 
 /**
-* Static method wrapper for strobe timer events  
+* Get the dither mode
+* @return One of DITHER_MODES
 */
-void RgbStrip::strobeEvent_wrapper(){
-	RgbStrip* thisInstance = (RgbStrip*) pt2Object;
-	
-	thisInstance->strobeEvent();
+byte RgbStrip::getDitherMode(){
+	return _ditherMode;
 }
 
 
 /**
-* Enable strobe timer events to occur  
+* Get the number of PWM writes made by this strip since the counters were reset
+* @return Number of analogWrite() calls
 */
-void RgbStrip::enableStrobe(){
-	_timer.enable(_strobeEventID);
-	_strobeBrightness = _brightness;
+unsigned long RgbStrip::getWriteCount(){
+	return _writeCount;
 }
 
 
 /**
-* Disable strobe timer events from occuring  
+* Get the number of channel writes that were skipped since the counters were reset
+* A write is skipped when the pin is already at the requested duty cycle, e.g. the channels that have
+* finished moving during a transition, or all channels when nothing has changed.
+* @return Number of skipped analogWrite() calls
 */
-void RgbStrip::disableStrobe(){
-	_timer.disable(_strobeEventID);
-	
-	// Ensure the lights are always on when disabling strobe
-	setBrightness(_strobeBrightness);
+unsigned long RgbStrip::getElidedWriteCount(){
+	return _elidedWriteCount;
+}
+
+
+/**
+* Reset the performed and skipped write counters and the commit timings to zero  
+*/
+void RgbStrip::resetWriteCounts(){
+	_writeCount = 0;
+	_elidedWriteCount = 0;
+	_commitTime = 0;
+	_maxCommitTime = 0;
+}
+
+
+/**
+* Get the curve used to map colour levels onto PWM duty cycles
+* @return One of OUTPUT_CURVES (see RgbCurves.h)
+*/
+byte RgbStrip::getOutputCurve(){
+	return _outputCurve;
+}
+
+
+/**
+* Attach a command parser
+* The parser reads a bounded number of bytes at the start of every update(), so commands take effect
+* in the same update that receives them.
+* @param parser Parser to run, or NULL to stop reading commands
+*/
+void RgbStrip::setCommandParser(RgbCommandParser* parser){
+	_commandParser = parser;
 }
 
 
 /**
-* Set the period between strobe timer events
-* @param period Time between strobe events in ms.  
+* Update timer to call events if needed  
+* Strips sharing a scheduler all run it; when nothing is due this is a single comparison.
 */
-void RgbStrip::setStrobePeriod(long period){
-	if(period < MINIMUM_STROBE_PERIOD){
-		period = MINIMUM_STROBE_PERIOD;
+void RgbStrip::update(){
+	if (_commandParser != NULL){
+		_commandParser->update();
+	}
+	
+	_timer.run();
+	
+	if (_sequencePlaying){
+		updateSequence();
+	}
+	
+	if (_fadeActive){
+		updateFade();
+	}
+	
+	if (_commitPending){
+		commitOutput();
 	}
-	_timer.setTimerPeriod(_strobeEventID, period);
 }
 
+/**
+* Get how long the sketch can sleep before update() next has work to do
+* Covers every timer on the strip's scheduler, so with a shared scheduler any strip gives the answer for all
+* of them, including the dither frames of strips that are dithering. Fades and pending commits or commands
+* need update() to be called continuously and return 0. Sleeping for longer than the result delays events;
+* waking early is always safe.
+* @return Time in ms until the next event, 0 if update() has work to do now, or RGBSTRIP_NO_EVENT if nothing is scheduled
+*/
+unsigned long RgbStrip::msUntilNextEvent(){
+	if (_fadeActive || _commitPending){
+		return 0;
+	}
+	
+	if (_commandParser != NULL && _commandParser->isInputWaiting()){
+		return 0;
+	}
+	
+	unsigned long next = RGBSTRIP_NO_EVENT;
+	
+	uint32_t ticks = _timer.nextDeadline();
+	if (ticks != SimpleTimer::NO_DEADLINE){
+		// Round up so the sketch doesn't wake just before the deadline
+		next = ticksToMs(ticks + SIMPLETIMER_TICKS_PER_MS - 1);
+	}
+	
+	// A sequence step holding its colour ends at a known time
+	if (_sequencePlaying){
+		uint32_t stepTime = millis() - _sequenceStepStart;
+		unsigned long stepLeft = (stepTime < _sequenceStepLength) ? _sequenceStepLength - stepTime : 0;
+		if (stepLeft < next){
+			next = stepLeft;
+		}
+	}
+	
+	return next;
+}
 
+// Transitions
 /**
-* Get the period between strobe timer events
-* @return Period between events in ms  
+* Transitions all colour channels towards the target colour
+* Changes to the active colour are applied immediately, once for all the steps
+* @param steps Number of steps to take, stopping early if the target is reached
 */
-long RgbStrip::getStrobePeriod(){
-	return _timer.getTimerPeriod(_strobeEventID);
+void RgbStrip::stepTowardsTargetColour(unsigned int steps) {
+	if (_hueTransition){
+		if (isTargetColourReached()){
+			return;
+		}
+		
+		for (unsigned int i = 0; i < steps && !isTargetColourReached(); i++){
+			stepTowardsTargetHsv();
+		}
+	} else {
+		for (unsigned int i = 0; i < steps && !isTargetColourReached(); i++){
+			stepTowardsRedTarget();
+			stepTowardsGreenTarget();
+			stepTowardsBlueTarget();
+		}
+	}
+
+	applyActiveColour();
 }
 
 
 /**
-* Increase the time between strobe timer events by a fixed amount
-* By default, increases are in 5ms increments (STROBE_STEP)   
+* Steps the active colour round the colour wheel towards the target colour
+* Hue moves by HUE_TRANSITION_STEP, saturation and value by TRANSITION_STEP. The colour is converted
+* back to RGB on every step without division (see hsvToRgb()), and lands exactly on the RGB target.
 */
-void RgbStrip::increaseStrobePeriod(){
-	setStrobePeriod(getStrobePeriod() + STROBE_STEP);
+void RgbStrip::stepTowardsTargetHsv() {
+	int16_t hueStep = hueDistance(_activeHsv.h, _targetHsv.h);
+	if (hueStep > HUE_TRANSITION_STEP){
+		hueStep = HUE_TRANSITION_STEP;
+	} else if (hueStep < -HUE_TRANSITION_STEP){
+		hueStep = -HUE_TRANSITION_STEP;
+	}
+	_activeHsv.h = wrapHue(_activeHsv.h + hueStep);
+	
+	if (_targetHsv.s > _activeHsv.s + TRANSITION_STEP){
+		_activeHsv.s += TRANSITION_STEP;
+	} else if (_targetHsv.s + TRANSITION_STEP < _activeHsv.s){
+		_activeHsv.s -= TRANSITION_STEP;
+	} else {
+		_activeHsv.s = _targetHsv.s;
+	}
+	
+	if (_targetHsv.v > _activeHsv.v + TRANSITION_STEP){
+		_activeHsv.v += TRANSITION_STEP;
+	} else if (_targetHsv.v + TRANSITION_STEP < _activeHsv.v){
+		_activeHsv.v -= TRANSITION_STEP;
+	} else {
+		_activeHsv.v = _targetHsv.v;
+	}
+	
+	if (_activeHsv.h == _targetHsv.h && _activeHsv.s == _targetHsv.s && _activeHsv.v == _targetHsv.v){
+		_activeColour = _targetColour;
+	} else {
+		_activeColour = toRGB16(hsvToRgb(_activeHsv));
+	}
 }
 
 
 /**
-* Decrease the time between strobe timer events by a fixed amount
-* By default, decreases are in 5ms increments (STROBE_STEP)
+* Set up a transition or fade in HSV space from the active colour to a target
+* Greys and black have no hue of their own, so they take the hue of the other end of the transition
+* instead of sweeping round the colour wheel from red.
+* @param target HSV colour of the target
 */
-void RgbStrip::decreaseStrobePeriod(){
-	long strobePeriod = getStrobePeriod();
+void RgbStrip::beginHueTransition(HSV target) {
+	if (target.h >= HUE_MAX){
+		target.h %= HUE_MAX;
+	}
 	
-	strobePeriod -= STROBE_STEP;
-	if(strobePeriod < MINIMUM_STROBE_PERIOD){
-		strobePeriod = MINIMUM_STROBE_PERIOD;
+	_activeHsv = rgbToHsv(toRGB(_activeColour));
+	if (_activeHsv.s == 0 || _activeHsv.v == 0){
+		_activeHsv.h = target.h;
+	} else if (target.s == 0 || target.v == 0){
+		target.h = _activeHsv.h;
 	}
 	
-	setStrobePeriod(strobePeriod);
+	_targetHsv = target;
+	_hueTransition = true;
 }
 
 
 /**
-* Determine whether strobe events are enabled
-* @return True if strobe events are enabled to occur; otherwise false.  
+* Determines if the active colour is the same as target colour
+* @return True if the active colour is the same as the target colour
 */
-bool RgbStrip::isStrobeEnabled(){
-	return _timer.isEnabled(_strobeEventID);
+bool RgbStrip::isTargetColourReached() {
+	bool targetReached = false;
+	if (_targetColour.r == _activeColour.r) {
+		if (_targetColour.g == _activeColour.g) {
+			if (_targetColour.b == _activeColour.b) {
+				targetReached = true;
+			}
+		}
+	}
+
+	return targetReached;
 }
 
 
-// Flash 
+/**
+* Steps the active red channel towards the target colour
+*/
+void RgbStrip::stepTowardsRedTarget() {
+	// If the difference between current and target level is less than the transition step, just apply the target level
+	if (_targetColour.r > _activeColour.r) {
+		if (_targetColour.r - _activeColour.r > TRANSITION_STEP_16) {
+			_activeColour.r += TRANSITION_STEP_16;
+			} else {
+			_activeColour.r = _targetColour.r;
+		}
+		} else if (_activeColour.r - _targetColour.r > TRANSITION_STEP_16) {
+		_activeColour.r -= TRANSITION_STEP_16;
+		} else {
+		_activeColour.r = _targetColour.r;
+	}
+}
+
 
 /**
-* Flash the led strip a specified number of times
-* The flash frequency is detemined by FLASH_PERIOD
-* @param numFlashes The amount of times the lights will flash  
+* Steps the active green channel towards the target colour
+*/
+void RgbStrip::stepTowardsGreenTarget() {
+	if (_targetColour.g > _activeColour.g) {
+		if (_targetColour.g - _activeColour.g > TRANSITION_STEP_16) {
+			_activeColour.g += TRANSITION_STEP_16;
+			} else {
+			_activeColour.g = _targetColour.g;
+		}
+		} else if (_activeColour.g - _targetColour.g > TRANSITION_STEP_16) {
+		_activeColour.g -= TRANSITION_STEP_16;
+		} else {
+		_activeColour.g = _targetColour.g;
+	}
+}
+
+
+/**
+* Steps the active blue channel towards the target colour
+*/
+void RgbStrip::stepTowardsBlueTarget() {
+	if (_targetColour.b > _activeColour.b) {
+		if (_targetColour.b - _activeColour.b > TRANSITION_STEP_16) {
+			_activeColour.b += TRANSITION_STEP_16;
+			} else {
+			_activeColour.b = _targetColour.b;
+		}
+		} else if (_activeColour.b - _targetColour.b > TRANSITION_STEP_16) {
+		_activeColour.b -= TRANSITION_STEP_16;
+		} else {
+		_activeColour.b = _targetColour.b;
+	}
+}
+
+
+/**
+* Start fading from the active colour to a new target colour
+* @param colour 16-bit colour code of the target colour
+* @param startTime Time at which the fade starts in ms
+* @param duration Length of the fade in ms; must not be zero
+* @param easing Easing function, or NULL for linear
 */
-void RgbStrip::flash(int numFlashes){
-	disableStrobe();
-	_strobeBrightness = _brightness;
+void RgbStrip::startFade(RGB16 colour, unsigned long startTime, unsigned long duration, easing_function easing) {
+	_targetColour = colour;
+	_fadeStartColour = _activeColour;
+	_fadeStartTime = startTime;
+	_fadeDuration = duration;
+	
+	// Work out the progress per ms once, so that updates only multiply
+	_fadeRate = (1UL << 31) / duration;
+	if (_fadeRate == 0){
+		_fadeRate = 1;
+	}
+	_fadeEasing = (easing != NULL) ? easing : easeLinear;
+	_fadeActive = true;
+	
+	if (_transitionSpace == COLOUR_SPACE_HSV){
+		beginHueTransition(rgbToHsv(toRGB(colour)));
+	} else {
+		_hueTransition = false;
+	}
+}
+
+
+/**
+* Set the active colour of a timed fade from the time elapsed since it started
+* Progress is a fraction of 32768 after easing, so (target - start) * progress fits in 32 bits for every channel.
+*/
+void RgbStrip::updateFade() {
+	// Taken in 32 bits so that it stays right when millis() wraps, also where unsigned long is wider
+	uint32_t elapsedTime = millis() - _fadeStartTime;
+	
+	if (elapsedTime >= _fadeDuration){
+		_fadeActive = false;
+		setActiveColour(_targetColour);
+		return;
+	}
 	
-	// Double the flash number to always give an even number of toggles
-	numFlashes  *= 2;
+	long progress = _fadeEasing((elapsedTime * _fadeRate) >> 16);
+	RGB16 colour;
+	if (_hueTransition){
+		HSV hsv;
+		hsv.h = wrapHue(_activeHsv.h + (int16_t)(hueDistance(_activeHsv.h, _targetHsv.h) * progress >> 15));
+		hsv.s = _activeHsv.s + (((long)_targetHsv.s - _activeHsv.s) * progress >> 15);
+		hsv.v = _activeHsv.v + (((long)_targetHsv.v - _activeHsv.v) * progress >> 15);
+		colour = toRGB16(hsvToRgb(hsv));
+	} else {
+		colour.r = _fadeStartColour.r + (((long)_targetColour.r - _fadeStartColour.r) * progress >> 15);
+		colour.g = _fadeStartColour.g + (((long)_targetColour.g - _fadeStartColour.g) * progress >> 15);
+		colour.b = _fadeStartColour.b + (((long)_targetColour.b - _fadeStartColour.b) * progress >> 15);
+	}
 	
-	_flashEventID = _timer.setTimer(FLASH_PERIOD, strobeEvent_wrapper, numFlashes);
-}
\ No newline at end of file
+	if (colour.r != _activeColour.r || colour.g != _activeColour.g || colour.b != _activeColour.b){
+		setActiveColour(colour);
+	}
+}
+
+
+/**
+* Callback event for the transition timer event
+* Steps the active colour one increment towards the target colour, plus one for every event that was
+* missed while loop() was busy, so transitions finish on time without a burst of catch-up events.
+* @param missed Number of transition events missed since the last one
+*/
+void RgbStrip::transitionEvent(unsigned int missed){
+	// Timed fades set the active colour themselves
+	if (!_fadeActive){
+		stepTowardsTargetColour(missed + 1);
+	}
+}
+
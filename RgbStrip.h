@@ -10,36 +10,117 @@
 #define RGBSTRIP_H_
 
 // Include
-#include <Arduino.h>
+#include "RgbHal.h"
 #include "RGB.h"
+#include "RgbCurves.h"
+#include "RgbEasing.h"
+#include "RgbSequence.h"
+#include "RgbEffect.h"
+#include "RgbPalette.h"
 #include "SimpleTimer.h"
+#include "StripControl.h"
 
-#define TRANSITION_STEP 1	// Transition step in levels
-#define TRANSITION_PERIOD_STEP 2	// Step for adjusting transition timer event period
-#define DEFAULT_TRANSITION_PERIOD 10    // How often (in ms) transition steps occur
+#define HUE_TRANSITION_STEP (6 * TRANSITION_STEP)	// Transition step in hue steps, when transitions run in HSV space
 
-#define BRIGHTNESS_INCREMENT 10	// Brightness increment in percentage
-#define DEFAULT_BRIGHTNESS 100	// Default brightness in percentage
+#define RGBSTRIP_NO_EVENT 0xFFFFFFFFUL	// Returned by msUntilNextEvent() when nothing is scheduled
 
-#define LOW_BRIGHTNESS 30	// Low brightness value in percentage
-#define FULL_BRIGHTNESS 100	// Full brightness value in percentage
+#ifndef RGBSTRIP_PWM_BITS
+#define RGBSTRIP_PWM_BITS 8	// Default PWM output resolution in bits
+#endif
 
-#define STROBE_STEP 5	// Strobe period increment step in ms
-#define DEFAULT_STROBE_PERIOD 100
-#define MINIMUM_STROBE_PERIOD 20	// Minimum half-cycle strobe period in ms. This translates to 25 Hz
+#ifndef RGBSTRIP_DITHER_PERIOD
+#define RGBSTRIP_DITHER_PERIOD 2	// Time between temporal dither frames in ms
+#endif
 
-#define FLASH_PERIOD 200
+/**
+* Ways of reducing the 16-bit colour pipeline to the PWM output resolution
+*/
+enum DITHER_MODES{
+	DITHER_NONE = 0,	// Round to the nearest output level (default)
+	DITHER_ERROR_DIFFUSION = 1,	// Carry the rounding error of each channel into its next output
+	DITHER_ORDERED = 2	// Add a repeating 16-step threshold pattern over successive outputs
+};
+
+/**
+* Colour spaces that transitions and fades can move through
+*/
+enum COLOUR_SPACES{
+	COLOUR_SPACE_RGB = 0,	// Move each channel in a straight line (default)
+	COLOUR_SPACE_HSV = 1	// Move round the colour wheel the short way, keeping colours saturated
+};
+
+// Takes a duty cycle the strip would write to a pin (see setOutputWriter())
+typedef void (*output_writer)(void* context, int pin, uint16_t duty);
 
-class RgbStrip
+class RgbCommandParser;
+
+class RgbStrip : public StripControl
 {
 	public:
-	// Constructor
+	// Constructor. Timer events are scheduled on a timer of the strip's own
 	RgbStrip(int redPin, int greenPin, int bluePin);
 	
+	// Constructor. Timer events are scheduled on the given scheduler, which other strips can share
+	RgbStrip(int redPin, int greenPin, int bluePin, SimpleTimer& timer);
+	
+	// Scheduler that strips can share by passing it to the constructor
+	static SimpleTimer& sharedTimer();
+	
 	// Set the target colour. Colour will change instantly if transitions are disabled
 	void setTargetColour(RGB colour);
 	void setTargetColour(char colourCode);
 	void setTargetColour(int colourIndex);
+	void setTargetColour(const char* colourName);
+	
+	// Read indexed, coded and named colours from a palette (see RgbPalette.h). NULL restores the built in COLOURS
+	void setPalette(RgbPalette* palette);
+	
+	// Get the palette colours are read from, or NULL for the built in COLOURS
+	RgbPalette* getPalette();
+	
+	// Find a colour code in the current palette. Returns NO_COLOUR if there is no such code
+	byte getColourIndex(char colourCode);
+	
+	// Fade from the active colour to the target colour over the given time, independent of transition events
+	void setTargetColour(RGB colour, unsigned long duration);
+	
+	// Fade to the target colour over the given time, following an easing curve (see RgbEasing.h)
+	void setTargetColour(RGB colour, unsigned long duration, easing_function easing);
+	
+	// Set the target colour in HSV (see RGB.h). In COLOUR_SPACE_HSV the hue is followed exactly
+	void setTargetColourHsv(HSV colour);
+	void setTargetColourHsv(HSV colour, unsigned long duration);
+	void setTargetColourHsv(HSV colour, unsigned long duration, easing_function easing);
+	
+	// Choose the colour space transitions and fades move through (see COLOUR_SPACES)
+	void setTransitionSpace(byte space);
+	
+	// Get the colour space transitions and fades move through
+	byte getTransitionSpace();
+	
+	// Determine if a timed fade is in progress
+	bool isFading();
+	
+	// Play a sequence of keyframes stored in PROGMEM (see RgbSequence.h)
+	void playSequence(const Keyframe* keyframes, int numKeyframes, byte mode);
+	
+	// Play a packed effect in place from PROGMEM or RAM (see RgbEffect.h)
+	bool playEffect(const byte* data, size_t length, bool inProgmem, byte mode);
+	
+	// Stop the sequence, leaving the active colour where it is
+	void stopSequence();
+	
+	// Determine if a sequence is playing
+	bool isSequencePlaying();
+	
+	// Get the step of the sequence being played
+	int getSequenceStep();
+	
+	// Call a function whenever a sequence step starts
+	void setSequenceCallback(sequence_callback callback, void* context);
+	
+	// Get the colour currently displayed by the led strip (before brightness is applied)
+	RGB getActiveColour();
 
 	// Set the brightness of the led strip
 	void setBrightness(int percentage);
@@ -47,111 +128,190 @@ class RgbStrip
 	// Get the brightness value of the led strip
 	int getBrightness();
 	
-	// Set the brightness of the led strip to a low level
-	void setLowBrightness();
-	
-	// Set the brightness of the led strip to the maximum level
-	void setFullBrightness();
-	
-	// Set the brightness of the led strip to zero. (Turn them off)
-	void lightsOff();
-	
-	// Increase the brightness of the led strip by BRIGHTNESS_INCREMENT
-	void increaseBrightness();
-	
-	// Decrease the brightness of the led strip by BRIGHTNESS_INCREMENT
-	void decreaseBrightness();
+	// Select the output curve (see OUTPUT_CURVES in RgbCurves.h) applied to each channel before writing
+	void setOutputCurve(byte curve);
 	
-	// Enable transition timer events
-	void enableTransitions();
+	// Get the output curve applied to each channel
+	byte getOutputCurve();
 	
-	// Disabled transition timer events
-	void disableTransitions();
+	// Set the resolution of the PWM outputs in bits (1-16). Match analogWriteResolution() on boards that support it
+	void setOutputResolution(byte bits);
 	
-	// Set the period for the transition timer events
-	void setTransitionPeriod(long period);
+	// Get the resolution of the PWM outputs in bits
+	byte getOutputResolution();
 	
-	// Get the period for the transition timer events
-	long getTransitionPeriod();
+	// Set how levels are reduced to the output resolution (see DITHER_MODES). Returns false if dithering needs a timer slot and none was free
+	bool setDitherMode(byte mode);
 	
-	// Increase the period for transition timer events
-	void increaseTransitionPeriod();
+	// Get the dither mode
+	byte getDitherMode();
 	
-	// Decrease the period for transition timer events
-	void decreaseTransitionPeriod();
+	// Get the number of analogWrite() calls made by this strip
+	unsigned long getWriteCount();
 	
-	// Determine if transition timer events are enabled
-	bool isTransitionsEnabled();
+	// Get the number of channel writes skipped because the pin already had the same duty cycle
+	unsigned long getElidedWriteCount();
 	
-	// Enable strobe timer events
-	void enableStrobe();
+	// Reset the write counters and commit timings to zero
+	void resetWriteCounts();
 	
-	// Disable strobe timer events
-	void disableStrobe();
+	// Write output changes from update() in one commit instead of as they are made
+	void enableDoubleBuffering();
 	
-	// Set the toggle period for transition timer events
-	void setStrobePeriod(long period);
+	// Write output changes as they are made (default)
+	void disableDoubleBuffering();
 	
-	// Get the period between strobe timer events
-	long getStrobePeriod();
+	// Determine if output changes are written from update()
+	bool isDoubleBuffered();
 	
-	// Increase the period for strobe timer events by a fixed amount
-	void increaseStrobePeriod();
+	// Get the time taken by the last commit in microseconds
+	unsigned long getCommitTime();
 	
-	// Decrease the period for strobe timer events by a fixed amount
-	void decreaseStrobePeriod();
+	// Get the longest commit since the counters were reset, in microseconds
+	unsigned long getMaxCommitTime();
 	
-	// Determine if strobe timer events are enabled
-	bool isStrobeEnabled();
+	// Hand duty cycles to a function instead of writing them to the pins. NULL writes the pins again
+	void setOutputWriter(output_writer writer, void* context);
 	
-	// Flash the led strip the specified number of times
-	void flash(int numFlashes);
+	// Read commands from a stream on every update() (see RgbCommand.h). NULL detaches the parser
+	void setCommandParser(RgbCommandParser* parser);
 	
 	// Update timer status
 	void update();
 	
+	// Get the time in ms until update() next has work to do, 0 if it has work now, or RGBSTRIP_NO_EVENT if nothing is scheduled
+	unsigned long msUntilNextEvent();
+	
 	private:
 	
+	// Set up the pins, output pipeline and timer events
+	void init(int redPin, int greenPin, int bluePin);
+	
 	// Directly set the colour for the led strip to display
-	void setActiveColour(RGB colour);
+	void setActiveColour(RGB16 colour);
 	
 	// Update the active colour to the led strip
 	void applyActiveColour();
 	
-	// Write the specified colour to the led strip. Uses global brightness settings
-	void writeColour(RGB colour);
+	// Write the specified colour to the led strip, or leave it for the next commit. Uses global brightness settings
+	void writeColour(RGB16 colour);
+	
+	// Run a colour through the pipeline and write it to the pins
+	void latchColour(RGB16 colour);
+	
+	// Write the back buffer to the pins and time the commit
+	void commitOutput();
+	
+	// State of a single PWM output
+	struct OutputChannel {
+		int pin;
+		uint16_t level;	// Level after brightness and output curve, rescaled to 0-(2^bits - 1) output LSBs << (16 - bits)
+		uint16_t error;	// Error carried to the next output (DITHER_ERROR_DIFFUSION)
+		byte phase;	// Offset into the ordered dither pattern
+		uint16_t duty;	// Duty cycle last written to the pin
+		bool dutyValid;	// False until the pin has been written, or after the output resolution changes
+	};
+	
+	// Run a single 16-bit channel level through brightness and the output curve, and store it
+	void setChannelLevel(OutputChannel& channel, uint16_t level);
 	
-	// Step the active colour towards the target colour by TRANSITION_STEP levels
-	void stepTowardsTargetColour();
+	// Reduce the stored levels of all channels to the output resolution and write the ones that changed
+	void outputChannels();
+	
+	// Reduce the stored level of a channel to the output resolution. Returns true if its pin needs writing
+	bool reduceChannel(OutputChannel& channel);
+	
+	// Write the duty cycle of a channel to its pin
+	void writePin(OutputChannel& channel);
+	
+	// Output all channels again to advance temporal dithering
+	void refreshDither();
+	
+	// Run the dither timer only while a channel sits between two output levels
+	void scheduleDither();
+	
+	// Step the active colour towards the target colour by TRANSITION_STEP levels, the given number of times
+	void stepTowardsTargetColour(unsigned int steps);
 	
 	// Step the active colour towards the target colour by TRANSITION_STEP levels by channel
 	void stepTowardsRedTarget();
 	void stepTowardsGreenTarget();
 	void stepTowardsBlueTarget();
 	
+	// Step the active colour round the colour wheel towards the target colour (COLOUR_SPACE_HSV)
+	void stepTowardsTargetHsv();
+	
+	// Work out the HSV start and end points of a transition or fade to the given colour
+	void beginHueTransition(HSV target);
+	
 	// Determine if the active colour is the same as the target colour
 	bool isTargetColourReached();
 	
-	// Transition timer callback. Step the active colour towards the target.
-	void transitionEvent();
-	static void transitionEvent_wrapper();
+	// Start a timed fade from the active colour
+	void startFade(RGB16 colour, unsigned long startTime, unsigned long duration, easing_function easing);
+	
+	// Recalculate the active colour of a timed fade from the elapsed time
+	void updateFade();
+	
+	// Move to the next sequence step once the current one is over
+	void updateSequence();
+	
+	// Start the current sequence step at the given time
+	void startSequenceStep(unsigned long startTime);
+	
+	// Transition timer callback. Step the active colour towards the target, making up for missed events.
+	void transitionEvent(unsigned int missed);
 	
-	// Strobe timer callback.
-	void strobeEvent();
-	static void strobeEvent_wrapper();
+	// Dither timer callback. Missed frames are dropped; the next frame carries on the pattern.
+	static void ditherEvent_wrapper(void* instance, unsigned int missed);
 	
 	
-	int	_redPin;
-	int	_greenPin;
-	int _bluePin;
+	OutputChannel _red;
+	OutputChannel _green;
+	OutputChannel _blue;
 	int _brightness;
-	int _strobeBrightness;
-	RGB _activeColour;
-	RGB _targetColour;
-	SimpleTimer	_timer;
-	int _transitionEventID;
-	int _strobeEventID;
-	int _flashEventID;
+	uint16_t _brightnessScale;	// Brightness as a fraction of 32768
+	byte _outputCurve;
+	const uint16_t* _outputCurveTable;	// Row of OUTPUT_CURVE_TABLES in PROGMEM, NULL for CURVE_LINEAR
+	byte _outputBits;
+	byte _ditherMode;
+	byte _ditherStep;	// Position in the ordered dither pattern
+	bool _ditherPending;	// True if any channel has bits below the output resolution
+	unsigned long _writeCount;
+	unsigned long _elidedWriteCount;
+	bool _doubleBuffered;
+	bool _commitPending;	// The back buffer has changes that have not been written
+	unsigned long _commitTime;	// Duration of the last commit in microseconds
+	unsigned long _maxCommitTime;
+	output_writer _outputWriter;	// NULL to write the pins with analogWrite()
+	void* _outputContext;
+	RGB16 _activeColour;
+	RGB16 _targetColour;
+	RGB16 _fadeStartColour;
+	unsigned long _fadeStartTime;
+	unsigned long _fadeDuration;
+	unsigned long _fadeRate;	// Fade progress per ms, as a fraction of 2^31
+	easing_function _fadeEasing;
+	bool _fadeActive;
+	byte _transitionSpace;
+	bool _hueTransition;	// The current transition or fade runs in HSV space
+	HSV _activeHsv;	// Active colour of a transition, or start colour of a fade, in COLOUR_SPACE_HSV
+	HSV _targetHsv;
+	const Keyframe* _sequence;	// PROGMEM, or NULL while an effect is playing
+	EffectReader _effect;
+	int _sequenceLength;
+	int _sequenceStep;
+	int8_t _sequenceDirection;
+	byte _sequenceMode;
+	bool _sequencePlaying;
+	unsigned long _sequenceStepStart;
+	unsigned long _sequenceStepLength;	// Fade plus hold time of the current step
+	sequence_callback _sequenceCallback;
+	void* _sequenceContext;
+	RgbCommandParser* _commandParser;
+	RgbPalette* _palette;
+	SimpleTimer _ownTimer;	// Scheduler of a strip created without one
+	int _ditherEventID;	// Timer of the dither frames, or -1 with DITHER_NONE
 };
 
 
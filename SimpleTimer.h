@@ -28,39 +28,203 @@
 #ifndef SIMPLETIMER_H
 #define SIMPLETIMER_H
 
-#if defined(ARDUINO) && ARDUINO >= 100
-#include <Arduino.h>
-#else
-#include <WProgram.h>
+#include "RgbHal.h"
+
+// maximum number of timers in the default SimpleTimer, can be raised with a
+// build flag when a single scheduler is shared by many strips
+#ifndef SIMPLETIMER_MAX_TIMERS
+#define SIMPLETIMER_MAX_TIMERS 10
 #endif
 
 typedef void (*timer_callback)(void);
+typedef void (*timer_callback_p)(void *);
+
+// callback that is also told how many ticks were missed before this call
+// (see the OVERRUN_ constants)
+typedef void (*timer_callback_missed)(void *, unsigned int);
+
+// Select time function at compile time by defining SIMPLETIMER_CLOCK:
+//   SIMPLETIMER_CLOCK_MILLIS    millis(), periods are in ms (default)
+//   SIMPLETIMER_CLOCK_MICROS    micros(), periods are in us
+//   SIMPLETIMER_CLOCK_EXTERNAL  uint32_t simpleTimerClock() supplied by the
+//                               application; SIMPLETIMER_TICKS_PER_MS must
+//                               also be defined
+//
+// The clock is always read as a 32-bit count and compared by unsigned
+// difference, so schedules carry on across wraparound (every 49.7 days for
+// millis(), every 71.6 minutes for micros()) as long as no period is longer
+// than half the clock range, i.e. 2^31 - 1 ticks (about 35 minutes with
+// micros()).
+#define SIMPLETIMER_CLOCK_MILLIS 0
+#define SIMPLETIMER_CLOCK_MICROS 1
+#define SIMPLETIMER_CLOCK_EXTERNAL 2
+
+#ifndef SIMPLETIMER_CLOCK
+#define SIMPLETIMER_CLOCK SIMPLETIMER_CLOCK_MILLIS
+#endif
+
+#if SIMPLETIMER_CLOCK == SIMPLETIMER_CLOCK_MILLIS
+#define SIMPLETIMER_TICKS_PER_MS 1L
+#elif SIMPLETIMER_CLOCK == SIMPLETIMER_CLOCK_MICROS
+#define SIMPLETIMER_TICKS_PER_MS 1000L
+#elif SIMPLETIMER_CLOCK == SIMPLETIMER_CLOCK_EXTERNAL
+#ifndef SIMPLETIMER_TICKS_PER_MS
+#error "SIMPLETIMER_CLOCK_EXTERNAL needs SIMPLETIMER_TICKS_PER_MS"
+#endif
+
+uint32_t simpleTimerClock();
+#else
+#error "Unknown SIMPLETIMER_CLOCK"
+#endif
+
+// implementation details, not part of the public interface
+namespace SimpleTimerDetail {
+    // the selected clock, in ticks
+    inline uint32_t elapsed() {
+#if SIMPLETIMER_CLOCK == SIMPLETIMER_CLOCK_MILLIS
+        return millis();
+#elif SIMPLETIMER_CLOCK == SIMPLETIMER_CLOCK_MICROS
+        return micros();
+#else
+        return simpleTimerClock();
+#endif
+    }
+}
 
-class SimpleTimer {
+// convert between milliseconds and timer periods, for code that works in ms
+// whichever clock is selected
+static inline long msToTicks(long ms) {
+    return ms * SIMPLETIMER_TICKS_PER_MS;
+}
+
+static inline long ticksToMs(long ticks) {
+    return ticks / SIMPLETIMER_TICKS_PER_MS;
+}
+
+// smallest index type able to address every slot of a timer of the given
+// capacity (the largest value is reserved as the "not scheduled" marker)
+template <bool Small> struct SimpleTimerIndexSelect { typedef uint8_t type; };
+template <> struct SimpleTimerIndexSelect<false> { typedef uint16_t type; };
+
+template <unsigned int Capacity>
+struct SimpleTimerIndex : SimpleTimerIndexSelect<(Capacity < 0xFF)> {};
+
+// width of the deadlines kept for each slot of the default SimpleTimer:
+// 32 bits (default), or 16 bits to save 4 bytes of RAM per slot. With 16
+// bits only the low half of the clock is kept, so no period can be longer
+// than 32767 ticks (about 32 s with millis(), 32 ms with micros()). Like
+// SIMPLETIMER_MAX_TIMERS it must be set for the whole build.
+#ifndef SIMPLETIMER_TICK_BITS
+#define SIMPLETIMER_TICK_BITS 32
+#endif
+
+#if SIMPLETIMER_TICK_BITS == 32
+typedef uint32_t SimpleTimerTick;
+#elif SIMPLETIMER_TICK_BITS == 16
+typedef uint16_t SimpleTimerTick;
+#else
+#error "SIMPLETIMER_TICK_BITS must be 16 or 32"
+#endif
+
+// Timer scheduler with a fixed number of slots.
+//
+// Capacity is the number of timer slots and Index the integer type used to
+// address them; Index defaults to the narrowest type that fits. Tick is the
+// unsigned type that periods and deadlines are kept in; periods are limited
+// to MAX_PERIOD, half its range, so deadlines compare safely across
+// wraparound. Per-slot
+// state is stored as parallel arrays of the narrowest usable types, with
+// the enable and parameter flags packed into a single byte.
+//
+// Enabled timers are kept in a binary min-heap ordered by their next
+// deadline, so run() only has to look at the top of the heap when nothing
+// is due and costs O(log n) for every timer that fires.
+template <unsigned int Capacity, typename Index = typename SimpleTimerIndex<Capacity>::type, typename Tick = uint32_t>
+class SimpleTimerT {
 
 public:
     // maximum number of timers
-    const static int MAX_TIMERS = 10;
+    const static int MAX_TIMERS = Capacity;
+
+    // longest period in ticks; longer periods are shortened to this
+    const static long MAX_PERIOD = (long)((Tick)~(Tick)0 >> 1);
 
     // setTimer() constants
     const static int RUN_FOREVER = 0;
     const static int RUN_ONCE = 1;
 
+    // what a timer does when run() finds it one or more whole periods late,
+    // e.g. after loop() was blocked:
+    // OVERRUN_BURST     fire once per run() call, one period at a time,
+    //                   until the timer has caught up (default)
+    // OVERRUN_SKIP      fire once and drop the missed ticks, keeping the
+    //                   original phase
+    // OVERRUN_COALESCE  as OVERRUN_SKIP, and the number of missed ticks is
+    //                   passed to a timer_callback_missed callback so it can
+    //                   make up for them in one call (default for those)
+    // missed ticks count towards the runs of timers set with setTimer()
+    const static uint8_t OVERRUN_BURST = 0;
+    const static uint8_t OVERRUN_SKIP = 1;
+    const static uint8_t OVERRUN_COALESCE = 2;
+
     // constructor
-    SimpleTimer();
+    SimpleTimerT();
 
     // this function must be called inside loop()
+    // it keeps the list of due timers on the stack, sizeof(Index) + 2 bytes
+    // per slot: 30 bytes for the default 10 slots
     void run();
 
-    // call function f every d milliseconds
+    // returned by nextDeadline() when no timer is enabled
+    const static uint32_t NO_DEADLINE = 0xFFFFFFFFUL;
+
+    // ticks until the next enabled timer is due, 0 if one is already due,
+    // or NO_DEADLINE if none are enabled; run() has nothing to do until then
+    uint32_t nextDeadline();
+
+    // periods are in ticks of the selected clock: milliseconds by default,
+    // see SIMPLETIMER_CLOCK. Negative periods are taken as 0, i.e. every run()
+
+    // call function f every d ticks
     int setInterval(long d, timer_callback f);
 
-    // call function f once after d milliseconds
+    // call function f once after d ticks
     int setTimeout(long d, timer_callback f);
 
-    // call function f every d milliseconds for n times
+    // call function f every d ticks for n times
     int setTimer(long d, timer_callback f, int n);
 
+    // call function f with parameter p every d ticks
+    int setInterval(long d, timer_callback_p f, void* p);
+
+    // call function f with parameter p once after d ticks
+    int setTimeout(long d, timer_callback_p f, void* p);
+
+    // call function f with parameter p every d ticks for n times
+    int setTimer(long d, timer_callback_p f, void* p, int n);
+
+    // call function f with parameter p and the number of missed ticks
+    // every d ticks, coalescing missed ticks into one call
+    int setInterval(long d, timer_callback_missed f, void* p);
+
+    // call function f with parameter p and the number of missed ticks
+    // every d ticks for n times, coalescing missed ticks into one call
+    int setTimer(long d, timer_callback_missed f, void* p, int n);
+
+    // set what the specified timer does when it falls a whole period behind
+    void setOverrunPolicy(int numTimer, uint8_t policy);
+    uint8_t getOverrunPolicy(int numTimer);
+
+    // number of timer calls made a whole period or more after their
+    // deadline, i.e. with at least one tick missed (saturates at 65535)
+    uint16_t getLateCount() { return lateCount; };
+
+    // longest time in ticks between a deadline and the call it caused
+    uint32_t getMaxLateness() { return maxLateness; };
+
+    // clear the late count and maximum lateness
+    void resetLateness();
+
     // destroy the specified timer
     void deleteTimer(int numTimer);
 
@@ -90,38 +254,95 @@ public:
     long getTimerPeriod(int numTimer);
 
 private:
-    // deferred call constants
-    const static int DEFCALL_DONTRUN = 0;       // don't call the callback function
-    const static int DEFCALL_RUNONLY = 1;       // call the callback function but don't delete the timer
-    const static int DEFCALL_RUNANDDEL = 2;      // call the callback function and delete the timer
+    // heap position of a timer that is not scheduled
+    const static Index NOT_SCHEDULED = (Index)~(Index)0;
+
+    static_assert(Capacity > 0 && Capacity < (Index)~(Index)0,
+                  "SimpleTimerT index type is too narrow for its capacity");
+
+    static_assert((Tick)~(Tick)0 > 0 && sizeof(Tick) <= sizeof(uint32_t),
+                  "SimpleTimerT tick type must be unsigned and at most 32 bits");
+
+    // per-timer flags
+    struct TimerFlags {
+        uint8_t enabled : 1;    // timer is allowed to run
+        uint8_t hasParam : 1;   // callback takes a void* parameter
+        uint8_t limited : 1;    // timer is deleted after runsLeft more runs
+        uint8_t hasMissed : 1;  // callback also takes the missed tick count
+        uint8_t overrun : 2;    // OVERRUN_ policy
+    };
+
+    // returns true if the specified id refers to a timer in use
+    boolean isActive(int numTimer);
+
+    // deadline ordering, safe across clock wraparound
+    boolean isEarlier(Index a, Index b);
+
+    // heap maintenance
+    void heapInsert(Index numTimer);
+    void heapRemove(Index numTimer);
+    void heapUpdate(Index numTimer);
+    void heapSwap(Index a, Index b);
+    Index heapSiftUp(Index pos);
+    Index heapSiftDown(Index pos);
 
     // find the first available slot
     int findFirstFreeSlot();
 
-    // value returned by the millis() function
-    // in the previous run() call
-    unsigned long prev_millis[MAX_TIMERS];
+    // invoke the callback of the specified timer
+    void callTimer(Index numTimer, uint16_t missed);
+
+    // common setup for all setTimer() variants
+    int setupTimer(long d, void* f, void* p, boolean h, boolean m, int n);
+
+    // a period limited to 0..MAX_PERIOD
+    static Tick toPeriod(long d);
+
+    // the clock, cut down to Tick
+    static Tick now() { return (Tick)SimpleTimerDetail::elapsed(); };
+
+    // clock value at the start of the current period of each timer
+    // (named for the original millis() clock)
+    Tick prev_millis[Capacity];
 
     // pointers to the callback functions
-    timer_callback callbacks[MAX_TIMERS];
+    void* callbacks[Capacity];
+
+    // function parameters
+    void* params[Capacity];
 
     // delay values
-    long delays[MAX_TIMERS];
+    Tick delays[Capacity];
 
-    // number of runs to be executed for each timer
-    int maxNumRuns[MAX_TIMERS];
+    // number of runs left for timers with a limited number of runs
+    uint16_t runsLeft[Capacity];
 
-    // number of executed runs for each timer
-    int numRuns[MAX_TIMERS];
+    // enabled / has parameter / limited runs
+    TimerFlags flags[Capacity];
 
-    // which timers are enabled
-    boolean enabled[MAX_TIMERS];
+    // enabled timers, ordered by deadline (prev_millis + delays)
+    Index heap[Capacity];
 
-    // deferred function call (sort of) - N.B.: this array is only used in run()
-    int toBeCalled[MAX_TIMERS];
+    // position of each timer in heap[], or NOT_SCHEDULED
+    Index heapPos[Capacity];
+
+    // number of timers in heap[]
+    Index heapSize;
+
+    // overrun accounting, see getLateCount() and getMaxLateness()
+    uint16_t lateCount;
+    Tick maxLateness;
 
     // actual number of timers in use
-    int numTimers;
+    Index numTimers;
 };
 
-#endif
\ No newline at end of file
+// scheduler used by RgbStrip
+typedef SimpleTimerT<SIMPLETIMER_MAX_TIMERS, SimpleTimerIndex<SIMPLETIMER_MAX_TIMERS>::type, SimpleTimerTick> SimpleTimer;
+
+#include "SimpleTimerImpl.h"
+
+// the default scheduler is compiled once, in SimpleTimer.cpp
+extern template class SimpleTimerT<SIMPLETIMER_MAX_TIMERS, SimpleTimerIndex<SIMPLETIMER_MAX_TIMERS>::type, SimpleTimerTick>;
+
+#endif
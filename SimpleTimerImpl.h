@@ -0,0 +1,530 @@
+/*
+ * SimpleTimerImpl.h
+ *
+ * SimpleTimer - A timer library for Arduino.
+ * Author: mromani@ottotecnica.com
+ * Copyright (c) 2010 OTTOTECNICA Italy
+ *
+ * This library is free software; you can redistribute it
+ * and/or modify it under the terms of the GNU Lesser
+ * General Public License as published by the Free Software
+ * Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * This library is distributed in the hope that it will
+ * be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU Lesser General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser
+ * General Public License along with this library; if not,
+ * write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ * Template member definitions, included from SimpleTimer.h
+ */
+
+
+#ifndef SIMPLETIMERIMPL_H
+#define SIMPLETIMERIMPL_H
+
+template <unsigned int Capacity, typename Index, typename Tick>
+SimpleTimerT<Capacity, Index, Tick>::SimpleTimerT() {
+    Tick current_millis = now();
+
+    for (unsigned int i = 0; i < Capacity; i++) {
+        flags[i].enabled = false;
+        flags[i].hasParam = false;
+        flags[i].limited = false;
+        flags[i].hasMissed = false;
+        flags[i].overrun = OVERRUN_BURST;
+        callbacks[i] = 0; // if the callback pointer is zero, the slot is free, i.e. doesn't "contain" any timer
+        params[i] = 0;
+        prev_millis[i] = current_millis;
+        delays[i] = 0;
+        runsLeft[i] = 0;
+        heapPos[i] = NOT_SCHEDULED;
+    }
+
+    numTimers = 0;
+    heapSize = 0;
+    resetLateness();
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::run() {
+    Index i;
+    Index numDue;
+    Tick current_millis;
+
+    // timers that are due in this run, in deadline order, and the number of
+    // ticks each one missed. Every timer is rescheduled before any callback
+    // runs, so the list can't live in the per-slot arrays; it costs
+    // sizeof(Index) + 2 bytes of stack per slot instead of RAM for good
+    Index due[Capacity];
+    uint16_t dueMissed[Capacity];
+
+    // get current time
+    current_millis = now();
+
+    // pull every expired timer off the top of the heap; when nothing is
+    // due this is a single comparison
+    // see http://arduino.cc/forum/index.php/topic,124048.msg932592.html#msg932592
+    numDue = 0;
+    while (heapSize > 0) {
+        i = heap[0];
+        if ((Tick)(current_millis - prev_millis[i]) < delays[i]) {
+            break;
+        }
+
+        heapRemove(i);
+        due[numDue++] = i;
+    }
+
+    // update time and run counts, then put the timers back in the heap
+    // before calling anything so callbacks always see a consistent schedule
+    for (Index k = 0; k < numDue; k++) {
+        i = due[k];
+
+        // how long after its deadline this timer is being called
+        Tick late = current_millis - prev_millis[i] - delays[i];
+        uint32_t missed = 0;
+
+        if (late > maxLateness) {
+            maxLateness = late;
+        }
+
+        if (delays[i] > 0 && late >= delays[i]) {
+            if (lateCount < 0xFFFF) {
+                lateCount++;
+            }
+
+            // drop the missed ticks, keeping the phase
+            if (flags[i].overrun != OVERRUN_BURST) {
+                missed = late / delays[i];
+                if (flags[i].limited && missed >= runsLeft[i]) {
+                    missed = runsLeft[i] - 1;
+                }
+                prev_millis[i] += (Tick)(missed * delays[i]);
+            }
+        }
+
+        prev_millis[i] += delays[i];
+        dueMissed[k] = (missed > 0xFFFF) ? 0xFFFF : missed;
+
+        // "run forever" timers must always be executed;
+        // other timers get executed the specified number of times
+        if (flags[i].limited) {
+            runsLeft[i] -= 1 + missed;
+
+            // after the last run, the timer is deleted once it has been called
+            if (runsLeft[i] == 0) {
+                continue;
+            }
+        }
+
+        heapInsert(i);
+    }
+
+    for (Index k = 0; k < numDue; k++) {
+        i = due[k];
+        callTimer(i, dueMissed[k]);
+
+        if (flags[i].limited && runsLeft[i] == 0) {
+            deleteTimer(i);
+        }
+    }
+}
+
+
+// the earliest deadline is at the top of the heap
+
+template <unsigned int Capacity, typename Index, typename Tick>
+uint32_t SimpleTimerT<Capacity, Index, Tick>::nextDeadline() {
+    if (heapSize == 0) {
+        return NO_DEADLINE;
+    }
+
+    Index i = heap[0];
+    Tick since = now() - prev_millis[i];
+    if (since >= delays[i]) {
+        return 0;
+    }
+
+    return delays[i] - since;
+}
+
+
+// call the callback of the specified timer, passing its parameter if it has one
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::callTimer(Index numTimer, uint16_t missed) {
+    if (callbacks[numTimer] == NULL) {
+        return;
+    }
+
+    if (flags[numTimer].hasMissed) {
+        (*(timer_callback_missed)callbacks[numTimer])(params[numTimer], missed);
+    } else if (flags[numTimer].hasParam) {
+        (*(timer_callback_p)callbacks[numTimer])(params[numTimer]);
+    } else {
+        (*(timer_callback)callbacks[numTimer])();
+    }
+}
+
+
+// find the first available slot
+// return -1 if none found
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::findFirstFreeSlot() {
+    // all slots are used
+    if (numTimers >= Capacity) {
+        return -1;
+    }
+
+    // return the first slot with no callback (i.e. free)
+    for (unsigned int i = 0; i < Capacity; i++) {
+        if (callbacks[i] == 0) {
+            return i;
+        }
+    }
+
+    // no free slots found
+    return -1;
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setupTimer(long d, void* f, void* p, boolean h, boolean m, int n) {
+    int freeTimer;
+
+    freeTimer = findFirstFreeSlot();
+    if (freeTimer < 0) {
+        return -1;
+    }
+
+    if (f == NULL) {
+        return -1;
+    }
+
+    delays[freeTimer] = toPeriod(d);
+    callbacks[freeTimer] = f;
+    params[freeTimer] = p;
+    flags[freeTimer].hasParam = h;
+    flags[freeTimer].hasMissed = m;
+    flags[freeTimer].overrun = m ? (uint8_t)OVERRUN_COALESCE : (uint8_t)OVERRUN_BURST;
+    flags[freeTimer].limited = (n > RUN_FOREVER);
+    runsLeft[freeTimer] = (n > 0xFFFF) ? 0xFFFF : n;
+    flags[freeTimer].enabled = true;
+    prev_millis[freeTimer] = now();
+    heapInsert(freeTimer);
+
+    numTimers++;
+
+    return freeTimer;
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+Tick SimpleTimerT<Capacity, Index, Tick>::toPeriod(long d) {
+    if (d < 0) {
+        return 0;
+    }
+    if (d > MAX_PERIOD) {
+        return (Tick)MAX_PERIOD;
+    }
+
+    return (Tick)d;
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setTimer(long d, timer_callback f, int n) {
+    return setupTimer(d, (void *)f, NULL, false, false, n);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setTimer(long d, timer_callback_p f, void* p, int n) {
+    return setupTimer(d, (void *)f, p, true, false, n);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setInterval(long d, timer_callback f) {
+    return setupTimer(d, (void *)f, NULL, false, false, RUN_FOREVER);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setInterval(long d, timer_callback_p f, void* p) {
+    return setupTimer(d, (void *)f, p, true, false, RUN_FOREVER);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setTimer(long d, timer_callback_missed f, void* p, int n) {
+    return setupTimer(d, (void *)f, p, true, true, n);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setInterval(long d, timer_callback_missed f, void* p) {
+    return setupTimer(d, (void *)f, p, true, true, RUN_FOREVER);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setTimeout(long d, timer_callback f) {
+    return setupTimer(d, (void *)f, NULL, false, false, RUN_ONCE);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::setTimeout(long d, timer_callback_p f, void* p) {
+    return setupTimer(d, (void *)f, p, true, false, RUN_ONCE);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::deleteTimer(int timerId) {
+    if (timerId < 0 || timerId >= MAX_TIMERS) {
+        return;
+    }
+
+    // nothing to delete if no timers are in use
+    if (numTimers == 0) {
+        return;
+    }
+
+    // don't decrease the number of timers if the
+    // specified slot is already empty
+    if (callbacks[timerId] != NULL) {
+        heapRemove(timerId);
+
+        callbacks[timerId] = 0;
+        params[timerId] = 0;
+        flags[timerId].hasParam = false;
+        flags[timerId].enabled = false;
+        flags[timerId].limited = false;
+        flags[timerId].hasMissed = false;
+        flags[timerId].overrun = OVERRUN_BURST;
+        delays[timerId] = 0;
+        runsLeft[timerId] = 0;
+
+        // update number of timers
+        numTimers--;
+    }
+}
+
+
+// function contributed by code@rowansimms.com
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::restartTimer(int numTimer) {
+    if (!isActive(numTimer)) {
+        return;
+    }
+
+    prev_millis[numTimer] = now();
+    heapUpdate(numTimer);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+boolean SimpleTimerT<Capacity, Index, Tick>::isEnabled(int numTimer) {
+    if (!isActive(numTimer)) {
+        return false;
+    }
+
+    return flags[numTimer].enabled;
+}
+
+// Disabled timers are taken out of the heap. When they come back, the
+// deadline is moved forward by whole periods so the timer keeps the phase
+// it would have had if it had kept running.
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::enable(int numTimer) {
+    if (!isActive(numTimer) || flags[numTimer].enabled) {
+        return;
+    }
+
+    Tick current_millis = now();
+    Tick late = current_millis - prev_millis[numTimer];
+
+    if (delays[numTimer] == 0) {
+        prev_millis[numTimer] = current_millis;
+    } else if (late >= delays[numTimer]) {
+        prev_millis[numTimer] += late - (late % delays[numTimer]);
+    }
+
+    flags[numTimer].enabled = true;
+    heapInsert(numTimer);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::disable(int numTimer) {
+    if (!isActive(numTimer)) {
+        return;
+    }
+
+    flags[numTimer].enabled = false;
+    heapRemove(numTimer);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::toggle(int numTimer) {
+    if (!isActive(numTimer)) {
+        return;
+    }
+
+    if (flags[numTimer].enabled) {
+        disable(numTimer);
+    } else {
+        enable(numTimer);
+    }
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+int SimpleTimerT<Capacity, Index, Tick>::getNumTimers() {
+    return numTimers;
+}
+
+// Methods added by Leenix
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::setTimerPeriod(int numTimer, long period) {
+    if (isActive(numTimer)) {
+        delays[numTimer] = toPeriod(period);
+        heapUpdate(numTimer);
+    }
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+long SimpleTimerT<Capacity, Index, Tick>::getTimerPeriod(int numTimer) {
+    if (isActive(numTimer)) {
+        return delays[numTimer];
+    }
+
+    return 0;
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::setOverrunPolicy(int numTimer, uint8_t policy) {
+    if (isActive(numTimer) && policy <= OVERRUN_COALESCE) {
+        flags[numTimer].overrun = policy;
+    }
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+uint8_t SimpleTimerT<Capacity, Index, Tick>::getOverrunPolicy(int numTimer) {
+    if (isActive(numTimer)) {
+        return flags[numTimer].overrun;
+    }
+
+    return OVERRUN_BURST;
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::resetLateness() {
+    lateCount = 0;
+    maxLateness = 0;
+}
+
+
+// Deadline heap
+
+template <unsigned int Capacity, typename Index, typename Tick>
+boolean SimpleTimerT<Capacity, Index, Tick>::isActive(int numTimer) {
+    return numTimer >= 0 && numTimer < MAX_TIMERS && callbacks[numTimer] != NULL;
+}
+
+// a deadline is earlier if it lies less than half the clock range ahead of the other
+template <unsigned int Capacity, typename Index, typename Tick>
+boolean SimpleTimerT<Capacity, Index, Tick>::isEarlier(Index a, Index b) {
+    Tick deadlineA = prev_millis[a] + delays[a];
+    Tick deadlineB = prev_millis[b] + delays[b];
+
+    // i.e. the difference is negative in a signed Tick
+    return (Tick)(deadlineA - deadlineB) > (Tick)MAX_PERIOD;
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::heapSwap(Index a, Index b) {
+    Index timerA = heap[a];
+    Index timerB = heap[b];
+
+    heap[a] = timerB;
+    heap[b] = timerA;
+    heapPos[timerB] = a;
+    heapPos[timerA] = b;
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+Index SimpleTimerT<Capacity, Index, Tick>::heapSiftUp(Index pos) {
+    while (pos > 0) {
+        Index parent = (pos - 1) / 2;
+        if (!isEarlier(heap[pos], heap[parent])) {
+            break;
+        }
+
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+
+    return pos;
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+Index SimpleTimerT<Capacity, Index, Tick>::heapSiftDown(Index pos) {
+    for (;;) {
+        Index earliest = pos;
+        unsigned int left = 2 * (unsigned int)pos + 1;
+        unsigned int right = left + 1;
+
+        if (left < heapSize && isEarlier(heap[left], heap[earliest])) {
+            earliest = left;
+        }
+        if (right < heapSize && isEarlier(heap[right], heap[earliest])) {
+            earliest = right;
+        }
+        if (earliest == pos) {
+            return pos;
+        }
+
+        heapSwap(pos, earliest);
+        pos = earliest;
+    }
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::heapInsert(Index numTimer) {
+    if (heapPos[numTimer] != NOT_SCHEDULED) {
+        return;
+    }
+
+    heap[heapSize] = numTimer;
+    heapPos[numTimer] = heapSize;
+    heapSize++;
+    heapSiftUp(heapSize - 1);
+}
+
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::heapRemove(Index numTimer) {
+    Index pos = heapPos[numTimer];
+    if (pos == NOT_SCHEDULED) {
+        return;
+    }
+
+    heapSize--;
+    if (pos != heapSize) {
+        heapSwap(pos, heapSize);
+        heapSiftDown(heapSiftUp(pos));
+    }
+
+    heapPos[numTimer] = NOT_SCHEDULED;
+}
+
+// restore the heap order after the deadline of a scheduled timer changed
+template <unsigned int Capacity, typename Index, typename Tick>
+void SimpleTimerT<Capacity, Index, Tick>::heapUpdate(Index numTimer) {
+    Index pos = heapPos[numTimer];
+    if (pos == NOT_SCHEDULED) {
+        return;
+    }
+
+    heapSiftDown(heapSiftUp(pos));
+}
+
+#endif
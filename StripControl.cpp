@@ -0,0 +1,307 @@
+/*
+* StripControl.cpp
+*
+* Transition, strobe and flash events of a strip. See StripControl.h.
+*/
+
+#include "StripControl.h"
+
+
+/**
+* Constructor
+* The timer is only stored, so it may be a member of the strip that is not constructed yet.
+* @param timer Scheduler for the transition, strobe and flash events
+*/
+StripControl::StripControl(SimpleTimer& timer) : _timer(timer) {
+	_strobeBrightness = DEFAULT_BRIGHTNESS;
+	_transitionEventID = -1;
+	_strobeEventID = -1;
+	_flashEventID = -1;
+}
+
+
+/**
+* Schedule the transition and strobe events, and leave them disabled
+* Disabling the strobe restores the strobe brightness, so the strip must be ready for setBrightness().
+*/
+void StripControl::scheduleEvents() {
+	// Set up transition events
+	_transitionEventID = _timer.setInterval(msToTicks(DEFAULT_TRANSITION_PERIOD), transitionEvent_wrapper, this);
+	disableTransitions();
+
+	// Set up strobe events
+	_strobeEventID = _timer.setInterval(msToTicks(DEFAULT_STROBE_PERIOD), strobeEvent_wrapper, this);
+	disableStrobe();
+}
+
+
+/**
+* Determine if the strip's transition and strobe events were scheduled
+* Each strip takes two timer slots when it is created. If its scheduler was full, transitions and
+* strobing never run.
+* @return True if both events have a timer slot; false if the scheduler was full
+*/
+bool StripControl::isScheduled() {
+	return _transitionEventID >= 0 && _strobeEventID >= 0;
+}
+
+
+// Brightness
+/**
+* Set the brightness to a low level
+* This level is defined in StripControl.h. Default: 30%
+*/
+void StripControl::setLowBrightness() {
+	setBrightness(LOW_BRIGHTNESS);
+}
+
+
+/**
+* Set the global brightness to full
+*/
+void StripControl::setFullBrightness() {
+	setBrightness(FULL_BRIGHTNESS);
+}
+
+
+/**
+* Turn the lights off.
+* This is accomplished via setting brightness, rather than colour
+*/
+void StripControl::lightsOff() {
+	setBrightness(0);
+}
+
+
+/**
+* Increase the intensity of the LEDs by a fixed percentage
+* By default, this is by steps of 10%
+* Intensity will increase to a maximum of 100%
+*/
+void StripControl::increaseBrightness() {
+	setBrightness(getBrightness() + BRIGHTNESS_INCREMENT);
+}
+
+
+/**
+* Decrease the intensity of the LEDs by a fixed percentage
+* By default, this is by steps of 10%
+* Intensity will decrease to a minimum of 0%
+*/
+void StripControl::decreaseBrightness() {
+	setBrightness(getBrightness() - BRIGHTNESS_INCREMENT);
+}
+
+
+// Transitions
+/**
+* Static method wrapper for transition timer events
+* @param instance The strip that registered the timer event
+* @param missed Number of events missed since the last one
+*/
+void StripControl::transitionEvent_wrapper(void* instance, unsigned int missed) {
+	StripControl* thisInstance = (StripControl*) instance;
+
+	thisInstance->transitionEvent(missed);
+}
+
+
+/**
+* Enable timed transition events to occur
+*/
+void StripControl::enableTransitions() {
+	_timer.enable(_transitionEventID);
+}
+
+
+/**
+* Disable timed transition events
+*/
+void StripControl::disableTransitions() {
+	_timer.disable(_transitionEventID);
+}
+
+
+/**
+* Set the period for transition events
+* @param period Time between transition events in ms, at least TRANSITION_PERIOD_STEP
+*/
+void StripControl::setTransitionPeriod(long period) {
+	if (period < TRANSITION_PERIOD_STEP) {
+		period = TRANSITION_PERIOD_STEP;
+	}
+
+	_timer.setTimerPeriod(_transitionEventID, msToTicks(period));
+}
+
+
+/**
+* Get the transition period of the strip
+* @return Period between transition timer events in ms
+*/
+long StripControl::getTransitionPeriod() {
+	return ticksToMs(_timer.getTimerPeriod(_transitionEventID));
+}
+
+
+/**
+* Increase the time between transition events by a set amount
+* (default/TRANSITION_PERIOD_STEP: 2ms)
+*/
+void StripControl::increaseTransitionPeriod() {
+	setTransitionPeriod(getTransitionPeriod() + TRANSITION_PERIOD_STEP);
+}
+
+
+/**
+* Decrease the time between transition events by a set amount, down to TRANSITION_PERIOD_STEP
+* (default/TRANSITION_PERIOD_STEP: 2ms)
+*/
+void StripControl::decreaseTransitionPeriod() {
+	setTransitionPeriod(getTransitionPeriod() - TRANSITION_PERIOD_STEP);
+}
+
+
+/**
+* Determine if transition events are enabled
+* @return True if events are allowed to occur; otherwise false
+*/
+bool StripControl::isTransitionsEnabled() {
+	return _timer.isEnabled(_transitionEventID);
+}
+
+
+// Strobe
+/**
+* Callback for the strobe timer event
+* The strobe event toggles the brightness between off and its initial value.
+* Missed toggles are made up for, so the strobe stays in phase after loop() has been busy.
+* @param missed Number of strobe events missed since the last one
+*/
+void StripControl::strobeEvent(unsigned int missed) {
+	// An odd number of missed toggles cancels this one out
+	if (missed & 1) {
+		return;
+	}
+
+	if (getBrightness() == _strobeBrightness) {
+		lightsOff();
+	} else {
+		setBrightness(_strobeBrightness);
+	}
+}
+
+
+/**
+* Static method wrapper for strobe timer events
+* @param instance The strip that registered the timer event
+* @param missed Number of events missed since the last one
+*/
+void StripControl::strobeEvent_wrapper(void* instance, unsigned int missed) {
+	StripControl* thisInstance = (StripControl*) instance;
+
+	thisInstance->strobeEvent(missed);
+}
+
+
+/**
+* Enable strobe timer events to occur
+* The current brightness is kept as the strobe's on level. Does nothing if strobing is already enabled.
+*/
+void StripControl::enableStrobe() {
+	if (_timer.isEnabled(_strobeEventID)) {
+		return;
+	}
+	_timer.enable(_strobeEventID);
+	_strobeBrightness = getBrightness();
+}
+
+
+/**
+* Disable strobe timer events from occurring
+* Restores the brightness saved when strobing was enabled. Does nothing if strobing is not enabled.
+*/
+void StripControl::disableStrobe() {
+	if (!_timer.isEnabled(_strobeEventID)) {
+		return;
+	}
+	_timer.disable(_strobeEventID);
+
+	// Ensure the lights are always on when disabling strobe
+	setBrightness(_strobeBrightness);
+}
+
+
+/**
+* Set the period between strobe timer events
+* @param period Time between strobe events in ms, at least MINIMUM_STROBE_PERIOD
+*/
+void StripControl::setStrobePeriod(long period) {
+	if (period < MINIMUM_STROBE_PERIOD) {
+		period = MINIMUM_STROBE_PERIOD;
+	}
+	_timer.setTimerPeriod(_strobeEventID, msToTicks(period));
+}
+
+
+/**
+* Get the period between strobe timer events
+* @return Period between events in ms
+*/
+long StripControl::getStrobePeriod() {
+	return ticksToMs(_timer.getTimerPeriod(_strobeEventID));
+}
+
+
+/**
+* Increase the time between strobe timer events by a fixed amount
+* By default, increases are in 5ms increments (STROBE_STEP)
+*/
+void StripControl::increaseStrobePeriod() {
+	setStrobePeriod(getStrobePeriod() + STROBE_STEP);
+}
+
+
+/**
+* Decrease the time between strobe timer events by a fixed amount, down to MINIMUM_STROBE_PERIOD
+* By default, decreases are in 5ms increments (STROBE_STEP)
+*/
+void StripControl::decreaseStrobePeriod() {
+	setStrobePeriod(getStrobePeriod() - STROBE_STEP);
+}
+
+
+/**
+* Determine whether strobe events are enabled
+* @return True if strobe events are enabled to occur; otherwise false.
+*/
+bool StripControl::isStrobeEnabled() {
+	return _timer.isEnabled(_strobeEventID);
+}
+
+
+// Flash
+/**
+* Flash the strip a specified number of times
+* The flash frequency is determined by FLASH_PERIOD
+* @param numFlashes The amount of times the lights will flash, up to MAX_FLASHES
+* @return True if the flash started; false if numFlashes is not positive or no timer slot was free
+*/
+bool StripControl::flash(int numFlashes) {
+	// A timer with no runs would run forever, flashing endlessly and keeping its slot
+	if (numFlashes <= 0) {
+		return false;
+	}
+	if (numFlashes > MAX_FLASHES) {
+		numFlashes = MAX_FLASHES;
+	}
+
+	disableStrobe();
+	_strobeBrightness = getBrightness();
+
+	// Double the flash number to always give an even number of toggles
+	numFlashes *= 2;
+
+	_flashEventID = _timer.setTimer(msToTicks(FLASH_PERIOD), strobeEvent_wrapper, this, numFlashes);
+	return _flashEventID >= 0;
+}
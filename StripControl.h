@@ -0,0 +1,134 @@
+/*
+* StripControl.h
+*
+* Brightness shortcuts, transition, strobe and flash events shared by RgbStrip and PixelStrip.
+* A strip provides setBrightness(), getBrightness() and what a transition step does; the timer
+* events that drive them are scheduled and adjusted here.
+*/
+
+
+#ifndef STRIPCONTROL_H_
+#define STRIPCONTROL_H_
+
+#include "RgbHal.h"
+#include "SimpleTimer.h"
+
+#define TRANSITION_STEP 1	// Transition step in levels
+#define TRANSITION_PERIOD_STEP 2	// Step for adjusting transition timer event period
+#define DEFAULT_TRANSITION_PERIOD 10    // How often (in ms) transition steps occur
+
+#define BRIGHTNESS_INCREMENT 10	// Brightness increment in percentage
+#define DEFAULT_BRIGHTNESS 100	// Default brightness in percentage
+
+#define LOW_BRIGHTNESS 30	// Low brightness value in percentage
+#define FULL_BRIGHTNESS 100	// Full brightness value in percentage
+
+#define STROBE_STEP 5	// Strobe period increment step in ms
+#define DEFAULT_STROBE_PERIOD 100
+#define MINIMUM_STROBE_PERIOD 20	// Minimum half-cycle strobe period in ms. This translates to 25 Hz
+
+#define FLASH_PERIOD 200
+#define MAX_FLASHES 16383	// Most flashes one flash() call gives; each flash is two timer runs, counted in an int
+
+class StripControl
+{
+	public:
+	// Set the brightness of the strip as a percentage
+	virtual void setBrightness(int percentage) = 0;
+
+	// Get the brightness of the strip
+	virtual int getBrightness() = 0;
+
+	// Set the brightness of the strip to a low level
+	void setLowBrightness();
+
+	// Set the brightness of the strip to the maximum level
+	void setFullBrightness();
+
+	// Set the brightness of the strip to zero. (Turn the lights off)
+	void lightsOff();
+
+	// Increase the brightness of the strip by BRIGHTNESS_INCREMENT
+	void increaseBrightness();
+
+	// Decrease the brightness of the strip by BRIGHTNESS_INCREMENT
+	void decreaseBrightness();
+
+	// Determine if transition and strobe events got timer slots. False if the strip's scheduler was full
+	bool isScheduled();
+
+	// Enable transition timer events
+	void enableTransitions();
+
+	// Disable transition timer events
+	void disableTransitions();
+
+	// Set the period for the transition timer events
+	void setTransitionPeriod(long period);
+
+	// Get the period for the transition timer events
+	long getTransitionPeriod();
+
+	// Increase the period for transition timer events
+	void increaseTransitionPeriod();
+
+	// Decrease the period for transition timer events
+	void decreaseTransitionPeriod();
+
+	// Determine if transition timer events are enabled
+	bool isTransitionsEnabled();
+
+	// Enable strobe timer events
+	void enableStrobe();
+
+	// Disable strobe timer events
+	void disableStrobe();
+
+	// Set the toggle period for strobe timer events
+	void setStrobePeriod(long period);
+
+	// Get the period between strobe timer events
+	long getStrobePeriod();
+
+	// Increase the period for strobe timer events by a fixed amount
+	void increaseStrobePeriod();
+
+	// Decrease the period for strobe timer events by a fixed amount
+	void decreaseStrobePeriod();
+
+	// Determine if strobe timer events are enabled
+	bool isStrobeEnabled();
+
+	// Flash the strip the specified number of times. Returns false if the count is not positive or no timer slot was free
+	bool flash(int numFlashes);
+
+	protected:
+	// Constructor. Nothing is scheduled until scheduleEvents()
+	StripControl(SimpleTimer& timer);
+
+	// Schedule the transition and strobe events, both disabled. Called once the strip can take a brightness
+	void scheduleEvents();
+
+	// Transition timer callback. Step the colours towards their targets, making up for missed events
+	virtual void transitionEvent(unsigned int missed) = 0;
+
+	SimpleTimer& _timer;
+
+	private:
+	StripControl(const StripControl&);
+	StripControl& operator=(const StripControl&);
+
+	static void transitionEvent_wrapper(void* instance, unsigned int missed);
+
+	// Strobe timer callback. Missed events are coalesced, keeping the strobe in phase.
+	void strobeEvent(unsigned int missed);
+	static void strobeEvent_wrapper(void* instance, unsigned int missed);
+
+	int _strobeBrightness;
+	int _transitionEventID;
+	int _strobeEventID;
+	int _flashEventID;
+};
+
+
+#endif /* STRIPCONTROL_H_ */
@@ -0,0 +1,58 @@
+/*
+* Bench.cpp
+*
+* Timing helpers for the host benchmarks. See Bench.h.
+*/
+
+#include "Bench.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+namespace {
+	volatile unsigned long sink;
+}
+
+
+uint64_t Bench::nanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t Bench::cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+void Bench::heading(const char* title) {
+	printf("\n%s\n", title);
+}
+
+void Bench::report(const char* name, Result result) {
+	if (result.cycles > 0) {
+		printf("  %-48s %10.2f ns/call %10.1f cycles/call\n", name, result.ns, result.cycles);
+	} else {
+		printf("  %-48s %10.2f ns/call\n", name, result.ns);
+	}
+}
+
+void Bench::reportRate(const char* name, double perSecond, const char* unit) {
+	printf("  %-48s %10.3g %s/s\n", name, perSecond, unit);
+}
+
+void Bench::reportValue(const char* name, double value, const char* unit) {
+	printf("  %-48s %10.4g %s\n", name, value, unit);
+}
+
+void Bench::consume(unsigned long value) {
+	sink = value;
+}
@@ -0,0 +1,92 @@
+/*
+* Bench.h
+*
+* Timing helpers for the host benchmarks. Each benchmark file provides one
+* group of measurements; bench.cpp runs the groups named on the command line,
+* or all of them.
+*
+* Library code runs against the HostHal virtual clock, so only the work itself
+* is timed, never waiting for deadlines. Results are wall clock time per call
+* and, on x86, time stamp counter cycles per call.
+*/
+
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "RgbHal.h"
+
+#ifndef BENCH_MIN_TIME
+#define BENCH_MIN_TIME 200000000ULL	// Minimum measured time per result in ns
+#endif
+
+namespace Bench {
+	/**
+	* Cost of one call of a measured function
+	* @param ns Wall clock time per call in nanoseconds
+	* @param cycles Time stamp counter cycles per call, or 0 where there is no counter
+	*/
+	struct Result {
+		double ns;
+		double cycles;
+	};
+
+	// Monotonic wall clock in nanoseconds
+	uint64_t nanos();
+
+	// Time stamp counter, or 0 where there is none
+	uint64_t cycles();
+
+	// Print a section heading
+	void heading(const char* title);
+
+	// Print the cost per call of a measurement
+	void report(const char* name, Result result);
+
+	// Print a rate, e.g. writes per second
+	void reportRate(const char* name, double perSecond, const char* unit);
+
+	// Print a plain value
+	void reportValue(const char* name, double value, const char* unit);
+
+	// Keep a value alive so the computation producing it isn't optimised away
+	void consume(unsigned long value);
+
+	/**
+	* Measure the cost of a function
+	* The function is called in doubling batches until a batch takes BENCH_MIN_TIME.
+	* @param function Function or lambda taking no arguments
+	* @return Cost per call of the last batch
+	*/
+	template <typename Function>
+	Result measure(Function function) {
+		for (unsigned long calls = 16; ; calls *= 2) {
+			uint64_t startCycles = cycles();
+			uint64_t start = nanos();
+			for (unsigned long i = 0; i < calls; i++) {
+				function();
+			}
+			uint64_t time = nanos() - start;
+			uint64_t counted = cycles() - startCycles;
+
+			if (time >= BENCH_MIN_TIME || calls >= (1UL << 30)) {
+				Result result;
+				result.ns = (double) time / calls;
+				result.cycles = (double) counted / calls;
+				return result;
+			}
+		}
+	}
+
+	// Benchmark groups
+	void stripGroup();
+	void timerGroup();
+	void brightnessGroup();
+	void ditherGroup();
+	void easingGroup();
+	void blendGroup();
+	void idleGroup();
+	void controllerGroup();
+}
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,78 @@
+/*
+* BlendBench.cpp
+*
+* Pixel transition throughput: the batched blendTowards() kernel against the per-byte loop
+* PixelStrip used before it, at common strip lengths.
+*/
+
+#include "Bench.h"
+#include "RgbBlend.h"
+
+#include <stdio.h>
+
+
+namespace {
+	// The original PixelStrip::stepTowardsTargetColours(): one branchy step per channel
+	__attribute__((noinline)) bool stepByByte(byte* active, const byte* target, uint16_t length, byte step) {
+		bool changed = false;
+		for (uint16_t i = 0; i < length; i++) {
+			byte a = active[i];
+			byte t = target[i];
+			if (a == t) {
+				continue;
+			}
+
+			if (t > a) {
+				active[i] = (t - a > step) ? a + step : t;
+			} else {
+				active[i] = (a - t > step) ? a - step : t;
+			}
+			changed = true;
+		}
+		return changed;
+	}
+
+
+	// Time one transition step over a strip, in pixels per second
+	template<typename Kernel>
+	double pixelRate(uint16_t numPixels, Kernel kernel) {
+		uint16_t length = numPixels * 3;
+		byte* active = new byte[length];
+		byte* targets[2] = {new byte[length], new byte[length]};
+		for (uint16_t i = 0; i < length; i++) {
+			active[i] = i * 7;
+			targets[0][i] = i * 13;
+			targets[1][i] = 255 - i * 13;
+		}
+
+		// Targets swap every call, so channels keep moving in both directions
+		unsigned long calls = 0;
+		Bench::Result result = Bench::measure([&]() {
+			Bench::consume(kernel(active, targets[++calls & 1], length, 1));
+		});
+
+		delete[] active;
+		delete[] targets[0];
+		delete[] targets[1];
+		return numPixels * 1e9 / result.ns;
+	}
+}
+
+
+/**
+* Pixels stepped per second by each version at 60, 300 and 1000 pixels
+*/
+void Bench::blendGroup() {
+	char label[64];
+	snprintf(label, sizeof(label), "Pixel transitions (blendTowards: %s)", blendImplementation());
+	heading(label);
+
+	const uint16_t LENGTHS[] = {60, 300, 1000};
+	for (unsigned int i = 0; i < sizeof(LENGTHS) / sizeof(LENGTHS[0]); i++) {
+		snprintf(label, sizeof(label), "%u px, per-byte loop (original)", LENGTHS[i]);
+		reportRate(label, pixelRate(LENGTHS[i], stepByByte), "pixels");
+
+		snprintf(label, sizeof(label), "%u px, blendTowards()", LENGTHS[i]);
+		reportRate(label, pixelRate(LENGTHS[i], blendTowards), "pixels");
+	}
+}
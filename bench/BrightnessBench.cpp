@@ -0,0 +1,92 @@
+/*
+* BrightnessBench.cpp
+*
+* Cost of applying brightness to a colour write: the original division by 100 against the
+* fixed-point factor writeColour() uses now, and the whole write at several brightness levels.
+*/
+
+#include "Bench.h"
+#include "RgbStrip.h"
+
+#include <stdio.h>
+
+
+namespace {
+	volatile int brightnessSetting = 37;
+
+	// The original writeColour() scaling: three divisions by 100 per write
+	__attribute__((noinline)) unsigned long scaleByDivision(const RGB* colours, int count, int brightness) {
+		unsigned long sum = 0;
+		for (int i = 0; i < count; i++) {
+			sum += (colours[i].r * brightness) / 100;
+			sum += (colours[i].g * brightness) / 100;
+			sum += (colours[i].b * brightness) / 100;
+		}
+		return sum;
+	}
+
+	// The current scaling: a factor out of 32768 worked out once by setBrightness(), then a multiply and a shift
+	__attribute__((noinline)) unsigned long scaleByFactor(const RGB16* colours, int count, uint16_t scale) {
+		unsigned long sum = 0;
+		for (int i = 0; i < count; i++) {
+			sum += ((uint32_t)colours[i].r * scale) >> 15;
+			sum += ((uint32_t)colours[i].g * scale) >> 15;
+			sum += ((uint32_t)colours[i].b * scale) >> 15;
+		}
+		return sum;
+	}
+}
+
+
+/**
+* Time brightness scaling per colour write
+* The kernels are timed over 256 colours per call and reported per colour. On the host the
+* compiler turns division by a constant into a multiply, so the gap here understates the one on
+* AVR, where each division is a call to a software routine.
+*/
+void Bench::brightnessGroup() {
+	heading("Brightness");
+	const int NUM = 256;
+	RGB colours[NUM];
+	RGB16 colours16[NUM];
+	for (int i = 0; i < NUM; i++) {
+		colours[i].r = i;
+		colours[i].g = i * 7;
+		colours[i].b = 255 - i;
+		colours16[i] = toRGB16(colours[i]);
+	}
+
+	int brightness = brightnessSetting;
+	uint16_t scale = ((uint32_t)brightness * 32768 + 50) / 100;
+
+	Result division = measure([&]() {
+		consume(scaleByDivision(colours, NUM, brightness));
+	});
+	division.ns /= NUM;
+	division.cycles /= NUM;
+	report("scale one colour, (c * b) / 100 (original)", division);
+
+	Result factor = measure([&]() {
+		consume(scaleByFactor(colours16, NUM, scale));
+	});
+	factor.ns /= NUM;
+	factor.cycles /= NUM;
+	report("scale one colour, (c * factor) >> 15", factor);
+
+	// Whole writes through the strip, alternating colours so every write reaches the pins
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+
+	const int LEVELS[] = {100, 37, 1};
+	for (unsigned int i = 0; i < sizeof(LEVELS) / sizeof(LEVELS[0]); i++) {
+		char label[64];
+		snprintf(label, sizeof(label), "writeColour() at %d%% brightness", LEVELS[i]);
+		strip.setBrightness(LEVELS[i]);
+
+		unsigned long writes = 0;
+		report(label, measure([&]() {
+			strip.setTargetColour(colours[++writes & (NUM - 1)]);
+		}));
+	}
+}
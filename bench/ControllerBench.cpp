@@ -0,0 +1,118 @@
+/*
+* ControllerBench.cpp
+*
+* Contention on RgbStripController's multi-producer queue: 1 to 8 threads sending commands as
+* fast as they can while a render thread applies them.
+*/
+
+#include "Bench.h"
+#include "RgbController.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+
+namespace {
+	// Commands each producer sends
+	const unsigned long COMMANDS_PER_PRODUCER = 50000;
+
+	const int MAX_PRODUCERS = 8;
+
+	struct Producer {
+		RgbStripController* controller;
+		bool* go;
+		byte id;
+		unsigned long retries;	// Sends refused because the queue was full
+	};
+
+
+	// Back off briefly, so a full or empty queue doesn't keep a core spinning
+	void backOff() {
+		struct timespec ts;
+		ts.tv_sec = 0;
+		ts.tv_nsec = 50000;
+		nanosleep(&ts, NULL);
+	}
+
+
+	void* produce(void* context) {
+		Producer* producer = (Producer*) context;
+		while (!__atomic_load_n(producer->go, __ATOMIC_ACQUIRE)) {
+			backOff();
+		}
+
+		for (unsigned long i = 0; i < COMMANDS_PER_PRODUCER; i++) {
+			RGB colour = {producer->id, (byte) i, (byte)(i >> 8)};
+			while (!producer->controller->setTargetColour(colour)) {
+				producer->retries++;
+				backOff();
+			}
+		}
+
+		return NULL;
+	}
+
+
+	// Run the given number of producers against one render thread (this one)
+	void runProducers(int numProducers) {
+		HostHal::reset();
+		HostHal::setClockSource(HostHal::realMicros);
+		SimpleTimer timer;
+		RgbStrip strip(3, 5, 6, timer);
+		RgbStripController controller(strip);
+
+		bool go = false;
+		pthread_t threads[MAX_PRODUCERS];
+		Producer producers[MAX_PRODUCERS];
+		for (int i = 0; i < numProducers; i++) {
+			producers[i].controller = &controller;
+			producers[i].go = &go;
+			producers[i].id = i;
+			producers[i].retries = 0;
+			pthread_create(&threads[i], NULL, produce, &producers[i]);
+		}
+
+		unsigned long total = numProducers * COMMANDS_PER_PRODUCER;
+		unsigned long updates = 0;
+		uint64_t start = HostHal::realMicros();
+		__atomic_store_n(&go, true, __ATOMIC_RELEASE);
+
+		while (controller.getAppliedCount() < total) {
+			unsigned long before = controller.getAppliedCount();
+			controller.update();
+			updates++;
+			if (controller.getAppliedCount() == before) {
+				backOff();
+			}
+		}
+		double seconds = (HostHal::realMicros() - start) / 1e6;
+
+		unsigned long retries = 0;
+		for (int i = 0; i < numProducers; i++) {
+			pthread_join(threads[i], NULL);
+			retries += producers[i].retries;
+		}
+
+		char label[64];
+		snprintf(label, sizeof(label), "%d producer%s: commands applied", numProducers, numProducers > 1 ? "s" : "");
+		Bench::reportRate(label, total / seconds, "commands");
+		Bench::reportValue("  commands per update()", (double) total / updates, "");
+		Bench::reportValue("  full-queue retries per command", (double) retries / total, "");
+
+		HostHal::reset();
+	}
+}
+
+
+/**
+* Command throughput and queue pressure with 1, 2, 4 and 8 producer threads
+* Producers and the render thread back off for 50 us when the queue is full or empty, so the
+* figures depend on the number of cores; on a single core they mostly measure the scheduler.
+*/
+void Bench::controllerGroup() {
+	heading("RgbStripController (real clock)");
+	for (int producers = 1; producers <= MAX_PRODUCERS; producers *= 2) {
+		runProducers(producers);
+	}
+}
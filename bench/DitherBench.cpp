@@ -0,0 +1,44 @@
+/*
+* DitherBench.cpp
+*
+* Overhead temporal dithering adds to update(), for each dither mode.
+*/
+
+#include "Bench.h"
+#include "RgbStrip.h"
+
+#include <stdio.h>
+
+
+/**
+* Time update() while a colour sits between two output levels, with the clock moved on by a dither
+* frame before each call so every update() runs one, and the PWM writes that causes
+* Nothing else is scheduled, so the difference from DITHER_NONE is the cost of a dither frame.
+*/
+void Bench::ditherGroup() {
+	heading("Dithering");
+	static const char* const NAMES[] = {"none", "error diffusion", "ordered"};
+	const RGB colour = {200, 100, 50};
+
+	for (byte mode = DITHER_NONE; mode <= DITHER_ORDERED; mode++) {
+		HostHal::reset();
+		SimpleTimer timer;
+		RgbStrip strip(3, 5, 6, timer);
+		strip.setDitherMode(mode);
+		strip.setBrightness(7);
+		strip.setTargetColour(colour);
+
+		char label[64];
+		snprintf(label, sizeof(label), "dither frame, 7%% brightness, %s", NAMES[mode]);
+		unsigned long startWrites = HostHal::getWriteCount();
+		unsigned long calls = 0;
+		report(label, measure([&]() {
+			HostHal::advanceMillis(RGBSTRIP_DITHER_PERIOD);
+			strip.update();
+			calls++;
+		}));
+
+		snprintf(label, sizeof(label), "  pin writes per frame, %s", NAMES[mode]);
+		reportValue(label, (double)(HostHal::getWriteCount() - startWrites) / calls, "");
+	}
+}
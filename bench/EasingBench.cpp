@@ -0,0 +1,41 @@
+/*
+* EasingBench.cpp
+*
+* Evaluation cost of each easing curve.
+*/
+
+#include "Bench.h"
+#include "RgbEasing.h"
+
+
+/**
+* Time one evaluation of each curve, averaged over progress values spread across the whole fade
+* Curves are called through getEasingFunction(), as timed fades call them.
+*/
+void Bench::easingGroup() {
+	heading("Easing curves");
+	static const char* const NAMES[NUM_EASING_CURVES] = {
+		"linear",
+		"in quad", "out quad", "in-out quad",
+		"in cubic", "out cubic", "in-out cubic",
+		"in sine", "out sine", "in-out sine",
+		"in expo", "out expo", "in-out expo"
+	};
+	const unsigned int POINTS = 256;
+
+	for (byte curve = 0; curve < NUM_EASING_CURVES; curve++) {
+		easing_function easing = getEasingFunction(curve);
+
+		Result result = measure([&]() {
+			unsigned long sum = 0;
+			for (uint32_t progress = 0; progress < EASING_ONE; progress += EASING_ONE / POINTS) {
+				sum += easing(progress);
+			}
+			consume(sum);
+		});
+		result.ns /= POINTS;
+		result.cycles /= POINTS;
+
+		report(NAMES[curve], result);
+	}
+}
@@ -0,0 +1,83 @@
+/*
+* IdleBench.cpp
+*
+* How often loop() wakes up when it sleeps until RgbStrip::msUntilNextEvent() instead of polling
+* update(), on the real clock.
+*/
+
+#include "Bench.h"
+#include "RgbStrip.h"
+
+#include <stdio.h>
+
+
+namespace {
+	// Length of each run on the real clock, in microseconds
+	const uint64_t RUN_TIME = 1000000;
+
+	// Longest single sleep, as a sketch would cap it to stay responsive
+	const unsigned long MAX_SLEEP = 1000;
+
+
+	// Run loop() for RUN_TIME, either polling update() or sleeping between events
+	void runLoop(const char* name, RgbStrip& strip, bool sleep) {
+		HostHal::setClockSource(HostHal::realMicros);
+		unsigned long startWakeups = HostHal::getWakeupCount();
+		unsigned long loops = 0;
+		uint64_t start = HostHal::realMicros();
+		uint64_t now = start;
+
+		while (now - start < RUN_TIME) {
+			strip.update();
+			loops++;
+
+			if (sleep) {
+				unsigned long ms = strip.msUntilNextEvent();
+				if (ms > MAX_SLEEP) {
+					ms = MAX_SLEEP;
+				}
+				if (ms > 0) {
+					HostHal::idle(ms);
+				}
+			}
+			now = HostHal::realMicros();
+		}
+
+		double seconds = (now - start) / 1e6;
+		char label[64];
+		snprintf(label, sizeof(label), "%s, %s: loop() calls", name, sleep ? "sleeping" : "polling");
+		Bench::reportRate(label, loops / seconds, "calls");
+		if (sleep) {
+			snprintf(label, sizeof(label), "%s, sleeping: wakeups", name);
+			Bench::reportRate(label, (HostHal::getWakeupCount() - startWakeups) / seconds, "wakeups");
+		}
+	}
+}
+
+
+/**
+* loop() calls and wakeups per second with nothing scheduled, while strobing and during transitions
+* Each case runs for a second of real time, so this group takes several seconds.
+*/
+void Bench::idleGroup() {
+	heading("Idle (real clock)");
+	HostHal::reset();
+
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.setTargetColour(COLOURS[RED]);
+
+	runLoop("nothing scheduled", strip, false);
+	runLoop("nothing scheduled", strip, true);
+
+	strip.setStrobePeriod(100);
+	strip.enableStrobe();
+	runLoop("strobe, 100 ms", strip, false);
+	runLoop("strobe, 100 ms", strip, true);
+	strip.disableStrobe();
+
+	strip.enableTransitions();
+	runLoop("transitions enabled", strip, true);
+
+	HostHal::reset();
+}
@@ -0,0 +1,52 @@
+/*
+* StripBench.cpp
+*
+* Cost of the RgbStrip calls a sketch makes on every loop: update() and colour writes.
+*/
+
+#include "Bench.h"
+#include "RgbStrip.h"
+
+
+/**
+* Time update() and writeColour(), and the PWM write rate they sustain
+* writeColour() is private, so it is timed through setTargetColour() with transitions disabled,
+* which writes the new colour immediately.
+*/
+void Bench::stripGroup() {
+	heading("RgbStrip");
+	HostHal::reset();
+
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+
+	// Nothing scheduled: the per-loop overhead of an idle strip
+	report("update(), idle", measure([&]() {
+		strip.update();
+	}));
+
+	// A transition running, with the clock advanced 1 ms per call
+	strip.enableTransitions();
+	unsigned long calls = 0;
+	report("update(), transition running, 1 ms per call", measure([&]() {
+		if (++calls % 2600 == 0) {
+			strip.setTargetColour((calls / 2600) & 1 ? COLOURS[WHITE] : COLOURS[OFF]);
+		}
+		HostHal::advanceMillis(1);
+		strip.update();
+	}));
+	strip.disableTransitions();
+
+	// Alternating colours, so every call writes all three channels
+	RGB colours[2] = {{255, 128, 0}, {0, 64, 255}};
+	unsigned long writes = 0;
+	unsigned long startWrites = HostHal::getWriteCount();
+	Result write = measure([&]() {
+		strip.setTargetColour(colours[++writes & 1]);
+	});
+	report("writeColour() via setTargetColour(RGB)", write);
+
+	unsigned long pwmWrites = HostHal::getWriteCount() - startWrites;
+	reportRate("colour writes", 1e9 / write.ns, "writes");
+	reportValue("analogWrite() calls per colour write", (double) pwmWrites / writes, "");
+}
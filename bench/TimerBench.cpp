@@ -0,0 +1,148 @@
+/*
+* TimerBench.cpp
+*
+* Cost of SimpleTimer::run(), the scheduler every strip runs from update(), and of the deadline
+* heap against the linear scan it replaced.
+*/
+
+#include "Bench.h"
+#include "SimpleTimer.h"
+
+#include <stdio.h>
+
+
+namespace {
+	unsigned long fired;
+
+	void countFire(void*) {
+		fired++;
+	}
+
+	/**
+	* The original SimpleTimer::run(): every slot is checked on every call, then scanned again
+	* to make the calls. Cut down to interval timers, which is all the comparison needs.
+	*/
+	template <unsigned int Capacity>
+	class LinearScanTimer {
+		public:
+		LinearScanTimer() : numTimers(0) {
+			for (unsigned int i = 0; i < Capacity; i++) {
+				callbacks[i] = NULL;
+				enabled[i] = false;
+			}
+		}
+
+		int setInterval(long d, timer_callback_p f, void* p) {
+			if (numTimers >= Capacity) {
+				return -1;
+			}
+
+			callbacks[numTimers] = f;
+			params[numTimers] = p;
+			delays[numTimers] = d;
+			prev_millis[numTimers] = SimpleTimerDetail::elapsed();
+			enabled[numTimers] = true;
+			return numTimers++;
+		}
+
+		void run() {
+			uint32_t current_millis = SimpleTimerDetail::elapsed();
+
+			for (unsigned int i = 0; i < Capacity; i++) {
+				toBeCalled[i] = false;
+
+				if (callbacks[i] && current_millis - prev_millis[i] >= (uint32_t) delays[i]) {
+					prev_millis[i] += delays[i];
+					toBeCalled[i] = enabled[i];
+				}
+			}
+
+			for (unsigned int i = 0; i < Capacity; i++) {
+				if (toBeCalled[i]) {
+					callbacks[i](params[i]);
+				}
+			}
+		}
+
+		private:
+		timer_callback_p callbacks[Capacity];
+		void* params[Capacity];
+		uint32_t prev_millis[Capacity];
+		long delays[Capacity];
+		bool enabled[Capacity];
+		bool toBeCalled[Capacity];
+		unsigned int numTimers;
+	};
+
+
+	/**
+	* Time run() of a full scheduler, idle and with one timer due per call
+	* The other timers are due far in the future, like strips whose transitions are not running.
+	*/
+	template <typename Timer>
+	void compareRun(const char* name, Timer& timer, int capacity) {
+		char label[64];
+		HostHal::reset();
+
+		for (int i = 0; i < capacity - 1; i++) {
+			timer.setInterval(msToTicks(1000000L + i), countFire, NULL);
+		}
+
+		snprintf(label, sizeof(label), "%s, %d timers, nothing due", name, capacity);
+		Bench::report(label, Bench::measure([&]() {
+			timer.run();
+		}));
+
+		timer.setInterval(msToTicks(1), countFire, NULL);
+		snprintf(label, sizeof(label), "%s, %d timers, one due per call", name, capacity);
+		Bench::report(label, Bench::measure([&]() {
+			HostHal::advanceMillis(1);
+			timer.run();
+		}));
+	}
+
+	template <unsigned int Capacity>
+	void compareCapacity() {
+		static SimpleTimerT<Capacity> heap;
+		static LinearScanTimer<Capacity> scan;
+		compareRun("heap", heap, Capacity);
+		compareRun("linear scan", scan, Capacity);
+	}
+}
+
+
+/**
+* Time run() with a full scheduler, when nothing is due and when a timer fires on every call
+*/
+void Bench::timerGroup() {
+	heading("SimpleTimer");
+	HostHal::reset();
+
+	SimpleTimer timer;
+	for (int i = 0; i < SimpleTimer::MAX_TIMERS - 1; i++) {
+		timer.setInterval(msToTicks(1000000L + i), countFire, NULL);
+	}
+
+	report("run(), nothing due", measure([&]() {
+		timer.run();
+	}));
+
+	// One more timer, due on every call
+	timer.setInterval(msToTicks(1), countFire, NULL);
+	fired = 0;
+	Result firing = measure([&]() {
+		HostHal::advanceMillis(1);
+		timer.run();
+	});
+	report("run(), one timer due per call", firing);
+
+	// Pointers are wider here than on AVR, so only the difference carries over: 4 bytes per slot
+	reportValue("sizeof, 10 slots, 32-bit deadlines", sizeof(SimpleTimerT<10, uint8_t, uint32_t>), "B");
+	reportValue("sizeof, 10 slots, 16-bit deadlines", sizeof(SimpleTimerT<10, uint8_t, uint16_t>), "B");
+
+	heading("SimpleTimer run(): deadline heap against the original linear scan");
+	compareCapacity<10>();
+	compareCapacity<100>();
+	compareCapacity<500>();
+	consume(fired);
+}
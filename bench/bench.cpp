@@ -0,0 +1,78 @@
+/*
+* bench.cpp
+*
+* Host benchmark driver.
+*
+* Usage:
+*   rgbstrip_bench             Run every group
+*   rgbstrip_bench strip ...   Run the named groups
+*/
+
+#include "Bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+/**
+* A named set of measurements
+*/
+struct BenchGroup {
+	const char* name;
+	void (*run)();
+};
+
+static const BenchGroup GROUPS[] = {
+	{"strip", Bench::stripGroup},
+	{"timer", Bench::timerGroup},
+	{"brightness", Bench::brightnessGroup},
+	{"dither", Bench::ditherGroup},
+	{"easing", Bench::easingGroup},
+	{"blend", Bench::blendGroup},
+	{"idle", Bench::idleGroup},
+	{"controller", Bench::controllerGroup}
+};
+
+static const int NUM_GROUPS = sizeof(GROUPS) / sizeof(GROUPS[0]);
+
+
+static bool isSelected(const char* name, int argc, char** argv) {
+	if (argc < 2) {
+		return true;
+	}
+
+	for (int arg = 1; arg < argc; arg++) {
+		if (strcmp(argv[arg], name) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+int main(int argc, char** argv) {
+	for (int arg = 1; arg < argc; arg++) {
+		bool known = false;
+		for (int group = 0; group < NUM_GROUPS; group++) {
+			known |= strcmp(argv[arg], GROUPS[group].name) == 0;
+		}
+
+		if (!known) {
+			fprintf(stderr, "unknown group '%s'; groups are:", argv[arg]);
+			for (int group = 0; group < NUM_GROUPS; group++) {
+				fprintf(stderr, " %s", GROUPS[group].name);
+			}
+			fprintf(stderr, "\n");
+			return 1;
+		}
+	}
+
+	for (int group = 0; group < NUM_GROUPS; group++) {
+		if (isSelected(GROUPS[group].name, argc, argv)) {
+			GROUPS[group].run();
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+/*
+* effect_encoder.cpp
+*
+* Converts a text cue list into the packed effect format of RgbEffect.h.
+*
+* Built by the host CMake build as effect_encoder, or by hand from the library directory:
+*   g++ -I. -o effect_encoder extras/effect_encoder/effect_encoder.cpp RgbEffect.cpp HostHal.cpp
+*
+* Usage:
+*   effect_encoder cues.txt show.rgbfx           Write a binary effect (for mmap or an SD card)
+*   effect_encoder -c NAME cues.txt show.h       Write a C header with the effect as a PROGMEM array
+*
+* Each line of the cue list holds one cue:
+*   red green blue brightness fadeTime holdTime [easing]
+* Colours are 0-255, brightness is a percentage, times are in ms and easing is an EASING_CURVES
+* number (default 0, linear). Blank lines and text after '#' are ignored.
+*
+* Every effect written is decoded again and compared with the cue list before the tool exits,
+* so a non-zero exit status means nothing usable was produced.
+*/
+
+#include "RgbEffect.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+
+static bool parseCues(FILE* input, std::vector<Keyframe>& cues) {
+	char line[256];
+	int lineNumber = 0;
+
+	while (fgets(line, sizeof(line), input) != NULL) {
+		lineNumber++;
+
+		char* comment = strchr(line, '#');
+		if (comment != NULL) {
+			*comment = '\0';
+		}
+
+		unsigned int r, g, b, brightness, fadeTime, holdTime, easing = 0;
+		int fields = sscanf(line, "%u %u %u %u %u %u %u", &r, &g, &b, &brightness, &fadeTime, &holdTime, &easing);
+		if (fields <= 0) {
+			continue;
+		}
+		if (fields < 6 || r > 255 || g > 255 || b > 255 || brightness > 100 || fadeTime > 0xFFFF
+				|| holdTime > 0xFFFF || easing >= NUM_EASING_CURVES) {
+			fprintf(stderr, "line %d: expected 'red green blue brightness fadeTime holdTime [easing]'\n", lineNumber);
+			return false;
+		}
+
+		Keyframe cue;
+		cue.colour.r = r;
+		cue.colour.g = g;
+		cue.colour.b = b;
+		cue.brightness = brightness;
+		cue.fadeTime = fadeTime;
+		cue.holdTime = holdTime;
+		cue.easing = easing;
+		cues.push_back(cue);
+	}
+
+	if (cues.size() > 0xFFFF) {
+		fprintf(stderr, "too many cues (%u, at most 65535)\n", (unsigned int) cues.size());
+		return false;
+	}
+
+	return true;
+}
+
+static bool sameCue(const Keyframe& a, const Keyframe& b) {
+	return a.colour.r == b.colour.r && a.colour.g == b.colour.g && a.colour.b == b.colour.b
+			&& a.brightness == b.brightness && a.fadeTime == b.fadeTime && a.holdTime == b.holdTime
+			&& a.easing == b.easing;
+}
+
+// Decode an encoded effect and check it reproduces the cue list exactly
+static bool verify(const std::vector<Keyframe>& cues, const byte* data, size_t length) {
+	EffectReader reader;
+	if (!effectBegin(reader, data, length, false) || reader.numCues != cues.size()) {
+		return false;
+	}
+
+	Keyframe cue;
+	for (size_t i = 0; i < cues.size(); i++) {
+		if (!effectNextCue(reader, cue) || !sameCue(cue, cues[i])) {
+			fprintf(stderr, "cue %u does not round-trip\n", (unsigned int) i);
+			return false;
+		}
+	}
+
+	return !effectNextCue(reader, cue) && reader.position == reader.end;
+}
+
+static bool writeHeader(FILE* output, const char* name, const byte* data, size_t length) {
+	fprintf(output, "// Generated by effect_encoder\n");
+	fprintf(output, "const byte %s[] PROGMEM = {", name);
+	for (size_t i = 0; i < length; i++) {
+		fprintf(output, "%s0x%02X,", (i % 16 == 0) ? "\n\t" : " ", data[i]);
+	}
+	fprintf(output, "\n};\n");
+	return !ferror(output);
+}
+
+static int usage() {
+	fprintf(stderr, "usage: effect_encoder [-c NAME] CUES OUTPUT\n");
+	return 2;
+}
+
+
+int main(int argc, char** argv) {
+	const char* arrayName = NULL;
+	int arg = 1;
+
+	if (arg < argc && strcmp(argv[arg], "-c") == 0) {
+		if (arg + 1 >= argc) {
+			return usage();
+		}
+		arrayName = argv[arg + 1];
+		arg += 2;
+	}
+	if (argc - arg != 2) {
+		return usage();
+	}
+
+	FILE* input = fopen(argv[arg], "r");
+	if (input == NULL) {
+		perror(argv[arg]);
+		return 1;
+	}
+	std::vector<Keyframe> cues;
+	bool parsed = parseCues(input, cues);
+	fclose(input);
+	if (!parsed) {
+		return 1;
+	}
+
+	std::vector<byte> buffer(8 + cues.size() * EFFECT_MAX_CUE_SIZE);
+	size_t length = encodeEffect(cues.empty() ? NULL : &cues[0], cues.size(), &buffer[0], buffer.size());
+	if (length == 0 || !verify(cues, &buffer[0], length)) {
+		fprintf(stderr, "encoding failed\n");
+		return 1;
+	}
+
+	FILE* output = fopen(argv[arg + 1], arrayName != NULL ? "w" : "wb");
+	if (output == NULL) {
+		perror(argv[arg + 1]);
+		return 1;
+	}
+	bool written = (arrayName != NULL) ? writeHeader(output, arrayName, &buffer[0], length)
+			: fwrite(&buffer[0], 1, length, output) == length;
+	if (fclose(output) != 0 || !written) {
+		fprintf(stderr, "%s: write failed\n", argv[arg + 1]);
+		return 1;
+	}
+
+	fprintf(stderr, "%u cues, %u bytes (%u bytes as Keyframe array)\n", (unsigned int) cues.size(),
+			(unsigned int) length, (unsigned int) (cues.size() * sizeof(Keyframe)));
+	return 0;
+}
@@ -0,0 +1,84 @@
+/*
+* BlendTest.cpp
+*
+* blendTowards() against a plain per-byte step, for every active and target byte pair at every step
+* size. CMakeLists.txt builds it once per implementation the host can run; on ARM, build it with
+* RGBBLEND_ARM_SIMD defined (natively or under QEMU) to check the NEON and DSP versions.
+*/
+
+#include "TestCheck.h"
+#include "RgbBlend.h"
+
+#include <string.h>
+
+
+// One byte moved towards its target by at most step
+static byte reference(byte active, byte target, byte step) {
+	if (target > active) {
+		return (target - active > step) ? active + step : target;
+	}
+	return (active - target > step) ? active - step : target;
+}
+
+
+// Every (active, target) pair, one per byte, at every step size, starting at each offset so the
+// vector loads are misaligned and the scalar tail gets different lengths
+static void testAllPairs() {
+	static byte active[65536 + 16];
+	static byte target[65536 + 16];
+	long wrong = 0;
+
+	for (int step = 0; step < 256; step++) {
+		int offset = step % 16;
+		for (int a = 0; a < 256; a++) {
+			for (int t = 0; t < 256; t++) {
+				active[offset + a * 256 + t] = a;
+				target[offset + a * 256 + t] = t;
+			}
+		}
+
+		uint16_t length = 65535 - offset;
+		blendTowards(active + offset, target + offset, length, step);
+		for (long i = 0; i < length; i++) {
+			if (active[offset + i] != reference(i >> 8, i & 0xFF, step)) {
+				wrong++;
+			}
+		}
+	}
+	CHECK_EQUAL(0, wrong);
+}
+
+
+// The return value reports whether any byte moved, wherever in the buffer it is
+static void testChanged() {
+	byte active[67];
+	byte target[67];
+	memset(active, 100, sizeof(active));
+	memset(target, 100, sizeof(target));
+
+	CHECK(!blendTowards(active, target, sizeof(active), 5));
+	CHECK(!blendTowards(active, target, 0, 5));
+	CHECK(!blendTowards(active, target, sizeof(active), 0));
+
+	for (unsigned int i = 0; i < sizeof(active); i++) {
+		target[i] = 103;
+		CHECK(blendTowards(active, target, sizeof(active), 5));
+		CHECK_EQUAL(103, active[i]);
+		CHECK(!blendTowards(active, target, sizeof(active), 5));
+		target[i] = 100;
+		active[i] = 100;
+	}
+
+	// Nothing past length is touched
+	target[66] = 0;
+	blendTowards(active, target, 66, 255);
+	CHECK_EQUAL(100, active[66]);
+}
+
+
+int main() {
+	printf("blendTowards() implementation: %s\n", blendImplementation());
+	testAllPairs();
+	testChanged();
+	return TestCheck::result();
+}
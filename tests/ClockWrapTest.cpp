@@ -0,0 +1,188 @@
+/*
+* ClockWrapTest.cpp
+*
+* SimpleTimer schedules carry on across the wraparound of its 32-bit clock. CMakeLists.txt builds
+* this test once per SIMPLETIMER_CLOCK setting, so the same checks run against millis(), micros()
+* and an external clock; the external clock starts just short of 0xFFFFFFFF. A fourth build keeps
+* 16-bit deadlines (SIMPLETIMER_TICK_BITS), which wrap every 65536 ticks as well.
+*/
+
+#include "TestCheck.h"
+#include "SimpleTimer.h"
+
+
+// Clock ticks left before the 32-bit clock wraps when a test starts
+const uint32_t TICKS_BEFORE_WRAP = 1000 * SIMPLETIMER_TICKS_PER_MS;
+
+#if SIMPLETIMER_CLOCK == SIMPLETIMER_CLOCK_EXTERNAL
+static uint32_t externalClock;
+
+uint32_t simpleTimerClock() {
+	return externalClock;
+}
+#endif
+
+
+// Move the clock to a tick count, which may be past the 32-bit range
+static void setTicks(uint64_t ticks) {
+#if SIMPLETIMER_CLOCK == SIMPLETIMER_CLOCK_EXTERNAL
+	externalClock = (uint32_t) ticks;
+#else
+	HostHal::setMicros(ticks * 1000 / SIMPLETIMER_TICKS_PER_MS);
+#endif
+}
+
+
+// Ticks just short of the wrap, where every test starts
+static uint64_t startTicks() {
+	HostHal::reset();
+	uint64_t start = (1ULL << 32) - TICKS_BEFORE_WRAP;
+	setTicks(start);
+	CHECK_EQUAL(0xFFFFFFFFUL - TICKS_BEFORE_WRAP + 1, SimpleTimerDetail::elapsed());
+	return start;
+}
+
+
+struct FireLog {
+	int count;
+	uint32_t last;
+	uint32_t shortestGap;
+	uint32_t longestGap;
+};
+
+static void logFire(void* context) {
+	FireLog* log = (FireLog*) context;
+	uint32_t now = SimpleTimerDetail::elapsed();
+	if (log->count > 0) {
+		uint32_t gap = now - log->last;
+		log->shortestGap = (gap < log->shortestGap) ? gap : log->shortestGap;
+		log->longestGap = (gap > log->longestGap) ? gap : log->longestGap;
+	}
+	log->last = now;
+	log->count++;
+}
+
+
+// An interval keeps its period exactly while the clock wraps under it
+static void testInterval() {
+	uint64_t start = startTicks();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0xFFFFFFFF, 0};
+	timer.setInterval(msToTicks(10), logFire, &log);
+
+	// 3 s of loop() calls every 250 us, crossing the wrap after 1 s
+	for (uint64_t us = 250; us <= 3000000; us += 250) {
+		setTicks(start + us * SIMPLETIMER_TICKS_PER_MS / 1000);
+		timer.run();
+	}
+
+	CHECK_EQUAL(300, log.count);
+	CHECK_EQUAL(msToTicks(10), log.shortestGap);
+	CHECK_EQUAL(msToTicks(10), log.longestGap);
+}
+
+
+// A timeout due after the wrap neither fires early at the wrap nor is lost
+static void testTimeoutAcrossWrap() {
+	uint64_t start = startTicks();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0xFFFFFFFF, 0};
+	long delay = TICKS_BEFORE_WRAP + msToTicks(5);
+	timer.setTimeout(delay, logFire, &log);
+
+	setTicks(start + TICKS_BEFORE_WRAP - 1);
+	timer.run();
+	CHECK_EQUAL(msToTicks(5) + 1, timer.nextDeadline());
+	setTicks(start + TICKS_BEFORE_WRAP);
+	timer.run();
+	CHECK_EQUAL(msToTicks(5), timer.nextDeadline());
+	setTicks(start + delay - 1);
+	timer.run();
+	CHECK_EQUAL(0, log.count);
+	CHECK_EQUAL(1, timer.nextDeadline());
+
+	setTicks(start + delay);
+	timer.run();
+	CHECK_EQUAL(1, log.count);
+	CHECK_EQUAL((uint32_t) msToTicks(5), log.last);
+	CHECK_EQUAL(SimpleTimer::NO_DEADLINE, timer.nextDeadline());
+}
+
+
+// The longest period the scheduler supports, 2^31 - 1 ticks or 32767 with 16-bit deadlines, still works across the wrap
+static void testLongestPeriod() {
+	uint64_t start = startTicks();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0xFFFFFFFF, 0};
+	const long longest = SimpleTimer::MAX_PERIOD;
+	CHECK_EQUAL(SIMPLETIMER_TICK_BITS == 16 ? 0x7FFFL : 0x7FFFFFFFL, longest);
+
+	// Longer periods are cut down to it rather than wrapping
+	int id = timer.setInterval(longest + 1, logFire, &log);
+	CHECK_EQUAL(longest, timer.getTimerPeriod(id));
+	timer.setTimerPeriod(id, -5);
+	CHECK_EQUAL(0, timer.getTimerPeriod(id));
+	timer.deleteTimer(id);
+
+	timer.setInterval(longest, logFire, &log);
+
+	setTicks(start + longest - 1);
+	timer.run();
+	CHECK_EQUAL(0, log.count);
+	setTicks(start + longest);
+	timer.run();
+	CHECK_EQUAL(1, log.count);
+
+	// The second period ends after the clock has wrapped again
+	setTicks(start + 2ULL * longest - 1);
+	timer.run();
+	CHECK_EQUAL(1, log.count);
+	setTicks(start + 2ULL * longest);
+	timer.run();
+	CHECK_EQUAL(2, log.count);
+}
+
+
+// Timers set on either side of the wrap are still run in deadline order
+static void testOrderAcrossWrap() {
+	uint64_t start = startTicks();
+	SimpleTimer timer;
+	FireLog before = {0, 0, 0xFFFFFFFF, 0};
+	FireLog after = {0, 0, 0xFFFFFFFF, 0};
+
+	timer.setTimeout(TICKS_BEFORE_WRAP + msToTicks(20), logFire, &after);
+	setTicks(start + TICKS_BEFORE_WRAP + msToTicks(1));
+	timer.setTimeout(msToTicks(10), logFire, &before);
+
+	setTicks(start + TICKS_BEFORE_WRAP + msToTicks(11));
+	timer.run();
+	CHECK_EQUAL(1, before.count);
+	CHECK_EQUAL(0, after.count);
+	setTicks(start + TICKS_BEFORE_WRAP + msToTicks(20));
+	timer.run();
+	CHECK_EQUAL(1, after.count);
+
+	// A deadline just before the wrap comes ahead of one just after it, though its clock value is larger
+	start = startTicks();
+	FireLog early = {0, 0, 0xFFFFFFFF, 0};
+	FireLog late = {0, 0, 0xFFFFFFFF, 0};
+	timer.setTimeout(TICKS_BEFORE_WRAP + msToTicks(5), logFire, &late);
+	timer.setTimeout(TICKS_BEFORE_WRAP - msToTicks(5), logFire, &early);
+
+	setTicks(start + TICKS_BEFORE_WRAP - msToTicks(5));
+	timer.run();
+	CHECK_EQUAL(1, early.count);
+	CHECK_EQUAL(0, late.count);
+	setTicks(start + TICKS_BEFORE_WRAP + msToTicks(5));
+	timer.run();
+	CHECK_EQUAL(1, late.count);
+}
+
+
+int main() {
+	testInterval();
+	testTimeoutAcrossWrap();
+	testLongestPeriod();
+	testOrderAcrossWrap();
+	return TestCheck::result();
+}
@@ -0,0 +1,96 @@
+/*
+* ColourTest.cpp
+*
+* The fixed-point colour helpers in RGB.h and RGB.cpp checked exhaustively against exact and
+* floating point arithmetic.
+*/
+
+#include "TestCheck.h"
+#include "RGB.h"
+
+#include <math.h>
+
+
+// Floating point HSV to RGB, with channels from 0 to 1
+static void referenceHsv(double hue, double s, double v, double& r, double& g, double& b) {
+	int segment = (int) hue;
+	double f = hue - segment;
+	double p = v * (1 - s);
+	double q = v * (1 - s * f);
+	double t = v * (1 - s * (1 - f));
+	switch (segment) {
+		case 0: r = v; g = t; b = p; break;
+		case 1: r = q; g = v; b = p; break;
+		case 2: r = p; g = v; b = t; break;
+		case 3: r = p; g = q; b = v; break;
+		case 4: r = t; g = p; b = v; break;
+		default: r = v; g = p; b = q; break;
+	}
+}
+
+
+// Largest distance between a converted colour and the exact one, in levels
+static double errorOf(RGB colour, double r, double g, double b) {
+	return fmax(fabs(r * 255 - colour.r), fmax(fabs(g * 255 - colour.g), fabs(b * 255 - colour.b)));
+}
+
+
+// hsvToRgb() and hslToRgb() round every colour to the nearest level, over the whole HSV and HSL spaces,
+// including low saturations, where (255 - s) << 8 needs more than a 16-bit int
+static void testToRgb() {
+	double hsvError = 0;
+	double hslError = 0;
+	for (uint16_t h = 0; h < HUE_MAX; h++) {
+		for (int s = 0; s < 256; s++) {
+			for (int v = 0; v < 256; v++) {
+				double r, g, b;
+				HSV hsv = {h, (byte) s, (byte) v};
+				referenceHsv(h / (double) HUE_SEGMENT, s / 255.0, v / 255.0, r, g, b);
+				hsvError = fmax(hsvError, errorOf(hsvToRgb(hsv), r, g, b));
+
+				// The same colour space read as HSL, converted to HSV for the reference
+				double lightness = v / 255.0;
+				double chroma = (1 - fabs(2 * lightness - 1)) * s / 255.0;
+				double value = lightness + chroma / 2;
+				HSL hsl = {h, (byte) s, (byte) v};
+				referenceHsv(h / (double) HUE_SEGMENT, value == 0 ? 0 : chroma / value, value, r, g, b);
+				hslError = fmax(hslError, errorOf(hslToRgb(hsl), r, g, b));
+			}
+		}
+	}
+	// Half a level, plus the 0.002% fromLevelUnits() gives away by not dividing
+	CHECK(hsvError < 0.51);
+	CHECK(hslError < 0.51);
+
+	// Hues past the end of the wheel wrap around
+	HSV wrapped = {HUE_MAX + HUE_SEGMENT, 255, 255};
+	RGB yellow = hsvToRgb(wrapped);
+	CHECK(yellow.r == 255 && yellow.g == 255 && yellow.b == 0);
+}
+
+
+// Every RGB colour survives a round trip through HSV within one level, and through HSL within two
+static void testRoundTrip() {
+	double hsvError = 0;
+	double hslError = 0;
+	for (int r = 0; r < 256; r++) {
+		for (int g = 0; g < 256; g++) {
+			for (int b = 0; b < 256; b++) {
+				RGB colour = {(byte) r, (byte) g, (byte) b};
+				RGB viaHsv = hsvToRgb(rgbToHsv(colour));
+				RGB viaHsl = hslToRgb(rgbToHsl(colour));
+				hsvError = fmax(hsvError, errorOf(viaHsv, r / 255.0, g / 255.0, b / 255.0));
+				hslError = fmax(hslError, errorOf(viaHsl, r / 255.0, g / 255.0, b / 255.0));
+			}
+		}
+	}
+	CHECK(hsvError <= 1 + 1e-9);
+	CHECK(hslError <= 2 + 1e-9);
+}
+
+
+int main() {
+	testToRgb();
+	testRoundTrip();
+	return TestCheck::result();
+}
@@ -0,0 +1,206 @@
+/*
+* CommandTest.cpp
+*
+* RgbCommandParser reading from a HostHal::BufferStream: every command, commands sent back to
+* back, malformed input, values out of range and the bounded number of bytes read per update().
+*/
+
+#include "TestCheck.h"
+#include "RgbCommand.h"
+
+
+// A strip with a parser attached, writing colours straight away
+struct CommandRig {
+	SimpleTimer timer;
+	HostHal::BufferStream input;
+	RgbStrip strip;
+	RgbCommandParser parser;
+
+	CommandRig() : strip(3, 5, 6, timer), parser(input, strip) {
+		strip.disableTransitions();
+		strip.setCommandParser(&parser);
+	}
+
+	// Feed a message and update until it has all been read
+	void send(const char* text) {
+		input.feed(text);
+		while (input.available() > 0) {
+			strip.update();
+		}
+	}
+};
+
+
+static bool colourIs(RgbStrip& strip, byte r, byte g, byte b) {
+	RGB colour = strip.getActiveColour();
+	return colour.r == r && colour.g == g && colour.b == b;
+}
+
+
+static void testColours() {
+	HostHal::reset();
+	CommandRig rig;
+
+	rig.send("r");
+	CHECK(colourIs(rig.strip, 255, 0, 0));
+	rig.send("#00FF80");
+	CHECK(colourIs(rig.strip, 0, 255, 128));
+	rig.send("#a0b0c0");
+	CHECK(colourIs(rig.strip, 0xA0, 0xB0, 0xC0));
+	rig.send("z");
+	CHECK(colourIs(rig.strip, 0, 0, 0));
+	CHECK_EQUAL(0, rig.parser.getErrorCount());
+}
+
+
+static void testNumbers() {
+	HostHal::reset();
+	CommandRig rig;
+
+	rig.send("B50\n");
+	CHECK_EQUAL(50, rig.strip.getBrightness());
+	rig.send("T30\n");
+	CHECK_EQUAL(30, rig.strip.getTransitionPeriod());
+	rig.send("S200\n");
+	CHECK(rig.strip.isStrobeEnabled());
+	CHECK_EQUAL(200, rig.strip.getStrobePeriod());
+	rig.send("S0\n");
+	CHECK(!rig.strip.isStrobeEnabled());
+
+	// A number only ends when the next byte arrives
+	rig.send("B20");
+	CHECK_EQUAL(50, rig.strip.getBrightness());
+	rig.send(" ");
+	CHECK_EQUAL(20, rig.strip.getBrightness());
+
+	// Commands back to back, with and without separators
+	rig.send("B75w#FF8000T40,;g\r\n");
+	CHECK_EQUAL(75, rig.strip.getBrightness());
+	CHECK_EQUAL(40, rig.strip.getTransitionPeriod());
+	CHECK(colourIs(rig.strip, 0, 255, 0));
+	CHECK_EQUAL(0, rig.parser.getErrorCount());
+
+	// Turning strobing on or off again changes nothing, rather than restoring an old brightness
+	rig.send("B30 S200 S200 B60 S0 B80 S0\n");
+	CHECK(!rig.strip.isStrobeEnabled());
+	CHECK_EQUAL(80, rig.strip.getBrightness());
+	rig.send("F1\n");
+	CHECK_EQUAL(80, rig.strip.getBrightness());
+}
+
+
+// F<n> takes one timer slot until its flashes are done
+static void testFlash() {
+	HostHal::reset();
+	CommandRig rig;
+	int idle = rig.timer.getNumTimers();
+
+	rig.send("F3\n");
+	CHECK_EQUAL(idle + 1, rig.timer.getNumTimers());
+	for (int ms = 0; ms < 6 * FLASH_PERIOD + 10; ms++) {
+		HostHal::advanceMillis(1);
+		rig.strip.update();
+	}
+	CHECK_EQUAL(idle, rig.timer.getNumTimers());
+
+	// Counts beyond RGBCOMMAND_MAX_FLASHES are capped, not refused
+	rig.send("F9999\n");
+	CHECK_EQUAL(idle + 1, rig.timer.getNumTimers());
+	CHECK_EQUAL(0, rig.parser.getErrorCount());
+}
+
+
+static void testMalformed() {
+	HostHal::reset();
+	CommandRig rig;
+	rig.send("r");
+
+	// Unknown bytes, numeric commands without a number and short hex colours
+	rig.send("q");
+	CHECK_EQUAL(1, rig.parser.getErrorCount());
+	rig.send("B\n");
+	CHECK_EQUAL(2, rig.parser.getErrorCount());
+	CHECK_EQUAL(FULL_BRIGHTNESS, rig.strip.getBrightness());
+
+	// The byte that cuts a hex colour short starts the next command
+	rig.send("#12g");
+	CHECK_EQUAL(3, rig.parser.getErrorCount());
+	CHECK(colourIs(rig.strip, 0, 255, 0));
+
+	// F0 would flash forever; it is dropped without taking a timer slot
+	int idle = rig.timer.getNumTimers();
+	rig.send("F0\n");
+	CHECK_EQUAL(4, rig.parser.getErrorCount());
+	CHECK_EQUAL(idle, rig.timer.getNumTimers());
+	CHECK(!rig.strip.flash(0));
+	CHECK(!rig.strip.flash(-1));
+	CHECK_EQUAL(idle, rig.timer.getNumTimers());
+}
+
+
+// Numbers saturate at RGBCOMMAND_MAX_VALUE, and brightness is clamped to 0-100 before it reaches the strip
+static void testRange() {
+	HostHal::reset();
+	CommandRig rig;
+
+	rig.send("T99999999\n");
+	CHECK_EQUAL(RGBCOMMAND_MAX_VALUE, rig.strip.getTransitionPeriod());
+
+	rig.send("B65535\n");
+	CHECK_EQUAL(FULL_BRIGHTNESS, rig.strip.getBrightness());
+	rig.send("B40000\n");
+	CHECK_EQUAL(FULL_BRIGHTNESS, rig.strip.getBrightness());
+	rig.send("B0\n");
+	CHECK_EQUAL(0, rig.strip.getBrightness());
+	CHECK_EQUAL(0, rig.parser.getErrorCount());
+}
+
+
+// However much is waiting, one update() reads at most RGBCOMMAND_MAX_BYTES
+static void testBoundedReads() {
+	HostHal::reset();
+	CommandRig rig;
+
+	const char* message = "r g b w y c m o p z r g b w y c m o p z r g b w y c m o p z\n";
+	unsigned int length = strlen(message);
+	CHECK_EQUAL(length, rig.input.feed(message));
+
+	unsigned int updates = 0;
+	while (rig.input.available() > 0) {
+		unsigned long before = rig.input.getReadCount();
+		rig.strip.update();
+		CHECK(rig.input.getReadCount() - before <= RGBCOMMAND_MAX_BYTES);
+		updates++;
+	}
+	CHECK_EQUAL((length + RGBCOMMAND_MAX_BYTES - 1) / RGBCOMMAND_MAX_BYTES, updates);
+	CHECK_EQUAL(length, rig.input.getReadCount());
+	CHECK(colourIs(rig.strip, 0, 0, 0));
+	CHECK(!rig.parser.isInputWaiting());
+}
+
+
+// Bytes parsed one at a time without a stream act the same
+static void testParse() {
+	HostHal::reset();
+	CommandRig rig;
+
+	const char* message = "B30#0000FF\n";
+	for (const char* c = message; *c != 0; c++) {
+		rig.parser.parse(*c);
+	}
+	CHECK_EQUAL(30, rig.strip.getBrightness());
+	CHECK(colourIs(rig.strip, 0, 0, 255));
+	CHECK_EQUAL(0, rig.input.getReadCount());
+}
+
+
+int main() {
+	testColours();
+	testNumbers();
+	testFlash();
+	testMalformed();
+	testRange();
+	testBoundedReads();
+	testParse();
+	return TestCheck::result();
+}
@@ -0,0 +1,165 @@
+/*
+* CommitTest.cpp
+*
+* Double buffering: changes made between updates reach the pins only from update(), in one commit
+* with at most one analogWrite() per channel, and the commit is timed across the micros() wrap.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+
+static const int PINS[] = {3, 5, 6};
+
+
+// Pin write counts, to compare before and after
+struct PinCounts {
+	unsigned long counts[3];
+
+	PinCounts() {
+		for (int i = 0; i < 3; i++) {
+			counts[i] = HostHal::getPinWriteCount(PINS[i]);
+		}
+	}
+
+	// Largest number of writes to any one pin since the counts were taken
+	unsigned long mostWrites() {
+		unsigned long most = 0;
+		for (int i = 0; i < 3; i++) {
+			unsigned long writes = HostHal::getPinWriteCount(PINS[i]) - counts[i];
+			if (writes > most) {
+				most = writes;
+			}
+		}
+		return most;
+	}
+};
+
+
+// Colour, brightness and curve changes wait in the back buffer until update(), which writes each pin once
+static void testDeferred() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.enableDoubleBuffering();
+	CHECK(strip.isDoubleBuffered());
+
+	unsigned long writes = HostHal::getWriteCount();
+	strip.setTargetColour(COLOURS[RED]);
+	strip.setBrightness(50);
+	strip.setTargetColour(COLOURS[WHITE]);
+	strip.setOutputCurve(CURVE_GAMMA);
+	strip.setOutputCurve(CURVE_LINEAR);
+	strip.decreaseBrightness();
+	CHECK_EQUAL(writes, HostHal::getWriteCount());
+	CHECK_EQUAL(0, strip.msUntilNextEvent());
+
+	PinCounts before;
+	strip.update();
+	CHECK_EQUAL(writes + 3, HostHal::getWriteCount());
+	CHECK_EQUAL(1, before.mostWrites());
+	CHECK_EQUAL(102, HostHal::getPinValue(3));
+	CHECK_EQUAL(102, HostHal::getPinValue(6));
+
+	// Nothing is left to commit
+	strip.update();
+	CHECK_EQUAL(writes + 3, HostHal::getWriteCount());
+}
+
+
+// Transition and strobe events that run outside update() stage their changes without writing
+static void testTimerEvents() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.enableDoubleBuffering();
+	strip.enableTransitions();
+	strip.setTransitionPeriod(10);
+	strip.setStrobePeriod(20);
+	strip.enableStrobe();
+	strip.setTargetColour(COLOURS[WHITE]);
+	strip.update();
+
+	// Running the shared scheduler alone changes the back buffer, not the pins
+	unsigned long writes = HostHal::getWriteCount();
+	HostHal::advanceMillis(20);
+	timer.run();
+	CHECK_EQUAL(writes, HostHal::getWriteCount());
+	CHECK_EQUAL(0, strip.msUntilNextEvent());
+
+	// Every update() writes each pin at most once, whatever changed since the last
+	unsigned long worst = 0;
+	for (int i = 0; i < 200; i++) {
+		HostHal::advanceMillis(5 + i % 17);
+		strip.setBrightness(40 + i % 50);
+		PinCounts before;
+		strip.update();
+		if (before.mostWrites() > worst) {
+			worst = before.mostWrites();
+		}
+	}
+	CHECK_EQUAL(1, worst);
+}
+
+
+// Turning double buffering off writes anything still waiting, and later changes are written at once
+static void testDisable() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.enableDoubleBuffering();
+	strip.setTargetColour(COLOURS[BLUE]);
+	CHECK_EQUAL(0, HostHal::getPinValue(6));
+
+	strip.disableDoubleBuffering();
+	CHECK(!strip.isDoubleBuffered());
+	CHECK_EQUAL(255, HostHal::getPinValue(6));
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, strip.msUntilNextEvent());
+
+	strip.setTargetColour(COLOURS[RED]);
+	CHECK_EQUAL(255, HostHal::getPinValue(3));
+	CHECK_EQUAL(0, HostHal::getPinValue(6));
+}
+
+
+// Every pin write takes 5 us of virtual time
+static void slowWrite(uint8_t pin, int value, void* context) {
+	(void) pin;
+	(void) value;
+	(void) context;
+	HostHal::advanceMicros(5);
+}
+
+
+// The commit time covers the pin writes, also when micros() wraps during the commit
+static void testCommitTime() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.enableDoubleBuffering();
+	strip.resetWriteCounts();
+	HostHal::setPwmSink(slowWrite, NULL);
+
+	strip.setTargetColour(COLOURS[WHITE]);
+	strip.update();
+	CHECK_EQUAL(15, strip.getCommitTime());
+
+	// Two pins change
+	HostHal::setMicros(0xFFFFFFFFULL - 6);
+	strip.setTargetColour(COLOURS[RED]);
+	strip.update();
+	CHECK_EQUAL(10, strip.getCommitTime());
+	CHECK_EQUAL(15, strip.getMaxCommitTime());
+
+	strip.resetWriteCounts();
+	CHECK_EQUAL(0, strip.getMaxCommitTime());
+}
+
+
+int main() {
+	testDeferred();
+	testTimerEvents();
+	testDisable();
+	testCommitTime();
+	return TestCheck::result();
+}
@@ -0,0 +1,102 @@
+/*
+* ControllerTest.cpp
+*
+* RgbStripController on a single thread: queued commands reach the strip on the next update(), the
+* render thread's sleep is capped, and flash counts that would never end are refused.
+*/
+
+#include "TestCheck.h"
+#include "RgbController.h"
+
+
+static void testUpdate() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbStripController controller(strip);
+
+	CHECK(controller.setTargetColour(COLOURS[BLUE]));
+	CHECK(controller.setBrightness(70));
+	CHECK_EQUAL(0, controller.msUntilNextEvent());
+	CHECK_EQUAL(0, strip.getActiveColour().b);
+
+	controller.update();
+	CHECK_EQUAL(255, strip.getActiveColour().b);
+	CHECK_EQUAL(70, strip.getBrightness());
+	CHECK_EQUAL(2, controller.getAppliedCount());
+
+	// A full queue refuses and counts the extra commands
+	for (int i = 0; i < RGBCONTROLLER_QUEUE_SIZE; i++) {
+		CHECK(controller.setBrightness(i % 100));
+	}
+	CHECK(!controller.setBrightness(99));
+	CHECK_EQUAL(1, controller.getDroppedCount());
+	controller.update();
+	CHECK_EQUAL((RGBCONTROLLER_QUEUE_SIZE - 1) % 100, strip.getBrightness());
+}
+
+
+// The render thread never sleeps longer than RGBCONTROLLER_MAX_SLEEP, so commands sent meanwhile are
+// picked up soon even when the strip has nothing scheduled
+static void testSleepCap() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbStripController controller(strip);
+	controller.update();
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, strip.msUntilNextEvent());
+	CHECK_EQUAL(RGBCONTROLLER_MAX_SLEEP, controller.msUntilNextEvent());
+
+	// Sooner events are kept
+	strip.enableTransitions();
+	strip.setTransitionPeriod(TRANSITION_PERIOD_STEP);
+	strip.setTargetColour(COLOURS[RED]);
+	controller.update();
+	CHECK(controller.msUntilNextEvent() <= TRANSITION_PERIOD_STEP);
+
+	// A command sent during a full-length sleep is applied when it ends
+	strip.disableTransitions();
+	controller.update();
+	unsigned long start = millis();
+	controller.setTargetColour(COLOURS[GREEN]);
+	HostHal::idle(RGBCONTROLLER_MAX_SLEEP);
+	controller.update();
+	CHECK_EQUAL(255, strip.getActiveColour().g);
+	CHECK_EQUAL(RGBCONTROLLER_MAX_SLEEP, millis() - start);
+}
+
+
+// Flash counts of zero or less would start a flash that never ends, and take a timer slot for good
+static void testFlashCounts() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbStripController controller(strip);
+	int idle = timer.getNumTimers();
+
+	CHECK(!controller.flash(0));
+	CHECK(!controller.flash(-1));
+	CHECK_EQUAL(0, controller.getDroppedCount());
+	CHECK(controller.msUntilNextEvent() > 0);
+
+	// Commands queued another way are ignored when applied
+	StripCommand command;
+	command.type = STRIP_FLASH;
+	command.colour = COLOURS[OFF];
+	command.value = 0;
+	CHECK(controller.send(command));
+	controller.update();
+	CHECK_EQUAL(idle, timer.getNumTimers());
+
+	CHECK(controller.flash(3));
+	controller.update();
+	CHECK_EQUAL(idle + 1, timer.getNumTimers());
+}
+
+
+int main() {
+	testUpdate();
+	testSleepCap();
+	testFlashCounts();
+	return TestCheck::result();
+}
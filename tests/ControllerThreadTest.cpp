@@ -0,0 +1,144 @@
+/*
+* ControllerThreadTest.cpp
+*
+* The multi-producer command queue and RgbStripController with several producer threads. Built
+* with ThreadSanitizer when the compiler supports it, like IsrThreadTest.
+*/
+
+#include "TestCheck.h"
+#include "RgbController.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+
+const int NUM_PRODUCERS = 4;
+
+// Commands each producer sends
+const long COMMANDS_PER_PRODUCER = 20000;
+
+struct Producer {
+	StripCommandMpscQueue<16>* queue;
+	RgbStripController* controller;
+	byte id;
+};
+
+
+// Push numbered commands tagged with the producer, waiting whenever the queue is full
+static void* pushCommands(void* context) {
+	Producer* producer = (Producer*) context;
+	StripCommand command;
+	command.type = producer->id;
+	command.colour = COLOURS[OFF];
+
+	for (long i = 0; i < COMMANDS_PER_PRODUCER; i++) {
+		command.value = i;
+		command.colour.g = i;
+		while (!producer->queue->push(command)) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+
+// Every command arrives exactly once and whole, and each producer's commands stay in order
+static void testQueue() {
+	StripCommandMpscQueue<16> queue;
+	pthread_t threads[NUM_PRODUCERS];
+	Producer producers[NUM_PRODUCERS];
+	for (int i = 0; i < NUM_PRODUCERS; i++) {
+		producers[i].queue = &queue;
+		producers[i].controller = NULL;
+		producers[i].id = i;
+		CHECK_EQUAL(0, pthread_create(&threads[i], NULL, pushCommands, &producers[i]));
+	}
+
+	long next[NUM_PRODUCERS] = {0};
+	long received = 0;
+	long wrong = 0;
+	StripCommand command;
+	while (received < NUM_PRODUCERS * COMMANDS_PER_PRODUCER) {
+		if (!queue.pop(command)) {
+			sched_yield();
+			continue;
+		}
+
+		if (command.type >= NUM_PRODUCERS || command.value != next[command.type] || command.colour.g != (byte) command.value) {
+			wrong++;
+		} else {
+			next[command.type]++;
+		}
+		received++;
+	}
+
+	for (int i = 0; i < NUM_PRODUCERS; i++) {
+		pthread_join(threads[i], NULL);
+		CHECK_EQUAL(COMMANDS_PER_PRODUCER, next[i]);
+	}
+	CHECK_EQUAL(0, wrong);
+	CHECK(queue.isEmpty());
+}
+
+
+// Send colours through the controller, retrying when its queue is full
+static void* sendColours(void* context) {
+	Producer* producer = (Producer*) context;
+	for (long i = 0; i < COMMANDS_PER_PRODUCER; i++) {
+		RGB colour = {producer->id, (byte) i, (byte)(i >> 8)};
+		while (!producer->controller->setTargetColour(colour)) {
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+
+// The render thread applies every command while the producers send, and only it touches the strip
+static void testController() {
+	HostHal::reset();
+	HostHal::setClockSource(HostHal::realMicros);
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbStripController controller(strip);
+
+	pthread_t threads[NUM_PRODUCERS];
+	Producer producers[NUM_PRODUCERS];
+	for (int i = 0; i < NUM_PRODUCERS; i++) {
+		producers[i].queue = NULL;
+		producers[i].controller = &controller;
+		producers[i].id = i;
+		CHECK_EQUAL(0, pthread_create(&threads[i], NULL, sendColours, &producers[i]));
+	}
+
+	unsigned long total = NUM_PRODUCERS * COMMANDS_PER_PRODUCER;
+	while (controller.getAppliedCount() < total) {
+		unsigned long before = controller.getAppliedCount();
+		controller.update();
+		if (controller.getAppliedCount() == before) {
+			sched_yield();
+		}
+	}
+
+	for (int i = 0; i < NUM_PRODUCERS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	// Each producer's last colour was its last command, so the strip ends on one of them
+	RGB colour = strip.getActiveColour();
+	CHECK(colour.r < NUM_PRODUCERS);
+	CHECK_EQUAL((byte)(COMMANDS_PER_PRODUCER - 1), colour.g);
+	CHECK(controller.msUntilNextEvent() > 0);
+	printf("controller: %lu commands applied, %lu full-queue refusals\n", controller.getAppliedCount(), controller.getDroppedCount());
+
+	HostHal::reset();
+}
+
+
+int main() {
+	testQueue();
+	testController();
+	return TestCheck::result();
+}
@@ -0,0 +1,119 @@
+/*
+* CurveTest.cpp
+*
+* The output curve tables in RgbCurves.h: generated at compile time, checked here against floating
+* point references, for monotonicity over every 16-bit input, and through a strip with CURVE_LINEAR.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+#include <math.h>
+
+
+static const uint16_t* table(byte curve) {
+	return OUTPUT_CURVE_TABLES[curve - 1];
+}
+
+
+// CIE 1976 L* (0-100) to relative luminance
+static double referenceCie(double lightness) {
+	return lightness <= 8 ? lightness / 903.3 : pow((lightness + 16) / 116, 3);
+}
+
+
+// Every table point is within one level of the floating point curve
+static void testPoints() {
+	int wrong = 0;
+	for (int point = 0; point < CURVE_POINTS; point++) {
+		double x = point / 256.0;
+		long gamma = lround(pow(x, RGBSTRIP_GAMMA) * 65535);
+		long cie = lround(referenceCie(x * 100) * 65535);
+		if (labs(gamma - pgm_read_word(table(CURVE_GAMMA) + point)) > 1) {
+			wrong++;
+		}
+		if (labs(cie - pgm_read_word(table(CURVE_CIE_LIGHTNESS) + point)) > 1) {
+			wrong++;
+		}
+	}
+	CHECK_EQUAL(0, wrong);
+}
+
+
+// Both curves rise or stay level from 0 to full scale over every input, with no steps backwards
+static void testMonotonic() {
+	for (byte curve = CURVE_GAMMA; curve < NUM_OUTPUT_CURVES; curve++) {
+		long reversals = 0;
+		uint16_t last = 0;
+		for (long level = 0; level <= 0xFFFF; level++) {
+			uint16_t output = applyOutputCurve(table(curve), level);
+			if (output < last) {
+				reversals++;
+			}
+			last = output;
+		}
+		CHECK_EQUAL(0, reversals);
+		CHECK_EQUAL(0, applyOutputCurve(table(curve), 0));
+		CHECK_EQUAL(0xFFFF, applyOutputCurve(table(curve), 0xFFFF));
+	}
+}
+
+
+// Known values: half level through each curve, and either side of the L* = 8 breakpoint of CURVE_CIE_LIGHTNESS
+static void testMidpoints() {
+	// 0.5^2.2 = 0.21764
+	CHECK_EQUAL(14263, applyOutputCurve(table(CURVE_GAMMA), 0x8000));
+
+	// L* = 50: ((50 + 16) / 116)^3 = 0.18419
+	CHECK_EQUAL(12071, applyOutputCurve(table(CURVE_CIE_LIGHTNESS), 0x8000));
+
+	// L* = 8 is 8 / 903.3 = 0.0088565 of full scale from both sides of the breakpoint, so the curve
+	// is continuous there; table points 20 and 21 straddle it
+	const uint16_t* cie = table(CURVE_CIE_LIGHTNESS);
+	CHECK(fabs(pow(24.0 / 116, 3) - 8 / 903.3) < 1e-6);
+	long breakpoint = applyOutputCurve(cie, 5243);
+	CHECK(breakpoint >= 579 && breakpoint <= 581);
+
+	// Below the breakpoint the curve is linear: L* = 4 gives half the luminance of L* = 8
+	long half = applyOutputCurve(cie, 2621);
+	CHECK(half >= 289 && half <= 291);
+}
+
+
+// CURVE_LINEAR has no table and passes every level through: at 16 bits the duty cycle is the 16-bit level
+static void testLinear() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	CHECK_EQUAL(CURVE_LINEAR, strip.getOutputCurve());
+	strip.setOutputResolution(16);
+
+	int wrong = 0;
+	for (int level = 0; level < 256; level++) {
+		RGB colour = {(byte) level, 0, 0};
+		strip.setTargetColour(colour);
+		if (HostHal::getPinValue(3) != level * 257) {
+			wrong++;
+		}
+	}
+	CHECK_EQUAL(0, wrong);
+
+	// A curve changes the output; unknown curves are ignored
+	strip.setOutputCurve(CURVE_GAMMA);
+	strip.setTargetColour(COLOURS[WHITE]);
+	CHECK_EQUAL(0xFFFF, HostHal::getPinValue(3));
+	RGB half = {128, 0, 0};
+	strip.setTargetColour(half);
+	CHECK_EQUAL(applyOutputCurve(table(CURVE_GAMMA), 128 * 257), HostHal::getPinValue(3));
+	strip.setOutputCurve(NUM_OUTPUT_CURVES);
+	CHECK_EQUAL(CURVE_GAMMA, strip.getOutputCurve());
+}
+
+
+int main() {
+	testPoints();
+	testMonotonic();
+	testMidpoints();
+	testLinear();
+	return TestCheck::result();
+}
@@ -0,0 +1,153 @@
+/*
+* DitherTest.cpp
+*
+* Temporal dithering: the average duty cycle over a run of frames matches the 16-bit level, frames
+* come from the dither timer rather than from update(), and a strip that isn't dithering never
+* rewrites its pins.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+
+// Red channel level of a colour at a brightness, in 1/256ths of an 8-bit output level
+static long redLevel(byte red, int brightness) {
+	uint32_t scale = ((uint32_t)brightness * 32768 + 50) / 100;
+	uint16_t level = ((uint32_t)red * 257 * scale) >> 15;
+	return level - (level >> 8);
+}
+
+
+// Run frames of the dither timer, adding up the duty cycles written to the red pin
+static long sumRedDuty(RgbStrip& strip, int frames) {
+	long sum = 0;
+	for (int i = 0; i < frames; i++) {
+		HostHal::advanceMillis(RGBSTRIP_DITHER_PERIOD);
+		strip.update();
+		sum += HostHal::getPinValue(3);
+	}
+	return sum;
+}
+
+
+// Dithering is off unless asked for, and an undithered strip writes only when its colour changes
+static void testDefault() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	CHECK_EQUAL(DITHER_NONE, strip.getDitherMode());
+
+	RGB colour = {200, 100, 50};
+	strip.setTargetColour(colour);
+	strip.setBrightness(37);
+	unsigned long writes = HostHal::getWriteCount();
+
+	for (int i = 0; i < 1000; i++) {
+		strip.update();
+	}
+	sumRedDuty(strip, 100);
+	CHECK_EQUAL(writes, HostHal::getWriteCount());
+	CHECK_EQUAL(SimpleTimer::NO_DEADLINE, timer.nextDeadline());
+}
+
+
+// A level halfway between two outputs alternates between them, one write per channel per frame
+static void testErrorDiffusion() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	CHECK(strip.setDitherMode(DITHER_ERROR_DIFFUSION));
+	strip.setTargetColour(COLOURS[WHITE]);
+	strip.setBrightness(50);
+	CHECK_EQUAL(127 * 256 + 128, redLevel(255, 50));
+
+	// update() calls between frames write nothing
+	HostHal::clearWriteLog();
+	unsigned long writes = HostHal::getPinWriteCount(3);
+	for (int i = 0; i < 1000; i++) {
+		strip.update();
+	}
+	CHECK_EQUAL(writes, HostHal::getPinWriteCount(3));
+
+	const int FRAMES = 256;
+	CHECK_EQUAL(FRAMES * 255 / 2, sumRedDuty(strip, FRAMES));
+	CHECK_EQUAL(writes + FRAMES, HostHal::getPinWriteCount(3));
+
+	// Any other level averages out to within one output level over the whole run
+	RGB colour = {200, 100, 50};
+	strip.setTargetColour(colour);
+	strip.setBrightness(37);
+	long error = sumRedDuty(strip, FRAMES) * 256 - redLevel(200, 37) * FRAMES;
+	CHECK(error >= -256 && error <= 256);
+}
+
+
+// The ordered pattern repeats every 16 frames, averaging to within 1/16 of an output level
+static void testOrdered() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	CHECK(strip.setDitherMode(DITHER_ORDERED));
+	strip.setTargetColour(COLOURS[WHITE]);
+	strip.setBrightness(50);
+
+	const int FRAMES = 16 * 16;
+	CHECK_EQUAL(FRAMES * 255 / 2, sumRedDuty(strip, FRAMES));
+
+	RGB colour = {200, 100, 50};
+	strip.setTargetColour(colour);
+	strip.setBrightness(37);
+	unsigned long writes = HostHal::getPinWriteCount(3);
+	long error = sumRedDuty(strip, FRAMES) * 256 - redLevel(200, 37) * FRAMES;
+	CHECK(error >= -16 * FRAMES && error <= 16 * FRAMES);
+	CHECK(HostHal::getPinWriteCount(3) - writes <= (unsigned long) FRAMES);
+}
+
+
+static void doNothing() {
+}
+
+
+// The dither timer runs only while a channel sits between two output levels
+static void testTimer() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	int idle = timer.getNumTimers();
+
+	CHECK(strip.setDitherMode(DITHER_ERROR_DIFFUSION));
+	CHECK_EQUAL(idle + 1, timer.getNumTimers());
+	strip.setTargetColour(COLOURS[WHITE]);
+	CHECK_EQUAL(SimpleTimer::NO_DEADLINE, timer.nextDeadline());
+
+	strip.setBrightness(50);
+	CHECK_EQUAL(msToTicks(RGBSTRIP_DITHER_PERIOD), timer.nextDeadline());
+
+	// Exact output levels need no frames
+	strip.setBrightness(100);
+	unsigned long writes = HostHal::getWriteCount();
+	sumRedDuty(strip, 100);
+	CHECK_EQUAL(writes, HostHal::getWriteCount());
+	CHECK_EQUAL(SimpleTimer::NO_DEADLINE, timer.nextDeadline());
+
+	// Turning dithering off gives the slot back
+	CHECK(strip.setDitherMode(DITHER_NONE));
+	CHECK_EQUAL(idle, timer.getNumTimers());
+	CHECK(!strip.setDitherMode(DITHER_ORDERED + 1));
+
+	// Without a free slot the mode is left as it was
+	while (timer.getNumAvailableTimers() > 0) {
+		timer.setTimeout(1000, doNothing);
+	}
+	CHECK(!strip.setDitherMode(DITHER_ORDERED));
+	CHECK_EQUAL(DITHER_NONE, strip.getDitherMode());
+}
+
+
+int main() {
+	testDefault();
+	testErrorDiffusion();
+	testOrdered();
+	testTimer();
+	return TestCheck::result();
+}
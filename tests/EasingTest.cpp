@@ -0,0 +1,127 @@
+/*
+* EasingTest.cpp
+*
+* Every entry of EASING_CURVES driven through a one second fade on the virtual clock: the colour
+* never steps backwards, starts and ends on the right colours, and passes through the values of the
+* floating point curve at a quarter, half and three quarters of the way.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+#include <math.h>
+
+
+static const char* const NAMES[NUM_EASING_CURVES] = {
+	"linear", "in quad", "out quad", "in out quad", "in cubic", "out cubic", "in out cubic",
+	"in sine", "out sine", "in out sine", "in expo", "out expo", "in out expo"
+};
+
+
+// Floating point ease-in curves, from 0 to 1
+static double easeIn(byte curve, double t) {
+	switch (curve) {
+		case EASE_IN_QUAD: return t * t;
+		case EASE_IN_CUBIC: return t * t * t;
+		case EASE_IN_SINE: return 1 - cos(t * M_PI / 2);
+		case EASE_IN_EXPO: return t == 0 ? 0 : pow(2, 10 * (t - 1));
+		default: return t;
+	}
+}
+
+
+// Floating point reference for every curve; out and in-out curves are built from the ease-in curve
+static double reference(byte curve, double t) {
+	if (curve == EASE_LINEAR) {
+		return t;
+	}
+
+	// Curves come in groups of three from EASE_IN_QUAD: in, out, in-out
+	byte group = (curve - 1) / 3;
+	byte in = 1 + group * 3;
+	switch ((curve - 1) % 3) {
+		case 0: return easeIn(in, t);
+		case 1: return 1 - easeIn(in, 1 - t);
+		default: return t < 0.5 ? easeIn(in, 2 * t) / 2 : 1 - easeIn(in, 2 - 2 * t) / 2;
+	}
+}
+
+
+// Fade off to white over a second at 16-bit output, checking every millisecond
+static void checkFade(byte curve) {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.setOutputResolution(16);
+	strip.setTargetColour(COLOURS[WHITE], 1000, getEasingFunction(curve));
+
+	int reversals = 0;
+	int wrong = 0;
+	long last = 0;
+	for (int ms = 1; ms <= 1000; ms++) {
+		HostHal::advanceMillis(1);
+		strip.update();
+		long level = HostHal::getPinValue(3);
+		if (level < last) {
+			reversals++;
+		}
+		last = level;
+
+		// Within 0.3% of full scale at the quarter points
+		if (ms % 250 == 0 && fabs(level - reference(curve, ms / 1000.0) * 0xFFFF) > 200) {
+			printf("%s at %d ms: %ld, expected %.0f\n", NAMES[curve], ms, level, reference(curve, ms / 1000.0) * 0xFFFF);
+			wrong++;
+		}
+	}
+
+	CHECK_EQUAL(0, reversals);
+	CHECK_EQUAL(0, wrong);
+	CHECK_EQUAL(0xFFFF, last);
+	CHECK(!strip.isFading());
+}
+
+
+static void testFades() {
+	for (byte curve = 0; curve < NUM_EASING_CURVES; curve++) {
+		checkFade(curve);
+	}
+}
+
+
+// Every curve starts at 0, ends at EASING_ONE and never falls over all of its inputs
+static void testFunctions() {
+	for (byte curve = 0; curve < NUM_EASING_CURVES; curve++) {
+		easing_function easing = getEasingFunction(curve);
+		int reversals = 0;
+		uint16_t last = 0;
+		for (uint32_t progress = 0; progress <= EASING_ONE; progress++) {
+			uint16_t eased = easing(progress);
+			if (eased < last) {
+				reversals++;
+			}
+			last = eased;
+		}
+		CHECK_EQUAL(0, reversals);
+		CHECK_EQUAL(0, easing(0));
+		CHECK_EQUAL(EASING_ONE, easing(EASING_ONE));
+	}
+
+	// In-out curves pass through the middle, and the integer curves are exact there
+	CHECK_EQUAL(EASING_ONE / 2, easeInOutQuad(EASING_ONE / 2));
+	CHECK_EQUAL(EASING_ONE / 2, easeInOutCubic(EASING_ONE / 2));
+	CHECK_EQUAL(EASING_ONE / 2, easeInOutSine(EASING_ONE / 2));
+	CHECK_EQUAL(EASING_ONE / 2, easeInOutExpo(EASING_ONE / 2));
+	CHECK_EQUAL(EASING_ONE / 4, easeInQuad(EASING_ONE / 2));
+	CHECK_EQUAL(EASING_ONE / 8, easeInCubic(EASING_ONE / 2));
+	CHECK_EQUAL(EASING_ONE * 3 / 4, easeOutQuad(EASING_ONE / 2));
+
+	// Unknown curves are linear
+	CHECK(getEasingFunction(NUM_EASING_CURVES) == easeLinear);
+}
+
+
+int main() {
+	testFades();
+	testFunctions();
+	return TestCheck::result();
+}
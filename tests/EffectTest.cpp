@@ -0,0 +1,262 @@
+/*
+* EffectTest.cpp
+*
+* Packed effects: encodeEffect() round trips through the decoder and RgbStrip::playEffect(), from
+* RAM, PROGMEM and a memory-mapped EffectFile, and truncated or corrupt data is rejected without
+* reading past its end.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+static const Keyframe CUES[] = {
+	// colour           brightness  fade   hold   easing
+	{{255, 0, 0},       100,        0,     100,   EASE_LINEAR},
+	{{0, 255, 0},       100,        0,     50,    EASE_LINEAR},
+	{{0, 255, 0},       50,         0,     50,    EASE_LINEAR},
+	{{12, 34, 56},      100,        0,     40000, EASE_IN_OUT_SINE},
+	{{255, 255, 255},   100,        300,   0,     EASE_OUT_CUBIC}
+};
+
+static const uint16_t NUM_CUES = sizeof(CUES) / sizeof(CUES[0]);
+
+// CUES as written by encodeEffect(), stored as a sketch would store the output of effect_encoder -c
+static const byte CUES_PROGMEM[] PROGMEM = {
+	'R', 'F', 1, 5,
+	0x41, 0xFE, 0x03, 0x64,
+	0x43, 0xFD, 0x03, 0xFE, 0x03, 0x32,
+	0x08, 0x32,
+	0x5F, 0x18, 0xB9, 0x03, 0x70, 0x64, 0x09, 0xC0, 0xB8, 0x02,
+	0x77, 0xE6, 0x03, 0xBA, 0x03, 0x8E, 0x03, 0x05, 0xAC, 0x02, 0x00
+};
+
+
+static bool sameCue(const Keyframe& a, const Keyframe& b) {
+	return a.colour.r == b.colour.r && a.colour.g == b.colour.g && a.colour.b == b.colour.b
+		&& a.brightness == b.brightness && a.fadeTime == b.fadeTime && a.holdTime == b.holdTime
+		&& a.easing == b.easing;
+}
+
+
+// Decode every cue of an effect and compare it with CUES
+static void checkDecodes(const byte* data, size_t length, bool progmem) {
+	EffectReader reader;
+	CHECK(effectBegin(reader, data, length, progmem));
+	CHECK_EQUAL(NUM_CUES, reader.numCues);
+
+	// Twice, to check that rewinding resets the delta decoding
+	for (int pass = 0; pass < 2; pass++) {
+		effectRewind(reader);
+		Keyframe cue;
+		for (uint16_t i = 0; i < NUM_CUES; i++) {
+			CHECK(effectNextCue(reader, cue));
+			CHECK(sameCue(CUES[i], cue));
+		}
+		CHECK(!effectNextCue(reader, cue));
+		CHECK(reader.position == data + length);
+	}
+}
+
+
+static void recordStep(void* context, int step) {
+	int* steps = (int*) context;
+	steps[steps[0] + 1] = step;
+	steps[0]++;
+}
+
+
+// Play an effect holding CUES on a strip, checking the colour of each step as it starts
+static void checkPlays(const byte* data, size_t length, bool progmem) {
+	HostHal::reset();
+	RgbStrip strip(3, 5, 6);
+	int steps[16] = {0};
+	strip.setSequenceCallback(recordStep, steps);
+
+	CHECK(strip.playEffect(data, length, progmem, SEQUENCE_ONCE));
+	CHECK_EQUAL(255, strip.getActiveColour().r);
+
+	HostHal::advanceMillis(100);
+	strip.update();
+	CHECK_EQUAL(1, strip.getSequenceStep());
+	CHECK_EQUAL(255, strip.getActiveColour().g);
+
+	// The cue brightness scales the colour itself
+	HostHal::advanceMillis(50);
+	strip.update();
+	CHECK_EQUAL(127, strip.getActiveColour().g);
+
+	HostHal::advanceMillis(50);
+	strip.update();
+	RGB colour = strip.getActiveColour();
+	CHECK(colour.r == 12 && colour.g == 34 && colour.b == 56);
+
+	// The last cue fades to white over 300 ms, then the effect finishes
+	HostHal::advanceMillis(40000);
+	strip.update();
+	HostHal::advanceMillis(150);
+	strip.update();
+	CHECK(strip.getActiveColour().r > 12 && strip.getActiveColour().r < 255);
+	HostHal::advanceMillis(150);
+	strip.update();
+	strip.update();
+	CHECK_EQUAL(255, strip.getActiveColour().b);
+	CHECK(!strip.isSequencePlaying());
+
+	CHECK_EQUAL(NUM_CUES + 1, steps[0]);
+	for (int i = 0; i < NUM_CUES; i++) {
+		CHECK_EQUAL(i, steps[i + 1]);
+	}
+	CHECK_EQUAL(SEQUENCE_FINISHED, steps[NUM_CUES + 1]);
+}
+
+
+static void testRam() {
+	byte buffer[64];
+	size_t length = encodeEffect(CUES, NUM_CUES, buffer, sizeof(buffer));
+	CHECK_EQUAL(sizeof(CUES_PROGMEM), length);
+	CHECK(memcmp(buffer, CUES_PROGMEM, length) == 0);
+
+	checkDecodes(buffer, length, false);
+	checkPlays(buffer, length, false);
+
+	// Too small a buffer is refused rather than overrun
+	CHECK_EQUAL(0, encodeEffect(CUES, NUM_CUES, buffer, length - 1));
+}
+
+
+static void testProgmem() {
+	checkDecodes(CUES_PROGMEM, sizeof(CUES_PROGMEM), true);
+	checkPlays(CUES_PROGMEM, sizeof(CUES_PROGMEM), true);
+}
+
+
+static void testFile() {
+	char path[] = "/tmp/rgbstrip_effect_XXXXXX";
+	int fd = mkstemp(path);
+	CHECK(fd >= 0);
+	if (fd < 0) {
+		return;
+	}
+	CHECK_EQUAL(sizeof(CUES_PROGMEM), write(fd, CUES_PROGMEM, sizeof(CUES_PROGMEM)));
+	close(fd);
+
+	EffectFile file;
+	CHECK(file.open(path));
+	CHECK_EQUAL(sizeof(CUES_PROGMEM), file.length());
+	checkDecodes(file.data(), file.length(), false);
+	checkPlays(file.data(), file.length(), false);
+	file.close();
+	CHECK(file.data() == NULL);
+
+	// Empty and missing files can't be mapped
+	fd = open(path, O_WRONLY | O_TRUNC);
+	close(fd);
+	CHECK(!file.open(path));
+	unlink(path);
+	CHECK(!file.open(path));
+}
+
+
+// Every prefix of an effect is either rejected or decodes fewer cues, reading only the bytes it was given
+static void testTruncated() {
+	for (size_t length = 0; length < sizeof(CUES_PROGMEM); length++) {
+		byte* data = new byte[length + 1];
+		memcpy(data, CUES_PROGMEM, length);
+
+		EffectReader reader;
+		if (length < 4) {
+			CHECK(!effectBegin(reader, data, length, false));
+		} else {
+			CHECK(effectBegin(reader, data, length, false));
+			Keyframe cue;
+			int decoded = 0;
+			while (effectNextCue(reader, cue)) {
+				CHECK(sameCue(CUES[decoded], cue));
+				decoded++;
+			}
+			CHECK(decoded < NUM_CUES);
+			CHECK(reader.position <= data + length);
+		}
+
+		// A strip plays the cues that are there and then stops
+		HostHal::reset();
+		RgbStrip strip(3, 5, 6);
+		if (strip.playEffect(data, length, false, SEQUENCE_LOOP)) {
+			for (int i = 0; i < 10; i++) {
+				HostHal::advanceMillis(50000);
+				strip.update();
+			}
+			CHECK(!strip.isSequencePlaying());
+		}
+
+		delete[] data;
+	}
+}
+
+
+static void testCorrupt() {
+	EffectReader reader;
+	byte data[sizeof(CUES_PROGMEM)];
+
+	// Bad magic and unknown versions
+	for (int i = 0; i < 3; i++) {
+		memcpy(data, CUES_PROGMEM, sizeof(data));
+		data[i] ^= 0x20;
+		CHECK(!effectBegin(reader, data, sizeof(data), false));
+	}
+
+	// More cues than a reader can count
+	const byte tooMany[] = {'R', 'F', 1, 0x80, 0x80, 0x04};
+	CHECK(!effectBegin(reader, tooMany, sizeof(tooMany), false));
+
+	// A varint longer than 32 bits
+	const byte overlong[] = {'R', 'F', 1, 1, EFFECT_FADE, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+	Keyframe cue;
+	CHECK(effectBegin(reader, overlong, sizeof(overlong), false));
+	CHECK(!effectNextCue(reader, cue));
+
+	// Times beyond 16 bits saturate
+	const byte longTime[] = {'R', 'F', 1, 1, EFFECT_HOLD, 0xFF, 0xFF, 0x7F};
+	CHECK(effectBegin(reader, longTime, sizeof(longTime), false));
+	CHECK(effectNextCue(reader, cue));
+	CHECK_EQUAL(0xFFFF, cue.holdTime);
+
+	// Random cue data never decodes past the end
+	srand(1);
+	for (int trial = 0; trial < 10000; trial++) {
+		memcpy(data, CUES_PROGMEM, 4);
+		for (size_t i = 4; i < sizeof(data); i++) {
+			data[i] = rand();
+		}
+
+		CHECK(effectBegin(reader, data, sizeof(data), false));
+		while (effectNextCue(reader, cue)) {
+		}
+		CHECK(reader.position <= data + sizeof(data));
+	}
+
+	// Data that isn't an effect doesn't play
+	HostHal::reset();
+	RgbStrip strip(3, 5, 6);
+	CHECK(!strip.playEffect(NULL, 0, false, SEQUENCE_ONCE));
+	CHECK(!strip.playEffect(tooMany, sizeof(tooMany), false, SEQUENCE_ONCE));
+	const byte noCues[] = {'R', 'F', 1, 0};
+	CHECK(!strip.playEffect(noCues, sizeof(noCues), false, SEQUENCE_ONCE));
+	CHECK(!strip.isSequencePlaying());
+}
+
+
+int main() {
+	testRam();
+	testProgmem();
+	testFile();
+	testTruncated();
+	testCorrupt();
+	return TestCheck::result();
+}
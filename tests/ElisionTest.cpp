@@ -0,0 +1,108 @@
+/*
+* ElisionTest.cpp
+*
+* Skipped pin writes: a change to one channel writes only that channel's pin, and every skipped write
+* is counted by getElidedWriteCount(). Dithering is off (the default), so a channel whose level does not
+* move keeps its duty cycle.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+
+static const RGB START = {0, 100, 50};
+static const RGB RED_UP = {200, 100, 50};
+
+
+// Setting the colour already shown writes nothing, and counts all three channels as skipped
+static void testUnchanged() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.setTargetColour(START);
+	strip.resetWriteCounts();
+
+	unsigned long writes = HostHal::getWriteCount();
+	unsigned long red = HostHal::getPinWriteCount(3);
+	strip.setTargetColour(START);
+	CHECK_EQUAL(writes, HostHal::getWriteCount());
+	CHECK_EQUAL(0, strip.getWriteCount());
+	CHECK_EQUAL(3, strip.getElidedWriteCount());
+
+	// Changing one channel writes one pin and skips the other two
+	strip.setTargetColour(RED_UP);
+	CHECK_EQUAL(writes + 1, HostHal::getWriteCount());
+	CHECK_EQUAL(red + 1, HostHal::getPinWriteCount(3));
+	CHECK_EQUAL(1, strip.getWriteCount());
+	CHECK_EQUAL(5, strip.getElidedWriteCount());
+}
+
+
+// A fade of the red channel alone, updated every millisecond. At 8 bits red steps through each of its
+// 200 duty cycles once; every other channel output is skipped.
+static void testFade() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.setTargetColour(START);
+	unsigned long green = HostHal::getPinWriteCount(5);
+	unsigned long blue = HostHal::getPinWriteCount(6);
+	unsigned long red = HostHal::getPinWriteCount(3);
+	strip.resetWriteCounts();
+
+	strip.setTargetColour(RED_UP, 1000);
+	for (int ms = 1; ms <= 1000; ms++) {
+		HostHal::advanceMillis(1);
+		strip.update();
+	}
+	CHECK(!strip.isFading());
+
+	CHECK_EQUAL(green, HostHal::getPinWriteCount(5));
+	CHECK_EQUAL(blue, HostHal::getPinWriteCount(6));
+	CHECK_EQUAL(red + 200, HostHal::getPinWriteCount(3));
+	CHECK_EQUAL(200, strip.getWriteCount());
+
+	// The 16-bit red level moves every millisecond, so each update() reduces all three channels
+	CHECK_EQUAL(3 * 1000 - 200, strip.getElidedWriteCount());
+}
+
+
+// Stepped transitions move red one level per step, writing it 200 times and skipping the other two
+// channels each time, and stop writing once it arrives
+static void testTransition() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.setTargetColour(START);
+	strip.enableTransitions();
+	strip.setTargetColour(RED_UP);
+	unsigned long green = HostHal::getPinWriteCount(5);
+	unsigned long blue = HostHal::getPinWriteCount(6);
+	strip.resetWriteCounts();
+
+	for (int i = 0; i < 300 && strip.getActiveColour().r != 200; i++) {
+		HostHal::advanceMillis(DEFAULT_TRANSITION_PERIOD);
+		strip.update();
+	}
+	CHECK_EQUAL(200, strip.getActiveColour().r);
+	CHECK_EQUAL(green, HostHal::getPinWriteCount(5));
+	CHECK_EQUAL(blue, HostHal::getPinWriteCount(6));
+	CHECK_EQUAL(200, strip.getWriteCount());
+	CHECK_EQUAL(2 * 200, strip.getElidedWriteCount());
+
+	// Further steps at the target write nothing
+	unsigned long writes = HostHal::getWriteCount();
+	for (int i = 0; i < 10; i++) {
+		HostHal::advanceMillis(DEFAULT_TRANSITION_PERIOD);
+		strip.update();
+	}
+	CHECK_EQUAL(writes, HostHal::getWriteCount());
+}
+
+
+int main() {
+	testUnchanged();
+	testFade();
+	testTransition();
+	return TestCheck::result();
+}
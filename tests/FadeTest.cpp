@@ -0,0 +1,145 @@
+/*
+* FadeTest.cpp
+*
+* Timed fades on the virtual clock: the colour part way through, and the target reached exactly at
+* the deadline, whether update() is called then or late. Output is read at 16 bits, where the duty
+* cycle is the pipeline level.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+#include <stdlib.h>
+
+
+// A strip writing 16-bit duty cycles straight away
+struct FadeRig {
+	SimpleTimer timer;
+	RgbStrip strip;
+
+	FadeRig() : strip(3, 5, 6, timer) {
+		strip.setOutputResolution(16);
+	}
+
+	// Move the clock on and update
+	void runTo(unsigned long ms) {
+		HostHal::setMicros((uint64_t) ms * 1000);
+		strip.update();
+	}
+
+	long red() {
+		return HostHal::getPinValue(3);
+	}
+
+	long blue() {
+		return HostHal::getPinValue(6);
+	}
+};
+
+
+// Linear fades move in proportion to the time elapsed, in both directions
+static void testMidpoint() {
+	HostHal::reset();
+	FadeRig rig;
+	RGB start = {0, 0, 200};
+	rig.strip.setTargetColour(start);
+	RGB end = {200, 0, 0};
+	rig.strip.setTargetColour(end, 1000);
+	CHECK(rig.strip.isFading());
+
+	// Within 8 of the 16-bit level: 1/32 of an 8-bit level
+	rig.runTo(250);
+	CHECK(labs(rig.red() - 200 * 257 / 4) <= 8);
+	CHECK(labs(rig.blue() - 200 * 257 * 3 / 4) <= 8);
+	rig.runTo(500);
+	CHECK(labs(rig.red() - 200 * 257 / 2) <= 8);
+	CHECK(labs(rig.blue() - 200 * 257 / 2) <= 8);
+	CHECK_EQUAL(100, rig.strip.getActiveColour().r);
+	rig.runTo(750);
+	CHECK(labs(rig.red() - 200 * 257 * 3 / 4) <= 8);
+}
+
+
+// The target is reached at the deadline exactly, not before or after
+static void testDeadline() {
+	HostHal::reset();
+	FadeRig rig;
+	RGB target = {200, 100, 50};
+	rig.strip.setTargetColour(target, 1000);
+
+	rig.runTo(999);
+	CHECK(rig.strip.isFading());
+	CHECK(rig.red() < 200 * 257);
+	CHECK(rig.red() > 199 * 257);
+
+	rig.runTo(1000);
+	CHECK(!rig.strip.isFading());
+	CHECK_EQUAL(200 * 257, rig.red());
+	CHECK_EQUAL(100 * 257, HostHal::getPinValue(5));
+	CHECK_EQUAL(50 * 257, rig.blue());
+	RGB active = rig.strip.getActiveColour();
+	CHECK(active.r == 200 && active.g == 100 && active.b == 50);
+}
+
+
+// An update() that comes late finishes the fade on the target, without overshooting it
+static void testLateUpdate() {
+	HostHal::reset();
+	FadeRig rig;
+	RGB target = {255, 0, 255};
+	rig.strip.setTargetColour(target, 1000);
+	rig.runTo(100);
+	CHECK(rig.strip.isFading());
+
+	// loop() busy from 100 ms to 5 s
+	unsigned long writes = HostHal::getWriteCount();
+	rig.runTo(5000);
+	CHECK(!rig.strip.isFading());
+	CHECK_EQUAL(0xFFFF, rig.red());
+	CHECK_EQUAL(0xFFFF, rig.blue());
+	CHECK_EQUAL(writes + 2, HostHal::getWriteCount());
+
+	// Nothing moves afterwards
+	rig.runTo(6000);
+	CHECK_EQUAL(writes + 2, HostHal::getWriteCount());
+
+	// A fade started at a clock time that wraps before its deadline still ends on time
+	HostHal::reset();
+	FadeRig wrap;
+	HostHal::setMicros((0xFFFFFFFFULL - 400) * 1000);
+	wrap.strip.setTargetColour(target, 1000);
+	HostHal::advanceMillis(500);
+	wrap.strip.update();
+	CHECK(labs(wrap.red() - 0xFFFF / 2) <= 8);
+	HostHal::advanceMillis(3000);
+	wrap.strip.update();
+	CHECK(!wrap.strip.isFading());
+	CHECK_EQUAL(0xFFFF, wrap.red());
+}
+
+
+// A long fade is within one 8-bit level of linear part way through, and still ends on the target
+static void testLongFade() {
+	HostHal::reset();
+	FadeRig rig;
+	const unsigned long HOUR = 3600000UL;
+	rig.strip.setTargetColour(COLOURS[WHITE], HOUR);
+
+	rig.runTo(HOUR / 2);
+	CHECK(labs(rig.red() - 0xFFFF / 2) <= 257);
+	rig.runTo(HOUR - 1);
+	CHECK(rig.strip.isFading());
+	CHECK(labs(rig.red() - 0xFFFF) <= 257);
+	rig.runTo(HOUR);
+	CHECK(!rig.strip.isFading());
+	CHECK_EQUAL(0xFFFF, rig.red());
+}
+
+
+int main() {
+	testMidpoint();
+	testDeadline();
+	testLateUpdate();
+	testLongFade();
+	return TestCheck::result();
+}
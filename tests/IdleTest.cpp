@@ -0,0 +1,172 @@
+/*
+* IdleTest.cpp
+*
+* How long a sketch may sleep: SimpleTimer::nextDeadline() and RgbStrip::msUntilNextEvent() for an
+* idle strip, strobing, a held sequence step, a fade, a pending commit and dithering.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+
+static void doNothing() {
+}
+
+
+static void testNextDeadline() {
+	HostHal::reset();
+	SimpleTimer timer;
+	CHECK_EQUAL(SimpleTimer::NO_DEADLINE, timer.nextDeadline());
+
+	int slow = timer.setInterval(10, doNothing);
+	CHECK_EQUAL(10, timer.nextDeadline());
+	HostHal::advanceMillis(4);
+	CHECK_EQUAL(6, timer.nextDeadline());
+
+	// The earliest timer sets the deadline
+	int fast = timer.setTimeout(3, doNothing);
+	CHECK_EQUAL(3, timer.nextDeadline());
+	timer.deleteTimer(fast);
+	CHECK_EQUAL(6, timer.nextDeadline());
+
+	// A due timer gives 0 until run() calls it, however late it is
+	HostHal::advanceMillis(20);
+	CHECK_EQUAL(0, timer.nextDeadline());
+	timer.setOverrunPolicy(slow, SimpleTimer::OVERRUN_SKIP);
+	timer.run();
+	CHECK_EQUAL(6, timer.nextDeadline());
+
+	// Disabled timers don't count
+	timer.disable(slow);
+	CHECK_EQUAL(SimpleTimer::NO_DEADLINE, timer.nextDeadline());
+}
+
+
+// With nothing scheduled the sketch can sleep until something else wakes it
+static void testIdle() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.setTargetColour(COLOURS[RED]);
+	strip.setBrightness(37);
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, strip.msUntilNextEvent());
+
+	strip.enableTransitions();
+	CHECK_EQUAL(DEFAULT_TRANSITION_PERIOD, strip.msUntilNextEvent());
+}
+
+
+// Sleeping until each strobe toggle wakes the sketch once per toggle, on time
+static void testStrobe() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.setStrobePeriod(100);
+	strip.enableStrobe();
+	CHECK_EQUAL(100, strip.msUntilNextEvent());
+	HostHal::advanceMillis(30);
+	CHECK_EQUAL(70, strip.msUntilNextEvent());
+
+	for (int i = 0; i < 4; i++) {
+		HostHal::idle(strip.msUntilNextEvent());
+		strip.update();
+		CHECK_EQUAL((i % 2 == 0) ? 0 : DEFAULT_BRIGHTNESS, strip.getBrightness());
+		CHECK_EQUAL(100, strip.msUntilNextEvent());
+	}
+	CHECK_EQUAL(400, HostHal::now() / 1000);
+	CHECK_EQUAL(4, HostHal::getWakeupCount());
+}
+
+
+static const Keyframe HOLD[] = {
+	// colour           brightness  fade   hold   easing
+	{{255, 0, 0},       100,        0,     500,   EASE_LINEAR},
+	{{0, 0, 255},       100,        200,   0,     EASE_LINEAR}
+};
+
+
+// A step holding its colour ends at a known time; its fade needs update() continuously
+static void testSequence() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.playSequence(HOLD, 2, SEQUENCE_ONCE);
+	CHECK_EQUAL(500, strip.msUntilNextEvent());
+	HostHal::advanceMillis(200);
+	strip.update();
+	CHECK_EQUAL(300, strip.msUntilNextEvent());
+
+	HostHal::idle(strip.msUntilNextEvent());
+	strip.update();
+	CHECK_EQUAL(1, strip.getSequenceStep());
+	CHECK(strip.isFading());
+	CHECK_EQUAL(0, strip.msUntilNextEvent());
+
+	// The last step has no hold, so the sequence ends as its fade does
+	HostHal::advanceMillis(200);
+	strip.update();
+	strip.update();
+	CHECK(!strip.isSequencePlaying());
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, strip.msUntilNextEvent());
+}
+
+
+static void testFade() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.setTargetColour(COLOURS[GREEN], 1000);
+	CHECK_EQUAL(0, strip.msUntilNextEvent());
+
+	HostHal::advanceMillis(1000);
+	strip.update();
+	CHECK(!strip.isFading());
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, strip.msUntilNextEvent());
+}
+
+
+// A change waiting in the back buffer is written by the next update(), so it can't wait
+static void testPendingCommit() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.enableDoubleBuffering();
+	strip.setTargetColour(COLOURS[BLUE]);
+	CHECK_EQUAL(0, strip.msUntilNextEvent());
+
+	strip.update();
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, strip.msUntilNextEvent());
+}
+
+
+// A dithering strip sleeps until its next frame, or indefinitely at an exact output level
+static void testDither() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	CHECK(strip.setDitherMode(DITHER_ERROR_DIFFUSION));
+	strip.setTargetColour(COLOURS[WHITE]);
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, strip.msUntilNextEvent());
+
+	strip.setBrightness(50);
+	CHECK_EQUAL(RGBSTRIP_DITHER_PERIOD, strip.msUntilNextEvent());
+	unsigned long writes = HostHal::getWriteCount();
+	for (int i = 0; i < 10; i++) {
+		HostHal::idle(strip.msUntilNextEvent());
+		strip.update();
+	}
+	CHECK_EQUAL(10 * RGBSTRIP_DITHER_PERIOD, HostHal::now() / 1000);
+	CHECK_EQUAL(writes + 30, HostHal::getWriteCount());
+}
+
+
+int main() {
+	testNextDeadline();
+	testIdle();
+	testStrobe();
+	testSequence();
+	testFade();
+	testPendingCommit();
+	testDither();
+	return TestCheck::result();
+}
@@ -0,0 +1,187 @@
+/*
+* IsrTest.cpp
+*
+* RgbIsrDriver: duty cycles committed by update() in loop() reach the pins on the next tick, merged
+* so each pin is written once, and ticks do no other work. Also strip commands with values that would
+* misbehave on the strip, which are refused or clamped when applied.
+*/
+
+#include "TestCheck.h"
+#include "RgbIsr.h"
+
+
+// Duty cycles reach the pins on the tick after the update() that committed them
+static void testTick() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbIsrDriver driver(strip);
+	CHECK(driver.isIdle());
+
+	// loop() changes the strip straight away, but the pins wait for the interrupt
+	strip.setTargetColour(COLOURS[RED]);
+	strip.setBrightness(40);
+	CHECK_EQUAL(255, strip.getActiveColour().r);
+	CHECK_EQUAL(0, HostHal::getPinValue(3));
+	CHECK(!driver.isIdle());
+	CHECK_EQUAL(0, driver.msUntilNextEvent());
+
+	unsigned long writes = HostHal::getWriteCount();
+	driver.update();
+	CHECK_EQUAL(writes, HostHal::getWriteCount());
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, driver.msUntilNextEvent());
+
+	driver.tick();
+	CHECK(driver.isIdle());
+	CHECK_EQUAL(102, HostHal::getPinValue(3));
+	CHECK_EQUAL(0, HostHal::getPinValue(5));
+	CHECK_EQUAL(1, driver.getTickCount());
+
+	// Nothing queued: the tick writes nothing
+	writes = HostHal::getWriteCount();
+	driver.tick();
+	CHECK_EQUAL(writes, HostHal::getWriteCount());
+	CHECK_EQUAL(2, driver.getTickCount());
+}
+
+
+// Several queued commits are latched together, writing each pin once with its latest duty cycle
+static void testLatch() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbIsrDriver driver(strip);
+
+	strip.setTargetColour(COLOURS[WHITE]);
+	driver.update();
+	strip.setBrightness(50);
+	driver.update();
+	strip.setTargetColour(COLOURS[RED]);
+	driver.update();
+
+	unsigned long writes = HostHal::getWriteCount();
+	driver.tick();
+	CHECK_EQUAL(writes + 3, HostHal::getWriteCount());
+	CHECK_EQUAL(128, HostHal::getPinValue(3));
+	CHECK_EQUAL(0, HostHal::getPinValue(5));
+	CHECK_EQUAL(0, HostHal::getPinValue(6));
+}
+
+
+// A full queue holds back the latest levels until a tick makes room, without losing any
+static void testFullQueue() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbIsrDriver driver(strip);
+	strip.setTargetColour(COLOURS[WHITE]);
+
+	for (int i = 0; i < RGBISR_QUEUE_SIZE + 3; i++) {
+		strip.setBrightness(10 + i);
+		driver.update();
+	}
+	strip.setTargetColour(COLOURS[BLUE]);
+	driver.update();
+	CHECK_EQUAL(0, driver.msUntilNextEvent());
+
+	driver.tick();
+	CHECK(!driver.isIdle());
+	driver.update();
+	driver.tick();
+	CHECK(driver.isIdle());
+
+	// The pins end up as a strip written directly would
+	SimpleTimer directTimer;
+	RgbStrip direct(9, 10, 11, directTimer);
+	direct.setTargetColour(COLOURS[BLUE]);
+	direct.setBrightness(strip.getBrightness());
+	CHECK_EQUAL(0, HostHal::getPinValue(3));
+	CHECK_EQUAL(0, HostHal::getPinValue(5));
+	CHECK_EQUAL(HostHal::getPinValue(11), HostHal::getPinValue(6));
+	CHECK(HostHal::getPinValue(6) > 0);
+}
+
+
+// Transitions and dithering run in loop()'s update(); ticks on their own change nothing
+static void testUpdateInLoop() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbIsrDriver driver(strip);
+	strip.enableTransitions();
+	strip.setTargetColour(COLOURS[GREEN]);
+
+	for (int i = 0; i < 20; i++) {
+		HostHal::advanceMillis(DEFAULT_TRANSITION_PERIOD);
+		driver.tick();
+	}
+	CHECK_EQUAL(0, strip.getActiveColour().g);
+	CHECK_EQUAL(0, HostHal::getPinValue(5));
+
+	for (int i = 0; i < 20; i++) {
+		HostHal::advanceMillis(DEFAULT_TRANSITION_PERIOD);
+		driver.update();
+		driver.tick();
+	}
+	CHECK(strip.getActiveColour().g > 0);
+	CHECK_EQUAL(strip.getActiveColour().g, HostHal::getPinValue(5));
+	CHECK(driver.msUntilNextEvent() <= DEFAULT_TRANSITION_PERIOD);
+}
+
+
+static StripCommand valueCommand(byte type, long value) {
+	StripCommand command;
+	command.type = type;
+	command.colour = COLOURS[OFF];
+	command.value = value;
+	return command;
+}
+
+
+// Flash counts of zero or less would start a flash that never ends, and take a timer slot for good
+static void testFlashCounts() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	int idle = timer.getNumTimers();
+
+	// Commands that carry them are ignored when applied
+	applyStripCommand(strip, valueCommand(STRIP_FLASH, 0));
+	applyStripCommand(strip, valueCommand(STRIP_FLASH, -1));
+	CHECK_EQUAL(idle, timer.getNumTimers());
+
+	applyStripCommand(strip, valueCommand(STRIP_FLASH, 2));
+	CHECK_EQUAL(idle + 1, timer.getNumTimers());
+
+	// Counts too large for an int on AVR are capped rather than truncated to 0
+	SimpleTimer otherTimer;
+	RgbStrip otherStrip(9, 10, 11, otherTimer);
+	applyStripCommand(otherStrip, valueCommand(STRIP_FLASH, 0x10000L));
+	CHECK_EQUAL(idle + 1, otherTimer.getNumTimers());
+}
+
+
+// Brightness values are clamped while they are still long
+static void testBrightnessRange() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+
+	applyStripCommand(strip, valueCommand(STRIP_BRIGHTNESS, 0x10000L + 20));
+	CHECK_EQUAL(FULL_BRIGHTNESS, strip.getBrightness());
+	applyStripCommand(strip, valueCommand(STRIP_BRIGHTNESS, -0x10000L + 20));
+	CHECK_EQUAL(0, strip.getBrightness());
+	applyStripCommand(strip, valueCommand(STRIP_BRIGHTNESS, 55));
+	CHECK_EQUAL(55, strip.getBrightness());
+}
+
+
+int main() {
+	testTick();
+	testLatch();
+	testFullQueue();
+	testUpdateInLoop();
+	testFlashCounts();
+	testBrightnessRange();
+	return TestCheck::result();
+}
@@ -0,0 +1,142 @@
+/*
+* IsrThreadTest.cpp
+*
+* The single-producer/single-consumer queue and RgbIsrDriver across real threads, with
+* HostHal::TimerThread standing in for the timer interrupt. CMakeLists.txt builds this test with
+* ThreadSanitizer when the compiler supports it, so a race in the handoff fails the test even
+* when the values happen to come out right.
+*/
+
+#include "TestCheck.h"
+#include "RgbIsr.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+
+// Commands pushed through the queue by the producer thread
+const long NUM_COMMANDS = 100000;
+
+struct QueueTest {
+	StripCommandQueue<8> queue;
+	long full;	// Producer only: pushes refused because the queue was full
+};
+
+
+// Push NUM_COMMANDS numbered commands, waiting whenever the queue is full
+static void* produce(void* context) {
+	QueueTest* test = (QueueTest*) context;
+	StripCommand command;
+	command.type = STRIP_BRIGHTNESS;
+	command.colour = COLOURS[OFF];
+
+	for (long i = 0; i < NUM_COMMANDS; i++) {
+		command.value = i;
+		command.colour.r = i;
+		while (!test->queue.push(command)) {
+			test->full++;
+			sched_yield();
+		}
+	}
+
+	return NULL;
+}
+
+
+// Every command arrives exactly once, whole and in order
+static void testQueue() {
+	QueueTest test;
+	test.full = 0;
+	pthread_t producer;
+	CHECK_EQUAL(0, pthread_create(&producer, NULL, produce, &test));
+
+	long expected = 0;
+	long wrong = 0;
+	StripCommand command;
+	while (expected < NUM_COMMANDS) {
+		if (!test.queue.pop(command)) {
+			sched_yield();
+			continue;
+		}
+
+		if (command.type != STRIP_BRIGHTNESS || command.value != expected || command.colour.r != (byte) expected) {
+			wrong++;
+		}
+		expected++;
+	}
+
+	pthread_join(producer, NULL);
+	CHECK_EQUAL(0, wrong);
+	CHECK(test.queue.isEmpty());
+	CHECK(!test.queue.pop(command));
+	printf("queue: %ld commands, producer found the queue full %ld times\n", NUM_COMMANDS, test.full);
+}
+
+
+static void tickDriver(void* driver) {
+	((RgbIsrDriver*) driver)->tick();
+}
+
+
+static void sleepMicros(long us) {
+	struct timespec ts;
+	ts.tv_sec = 0;
+	ts.tv_nsec = us * 1000;
+	nanosleep(&ts, NULL);
+}
+
+
+// loop() changes and updates the strip as fast as it can while a 250 us timer thread latches its output
+static void testDriver() {
+	HostHal::reset();
+	HostHal::setClockSource(HostHal::realMicros);
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbIsrDriver driver(strip);
+	strip.setTransitionPeriod(TRANSITION_PERIOD_STEP);
+	strip.enableTransitions();
+
+	HostHal::TimerThread thread;
+	CHECK(thread.start(250, tickDriver, &driver));
+	CHECK(thread.isRunning());
+
+	long changes = 0;
+	uint64_t start = HostHal::realMicros();
+	while (HostHal::realMicros() - start < 300000) {
+		RGB colour = {(byte)(changes * 37), (byte)(changes * 11), (byte)(changes * 5)};
+		strip.setTargetColour(colour);
+		strip.setBrightness(changes % 100);
+		driver.update();
+		changes++;
+		if (changes % 64 == 0) {
+			sleepMicros(500);
+		}
+	}
+
+	// The last levels are kept until the interrupt has written them
+	strip.disableTransitions();
+	strip.setTargetColour(COLOURS[WHITE]);
+	strip.setBrightness(60);
+	while (!driver.isIdle()) {
+		driver.update();
+		sleepMicros(100);
+	}
+
+	// stop() waits for the tick in progress, so the pins can be read from here afterwards
+	thread.stop();
+	CHECK(!thread.isRunning());
+	CHECK(driver.getTickCount() > 0);
+	CHECK_EQUAL(153, HostHal::getPinValue(3));
+	CHECK_EQUAL(153, HostHal::getPinValue(5));
+	CHECK_EQUAL(153, HostHal::getPinValue(6));
+	printf("driver: %ld changes, %lu ticks\n", changes, driver.getTickCount());
+
+	HostHal::reset();
+}
+
+
+int main() {
+	testQueue();
+	testDriver();
+	return TestCheck::result();
+}
@@ -0,0 +1,217 @@
+/*
+* OverrunTest.cpp
+*
+* What SimpleTimer does when loop() is blocked past one or more deadlines: each OVERRUN_ policy,
+* the missed tick count given to timer_callback_missed callbacks, and the late call statistics.
+*/
+
+#include "TestCheck.h"
+#include "SimpleTimer.h"
+
+
+struct FireLog {
+	int count;
+	unsigned long missed;
+	unsigned int lastMissed;
+};
+
+static void logFire(void* context) {
+	((FireLog*) context)->count++;
+}
+
+static void logFireMissed(void* context, unsigned int missed) {
+	FireLog* log = (FireLog*) context;
+	log->count++;
+	log->missed += missed;
+	log->lastMissed = missed;
+}
+
+
+// Run a timer every ms for the given time
+static void runFor(SimpleTimer& timer, int ms) {
+	for (int i = 0; i < ms; i++) {
+		HostHal::advanceMillis(1);
+		timer.run();
+	}
+}
+
+
+// 50 ms on time, then loop() blocked for 95 ms: the deadlines at 60-140 ms pass without a run()
+static void stall(SimpleTimer& timer) {
+	runFor(timer, 50);
+	HostHal::advanceMillis(95);
+	timer.run();
+}
+
+
+// Plain callbacks default to OVERRUN_BURST: one call per run() until every missed deadline has been called
+static void testBurst() {
+	HostHal::reset();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0};
+	int id = timer.setInterval(10, logFire, &log);
+	CHECK_EQUAL(SimpleTimer::OVERRUN_BURST, timer.getOverrunPolicy(id));
+
+	stall(timer);
+	CHECK_EQUAL(6, log.count);
+	for (int i = 1; i <= 5; i++) {
+		runFor(timer, 1);
+		CHECK_EQUAL(6 + i, log.count);
+	}
+
+	// By 200 ms every deadline from 10 ms on has had its call
+	runFor(timer, 50);
+	CHECK_EQUAL(20, log.count);
+}
+
+
+// OVERRUN_SKIP calls once and drops the missed deadlines, staying on the original 10 ms phase
+static void testSkip() {
+	HostHal::reset();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0};
+	int id = timer.setInterval(10, logFire, &log);
+	timer.setOverrunPolicy(id, SimpleTimer::OVERRUN_SKIP);
+	CHECK_EQUAL(SimpleTimer::OVERRUN_SKIP, timer.getOverrunPolicy(id));
+
+	stall(timer);
+	CHECK_EQUAL(6, log.count);
+	runFor(timer, 4);
+	CHECK_EQUAL(6, log.count);
+	runFor(timer, 1);
+	CHECK_EQUAL(7, log.count);
+
+	// Deadlines at 150-200 ms
+	runFor(timer, 50);
+	CHECK_EQUAL(12, log.count);
+}
+
+
+// OVERRUN_COALESCE is the default for missed-count callbacks, and tells them what was dropped
+static void testCoalesce() {
+	HostHal::reset();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0};
+	int id = timer.setInterval(10, logFireMissed, &log);
+	CHECK_EQUAL(SimpleTimer::OVERRUN_COALESCE, timer.getOverrunPolicy(id));
+
+	stall(timer);
+	CHECK_EQUAL(6, log.count);
+	CHECK_EQUAL(8, log.lastMissed);
+	runFor(timer, 55);
+	CHECK_EQUAL(12, log.count);
+	CHECK_EQUAL(0, log.lastMissed);
+	CHECK_EQUAL(8, log.missed);
+
+	// A timer that fell behind under BURST is told nothing was missed, as every deadline gets its call
+	HostHal::reset();
+	SimpleTimer burst;
+	FireLog burstLog = {0, 0, 0};
+	id = burst.setInterval(10, logFireMissed, &burstLog);
+	burst.setOverrunPolicy(id, SimpleTimer::OVERRUN_BURST);
+	stall(burst);
+	runFor(burst, 55);
+	CHECK_EQUAL(20, burstLog.count);
+	CHECK_EQUAL(0, burstLog.missed);
+}
+
+
+// Missed ticks count towards a limited timer's runs, and never take it past its last one
+static void testLimitedRuns() {
+	HostHal::reset();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0};
+	timer.setTimer(10, logFireMissed, &log, 8);
+
+	stall(timer);
+	CHECK_EQUAL(6, log.count);
+	CHECK_EQUAL(2, log.lastMissed);
+	CHECK_EQUAL(0, timer.getNumTimers());
+
+	runFor(timer, 100);
+	CHECK_EQUAL(6, log.count);
+	CHECK_EQUAL(8, log.count + log.missed);
+}
+
+
+// A missed count too large for 16 bits is passed as 65535, and the phase still moves on
+static void testMissedSaturates() {
+	HostHal::reset();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0};
+	timer.setInterval(1, logFireMissed, &log);
+
+	HostHal::advanceMillis(100000);
+	timer.run();
+	CHECK_EQUAL(1, log.count);
+	CHECK_EQUAL(0xFFFF, log.lastMissed);
+
+	runFor(timer, 1);
+	CHECK_EQUAL(2, log.count);
+	CHECK_EQUAL(0, log.lastMissed);
+}
+
+
+// Late calls are counted and the worst lateness kept, until resetLateness()
+static void testLateness() {
+	HostHal::reset();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0};
+	int id = timer.setInterval(10, logFire, &log);
+	timer.setOverrunPolicy(id, SimpleTimer::OVERRUN_SKIP);
+
+	// Calls less than a whole period late aren't counted, but their lateness is kept
+	runFor(timer, 9);
+	HostHal::advanceMillis(6);
+	timer.run();
+	CHECK_EQUAL(0, timer.getLateCount());
+	CHECK_EQUAL(5, timer.getMaxLateness());
+
+	// The 95 ms stall makes one call 85 ms late
+	timer.resetLateness();
+	CHECK_EQUAL(0, timer.getLateCount());
+	CHECK_EQUAL(0, timer.getMaxLateness());
+	HostHal::reset();
+	timer.restartTimer(id);
+	stall(timer);
+	CHECK_EQUAL(1, timer.getLateCount());
+	CHECK_EQUAL(85, timer.getMaxLateness());
+
+	// Smaller lateness afterwards doesn't lower the maximum
+	runFor(timer, 100);
+	CHECK_EQUAL(1, timer.getLateCount());
+	CHECK_EQUAL(85, timer.getMaxLateness());
+}
+
+
+// The late count stops at 65535 rather than wrapping to zero
+static void testLateCountSaturates() {
+	HostHal::reset();
+	SimpleTimer timer;
+	FireLog log = {0, 0, 0};
+	timer.setInterval(1, logFire, &log);
+
+	// Under BURST, every call while catching up on 70000 ticks is late
+	HostHal::advanceMillis(70000);
+	for (int i = 0; i < 70000; i++) {
+		timer.run();
+	}
+	CHECK_EQUAL(70000, log.count);
+	CHECK_EQUAL(0xFFFF, timer.getLateCount());
+	CHECK_EQUAL(69999, timer.getMaxLateness());
+
+	timer.resetLateness();
+	CHECK_EQUAL(0, timer.getLateCount());
+}
+
+
+int main() {
+	testBurst();
+	testSkip();
+	testCoalesce();
+	testLimitedRuns();
+	testMissedSaturates();
+	testLateness();
+	testLateCountSaturates();
+	return TestCheck::result();
+}
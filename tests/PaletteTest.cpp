@@ -0,0 +1,200 @@
+/*
+* PaletteTest.cpp
+*
+* Runtime palettes: loading from PROGMEM, hex colours, lookups by code and name hash, refusing duplicate
+* codes and names and entries past capacity, and swapping or editing a palette while a strip uses it.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+
+static const PaletteEntry STAGE[] PROGMEM = {
+	{{255, 147, 41}, 'a', colourNameHash("amber")},
+	{{0, 64, 255}, 'd', colourNameHash("deep blue")},
+	{{10, 20, 30}, 0, NO_COLOUR_NAME},
+	{{1, 2, 3}, 'a', NO_COLOUR_NAME},	// Code already taken
+	{{4, 5, 6}, 0, colourNameHash("Amber")}	// Name already taken
+};
+
+
+static bool sameColour(RGB a, RGB b) {
+	return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+
+// Entries load in order, skipping those whose code or name is taken
+static void testLoad() {
+	RgbPaletteT<8> palette;
+	CHECK_EQUAL(0, palette.size());
+	CHECK_EQUAL(8, palette.capacity());
+
+	CHECK_EQUAL(3, palette.load(STAGE, 5));
+	CHECK_EQUAL(3, palette.size());
+	RGB amber = {255, 147, 41};
+	RGB unnamed = {10, 20, 30};
+	CHECK(sameColour(amber, palette.get(0)));
+	CHECK(sameColour(unnamed, palette.get(2)));
+
+	// Out of range indexes give black
+	RGB black = {0, 0, 0};
+	CHECK(sameColour(black, palette.get(3)));
+	CHECK(!palette.set(3, amber));
+
+	palette.clear();
+	CHECK_EQUAL(0, palette.size());
+	CHECK_EQUAL(NO_COLOUR, palette.indexOf('a'));
+	CHECK_EQUAL(NO_COLOUR, palette.indexOfName("amber"));
+}
+
+
+static void testHex() {
+	RgbPaletteT<8> palette;
+	CHECK_EQUAL(0, palette.addHex("#FF00aa", 'k', "pink"));
+	CHECK_EQUAL(1, palette.addHex("102030"));
+	RGB pink = {255, 0, 170};
+	RGB plain = {0x10, 0x20, 0x30};
+	CHECK(sameColour(pink, palette.get(0)));
+	CHECK(sameColour(plain, palette.get(1)));
+
+	// Not hex colours: nothing is added
+	CHECK_EQUAL(-1, palette.addHex("#FF00A"));
+	CHECK_EQUAL(-1, palette.addHex("#FF00AA0"));
+	CHECK_EQUAL(-1, palette.addHex("#GG0000"));
+	CHECK_EQUAL(-1, palette.addHex(NULL));
+	CHECK_EQUAL(2, palette.size());
+}
+
+
+// Codes are found with one table read, names by hash, ignoring case
+static void testLookup() {
+	RgbPaletteT<8> palette;
+	palette.load(STAGE, 3);
+	palette.add(COLOURS[GREEN], 'g', "Green");
+
+	CHECK_EQUAL(0, palette.indexOf('a'));
+	CHECK_EQUAL(1, palette.indexOf('d'));
+	CHECK_EQUAL(3, palette.indexOf('g'));
+	CHECK_EQUAL(NO_COLOUR, palette.indexOf('z'));
+	CHECK_EQUAL(NO_COLOUR, palette.indexOf((char) 0xC0));
+
+	CHECK_EQUAL(0, palette.indexOfName("amber"));
+	CHECK_EQUAL(0, palette.indexOfName("AMBER"));
+	CHECK_EQUAL(1, palette.indexOfName("Deep Blue"));
+	CHECK_EQUAL(3, palette.indexOfName("green"));
+	CHECK_EQUAL(3, palette.indexOfHash(colourNameHash("GREEN")));
+	CHECK_EQUAL(NO_COLOUR, palette.indexOfName("violet"));
+	CHECK_EQUAL(NO_COLOUR, palette.indexOfName(NULL));
+	CHECK_EQUAL(NO_COLOUR, palette.indexOfHash(NO_COLOUR_NAME));
+
+	// The hash is worked out at compile time as well as run time, and is never NO_COLOUR_NAME
+	static_assert(colourNameHash("amber") == colourNameHash("Amber"), "Names hash without case");
+	CHECK(colourNameHash("") != NO_COLOUR_NAME);
+}
+
+
+// A code or name already in the palette is refused, and the palette is left as it was
+static void testDuplicates() {
+	RgbPaletteT<8> palette;
+	CHECK_EQUAL(0, palette.add(COLOURS[RED], 'r', "red"));
+	CHECK_EQUAL(-1, palette.add(COLOURS[BLUE], 'r', "blue"));
+	CHECK_EQUAL(-1, palette.add(COLOURS[BLUE], 'b', "Red"));
+	CHECK_EQUAL(1, palette.size());
+	CHECK_EQUAL(NO_COLOUR, palette.indexOf('b'));
+	CHECK_EQUAL(NO_COLOUR, palette.indexOfName("blue"));
+
+	// Entries without a code or name don't clash with each other
+	CHECK_EQUAL(1, palette.add(COLOURS[BLUE]));
+	CHECK_EQUAL(2, palette.add(COLOURS[BLUE]));
+
+	// Codes outside 7-bit ASCII don't fit the code table
+	CHECK_EQUAL(-1, palette.add(COLOURS[BLUE], (char) 0x80));
+}
+
+
+static void testCapacity() {
+	RgbPaletteT<2> palette;
+	CHECK_EQUAL(0, palette.add(COLOURS[RED], 'r', "red"));
+	CHECK_EQUAL(1, palette.add(COLOURS[GREEN], 'g', "green"));
+	CHECK_EQUAL(-1, palette.add(COLOURS[BLUE], 'b', "blue"));
+	CHECK_EQUAL(-1, palette.addHex("#0000FF"));
+	CHECK_EQUAL(2, palette.size());
+	CHECK_EQUAL(NO_COLOUR, palette.indexOf('b'));
+	CHECK_EQUAL(NO_COLOUR, palette.indexOfName("blue"));
+
+	// A load into a full palette adds nothing
+	CHECK_EQUAL(0, palette.load(STAGE, 3));
+	CHECK_EQUAL(2, palette.size());
+
+	// The largest palette holds 255 colours, leaving index 255 for NO_COLOUR
+	RgbPaletteT<PALETTE_MAX_COLOURS> large;
+	int added = 0;
+	for (int i = 0; i < 300; i++) {
+		if (large.add(COLOURS[RED]) >= 0) {
+			added++;
+		}
+	}
+	CHECK_EQUAL(PALETTE_MAX_COLOURS, added);
+}
+
+
+// A strip reads its palette when a colour is set: swapping or editing the palette changes the colours
+// set afterwards, and leaves the colour shown and any fade in progress alone
+static void testSwap() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	RgbPaletteT<4> day;
+	RgbPaletteT<4> night;
+	day.add(COLOURS[WHITE], 'x', "main");
+	night.add(COLOURS[BLUE], 'x', "main");
+	night.add(COLOURS[RED], 'y', "accent");
+
+	strip.setPalette(&day);
+	CHECK(strip.getPalette() == &day);
+	strip.setTargetColour("main");
+	CHECK(sameColour(COLOURS[WHITE], strip.getActiveColour()));
+
+	strip.setPalette(&night);
+	CHECK(sameColour(COLOURS[WHITE], strip.getActiveColour()));
+	strip.setTargetColour('x');
+	CHECK(sameColour(COLOURS[BLUE], strip.getActiveColour()));
+	strip.setTargetColour(1);
+	CHECK(sameColour(COLOURS[RED], strip.getActiveColour()));
+
+	// Codes, names and indexes missing from the palette leave the colour alone
+	strip.setTargetColour("violet");
+	strip.setTargetColour('z');
+	strip.setTargetColour(2);
+	CHECK(sameColour(COLOURS[RED], strip.getActiveColour()));
+
+	// A fade carries on to the colour it started towards when the palette is swapped part way
+	strip.setTargetColour(night.get(0), 1000);
+	HostHal::advanceMillis(500);
+	strip.update();
+	strip.setPalette(&day);
+	CHECK(day.set(0, COLOURS[GREEN]));
+	HostHal::advanceMillis(500);
+	strip.update();
+	CHECK(sameColour(COLOURS[BLUE], strip.getActiveColour()));
+
+	// The edited entry is used from then on
+	strip.setTargetColour("main");
+	CHECK(sameColour(COLOURS[GREEN], strip.getActiveColour()));
+
+	// Without a palette the built in colours are used again
+	strip.setPalette(NULL);
+	strip.setTargetColour((int) WHITE);
+	CHECK(sameColour(COLOURS[WHITE], strip.getActiveColour()));
+}
+
+
+int main() {
+	testLoad();
+	testHex();
+	testLookup();
+	testDuplicates();
+	testCapacity();
+	testSwap();
+	return TestCheck::result();
+}
@@ -0,0 +1,255 @@
+/*
+* PixelTest.cpp
+*
+* Frames a PixelStrip hands to its transport, read back through RecordingTransport: byte order, the
+* brightness and output curve table, per-pixel transitions, and strobe and flash.
+*/
+
+#include "TestCheck.h"
+#include "PixelStrip.h"
+
+#include <stdlib.h>
+
+
+static const RGB FIRST = {1, 2, 3};
+static const RGB SECOND = {4, 5, 6};
+
+
+// Two pixels in the given order encode to the expected bytes at full brightness
+static void checkOrder(byte order, const byte* expected) {
+	HostHal::reset();
+	RecordingTransport transport;
+	PixelStripT<2> strip(transport, order);
+	strip.setPixelColour(0, FIRST);
+	strip.setPixelColour(1, SECOND);
+	strip.update();
+
+	CHECK_EQUAL(1, transport.getFrameCount());
+	CHECK_EQUAL(6, transport.getFrameLength());
+	CHECK(memcmp(transport.getFrame(), expected, 6) == 0);
+	CHECK(memcmp(strip.getFrame(), expected, 6) == 0);
+
+	// Colours read back in RGB whatever the order
+	RGB colour = strip.getPixelColour(1);
+	CHECK(colour.r == 4 && colour.g == 5 && colour.b == 6);
+
+	// Nothing changed, so nothing is sent
+	strip.update();
+	CHECK_EQUAL(1, transport.getFrameCount());
+}
+
+
+static void testOrder() {
+	const byte GRB[] = {2, 1, 3, 5, 4, 6};
+	const byte RGB_ORDER[] = {1, 2, 3, 4, 5, 6};
+	const byte BGR[] = {3, 2, 1, 6, 5, 4};
+	checkOrder(PIXEL_GRB, GRB);
+	checkOrder(PIXEL_RGB, RGB_ORDER);
+	checkOrder(PIXEL_BGR, BGR);
+}
+
+
+// A strip with one pixel per level, in RGB order so frame byte n is level n / 3
+struct LevelRig {
+	RecordingTransport transport;
+	PixelStripT<256> strip;
+
+	LevelRig() : strip(transport, PIXEL_RGB) {
+		for (int level = 0; level < 256; level++) {
+			RGB colour = {(byte) level, (byte) level, (byte) level};
+			strip.setPixelColour(level, colour);
+		}
+		strip.update();
+	}
+
+	byte encoded(int level) {
+		return transport.getFrame()[level * 3];
+	}
+};
+
+
+// Every level is scaled by the brightness to within one encoded level, and full brightness is exact
+static void testBrightness() {
+	HostHal::reset();
+	LevelRig rig;
+	const int BRIGHTNESSES[] = {100, 50, 30, 0};
+
+	for (unsigned int i = 0; i < sizeof(BRIGHTNESSES) / sizeof(BRIGHTNESSES[0]); i++) {
+		int brightness = BRIGHTNESSES[i];
+		rig.strip.setBrightness(brightness);
+		rig.strip.update();
+
+		int wrong = 0;
+		int reversals = 0;
+		for (int level = 0; level < 256; level++) {
+			if (labs(rig.encoded(level) * 100L - level * brightness) > 100) {
+				wrong++;
+			}
+			if (level > 0 && rig.encoded(level) < rig.encoded(level - 1)) {
+				reversals++;
+			}
+		}
+		CHECK_EQUAL(0, wrong);
+		CHECK_EQUAL(0, reversals);
+	}
+
+	rig.strip.setBrightness(100);
+	rig.strip.update();
+	int changed = 0;
+	for (int level = 0; level < 256; level++) {
+		if (rig.encoded(level) != level) {
+			changed++;
+		}
+	}
+	CHECK_EQUAL(0, changed);
+
+	// Brightness changes send a new frame; the same brightness again does not
+	unsigned long frames = rig.transport.getFrameCount();
+	rig.strip.setBrightness(100);
+	rig.strip.update();
+	CHECK_EQUAL(frames, rig.transport.getFrameCount());
+}
+
+
+// The output curve is applied to the 16-bit level and rounded to 8 bits, as for RgbStrip
+static void testCurve() {
+	HostHal::reset();
+	LevelRig rig;
+	rig.strip.setOutputCurve(CURVE_GAMMA);
+	CHECK_EQUAL(CURVE_GAMMA, rig.strip.getOutputCurve());
+	rig.strip.update();
+
+	const uint16_t* gamma = OUTPUT_CURVE_TABLES[CURVE_GAMMA - 1];
+	int wrong = 0;
+	for (int level = 0; level < 256; level++) {
+		long expected = ((uint32_t) applyOutputCurve(gamma, level * 257) * 255 + 32767) / 65535;
+		if (rig.encoded(level) != expected) {
+			wrong++;
+		}
+	}
+	CHECK_EQUAL(0, wrong);
+	CHECK_EQUAL(0, rig.encoded(0));
+	CHECK_EQUAL(255, rig.encoded(255));
+	CHECK(rig.encoded(128) < 64);
+}
+
+
+// With transitions enabled only the pixel given a new target moves, one level per event
+static void testTransitions() {
+	HostHal::reset();
+	RecordingTransport transport;
+	PixelStripT<3> strip(transport, PIXEL_RGB);
+	strip.setTargetColour(SECOND);
+	strip.update();
+	strip.enableTransitions();
+
+	RGB target = {10, 5, 6};
+	strip.setPixelColour(1, target);
+	CHECK(!strip.isTargetColourReached());
+	CHECK_EQUAL(4, strip.getPixelColour(1).r);
+	CHECK_EQUAL(10, strip.getPixelTarget(1).r);
+
+	unsigned long frames = transport.getFrameCount();
+	HostHal::advanceMillis(DEFAULT_TRANSITION_PERIOD);
+	strip.update();
+	CHECK_EQUAL(frames + 1, transport.getFrameCount());
+	const byte STEPPED[] = {4, 5, 6, 5, 5, 6, 4, 5, 6};
+	CHECK(memcmp(transport.getFrame(), STEPPED, 9) == 0);
+
+	// Missed events are made up in one step
+	HostHal::advanceMillis(3 * DEFAULT_TRANSITION_PERIOD);
+	strip.update();
+	CHECK_EQUAL(8, strip.getPixelColour(1).r);
+	CHECK_EQUAL(frames + 2, transport.getFrameCount());
+
+	for (int i = 0; i < 10; i++) {
+		HostHal::advanceMillis(DEFAULT_TRANSITION_PERIOD);
+		strip.update();
+	}
+	CHECK(strip.isTargetColourReached());
+	const byte ARRIVED[] = {4, 5, 6, 10, 5, 6, 4, 5, 6};
+	CHECK(memcmp(transport.getFrame(), ARRIVED, 9) == 0);
+
+	// Two more frames on the way there, then none once every pixel has arrived
+	CHECK_EQUAL(frames + 4, transport.getFrameCount());
+}
+
+
+// Whether every byte of the last frame is zero
+static bool frameIsOff(RecordingTransport& transport) {
+	const byte* frame = transport.getFrame();
+	for (uint16_t i = 0; i < transport.getFrameLength(); i++) {
+		if (frame[i] != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Strobing sends alternate off and on frames each period, and disabling it leaves the strip on
+static void testStrobe() {
+	HostHal::reset();
+	RecordingTransport transport;
+	PixelStripT<2> strip(transport);
+	strip.setTargetColour(COLOURS[WHITE]);
+	strip.setBrightness(60);
+	strip.update();
+	strip.setStrobePeriod(100);
+	strip.enableStrobe();
+	CHECK(strip.isStrobeEnabled());
+
+	for (int i = 1; i <= 4; i++) {
+		HostHal::advanceMillis(100);
+		strip.update();
+		bool off = (i % 2 == 1);
+		CHECK_EQUAL(off ? 0 : 60, strip.getBrightness());
+		CHECK(frameIsOff(transport) == off);
+	}
+
+	HostHal::advanceMillis(100);
+	strip.update();
+	CHECK(frameIsOff(transport));
+	strip.disableStrobe();
+	strip.update();
+	CHECK_EQUAL(60, strip.getBrightness());
+	CHECK(!frameIsOff(transport));
+	CHECK_EQUAL(153, transport.getFrame()[0]);
+}
+
+
+// flash() turns the strip off and on the given number of times, FLASH_PERIOD apart, then stops
+static void testFlash() {
+	HostHal::reset();
+	RecordingTransport transport;
+	PixelStripT<2> strip(transport);
+	strip.setTargetColour(COLOURS[WHITE]);
+	strip.update();
+	CHECK(!strip.flash(0));
+	CHECK(strip.flash(2));
+
+	unsigned long frames = transport.getFrameCount();
+	for (int i = 1; i <= 4; i++) {
+		HostHal::advanceMillis(FLASH_PERIOD);
+		strip.update();
+		CHECK(frameIsOff(transport) == (i % 2 == 1));
+	}
+	CHECK_EQUAL(frames + 4, transport.getFrameCount());
+
+	HostHal::advanceMillis(10 * FLASH_PERIOD);
+	strip.update();
+	CHECK_EQUAL(frames + 4, transport.getFrameCount());
+	CHECK_EQUAL(DEFAULT_BRIGHTNESS, strip.getBrightness());
+	CHECK_EQUAL(RGBSTRIP_NO_EVENT, strip.msUntilNextEvent());
+}
+
+
+int main() {
+	testOrder();
+	testBrightness();
+	testCurve();
+	testTransitions();
+	testStrobe();
+	testFlash();
+	return TestCheck::result();
+}
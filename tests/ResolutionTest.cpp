@@ -0,0 +1,132 @@
+/*
+* ResolutionTest.cpp
+*
+* Reducing the 16-bit pipeline to the PWM resolution: 8-bit output keeps the values the strip wrote
+* before the pipeline was widened, and wider outputs reach full scale and round to the nearest level.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+#include <math.h>
+
+
+// Write a red level at the current settings and read back the duty cycle
+static int redDuty(RgbStrip& strip, byte red) {
+	RGB colour = {red, 0, 0};
+	strip.setTargetColour(colour);
+	return HostHal::getPinValue(3);
+}
+
+
+// At full brightness 8-bit levels are written unchanged, as before. Lower brightnesses used to truncate
+// colour * brightness / 100; they now round it, so the duty cycle is the same or one level higher.
+static void testEightBit() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	CHECK_EQUAL(8, strip.getOutputResolution());
+
+	int changed = 0;
+	int unrounded = 0;
+	for (int brightness = 0; brightness <= 100; brightness++) {
+		strip.setBrightness(brightness);
+		for (int level = 0; level < 256; level++) {
+			int duty = redDuty(strip, level);
+			int truncated = level * brightness / 100;
+			if (duty != truncated && (brightness == 100 || duty != truncated + 1)) {
+				changed++;
+			}
+			if (fabs(duty - level * brightness / 100.0) > 0.5) {
+				unrounded++;
+			}
+		}
+	}
+	CHECK_EQUAL(0, changed);
+	CHECK_EQUAL(0, unrounded);
+}
+
+
+// Every resolution maps white to 2^bits - 1 and off to 0
+static void testFullScale() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+
+	for (byte bits = 1; bits <= 16; bits++) {
+		strip.setOutputResolution(bits);
+		CHECK_EQUAL(bits, strip.getOutputResolution());
+		CHECK_EQUAL((1L << bits) - 1, redDuty(strip, 255));
+		CHECK_EQUAL(0, redDuty(strip, 0));
+	}
+
+	// Out of range resolutions are clamped
+	strip.setOutputResolution(0);
+	CHECK_EQUAL(1, strip.getOutputResolution());
+	strip.setOutputResolution(17);
+	CHECK_EQUAL(16, strip.getOutputResolution());
+}
+
+
+// 8-bit levels scale to level * (2^bits - 1) / 255, rounded. The level passes through 16 bits on the way,
+// which can move a result that is within 2^(bits - 17) of a half to the other side of it.
+static void testRounding() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	const byte RESOLUTIONS[] = {10, 12, 16};
+
+	for (unsigned int i = 0; i < sizeof(RESOLUTIONS); i++) {
+		byte bits = RESOLUTIONS[i];
+		strip.setOutputResolution(bits);
+		double tolerance = 0.5 + ldexp(1, bits - 17);
+		long maximum = (1L << bits) - 1;
+
+		int wrong = 0;
+		int reversals = 0;
+		int last = 0;
+		for (int level = 0; level < 256; level++) {
+			int duty = redDuty(strip, level);
+			if (fabs(duty - level * maximum / 255.0) > tolerance) {
+				wrong++;
+			}
+			if (duty < last) {
+				reversals++;
+			}
+			last = duty;
+		}
+		CHECK_EQUAL(0, wrong);
+		CHECK_EQUAL(0, reversals);
+	}
+
+	// At 16 bits the pipeline level is the duty cycle
+	CHECK_EQUAL(100 * 257, redDuty(strip, 100));
+
+	// 10-bit halves: 1 * 1023 / 255 = 4.01, 64 * 1023 / 255 = 256.75
+	strip.setOutputResolution(10);
+	CHECK_EQUAL(4, redDuty(strip, 1));
+	CHECK_EQUAL(257, redDuty(strip, 64));
+}
+
+
+// Duty cycles written at another resolution are not taken as already written
+static void testResolutionChange() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	redDuty(strip, 255);
+
+	strip.setOutputResolution(12);
+	unsigned long writes = HostHal::getPinWriteCount(3);
+	CHECK_EQUAL(4095, redDuty(strip, 255));
+	CHECK_EQUAL(writes + 1, HostHal::getPinWriteCount(3));
+}
+
+
+int main() {
+	testEightBit();
+	testFullScale();
+	testRounding();
+	testResolutionChange();
+	return TestCheck::result();
+}
@@ -0,0 +1,107 @@
+/*
+* SchedulerTest.cpp
+*
+* Strips get the timer slots they need, whether they have their own scheduler or share one,
+* and report it when a shared scheduler is full.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+#include "PixelStrip.h"
+
+
+// Run transitions for long enough to fade from off to white
+static void runTransitions(RgbStrip** strips, int count) {
+	for (int i = 0; i < count; i++) {
+		strips[i]->enableTransitions();
+		strips[i]->setTargetColour(COLOURS[WHITE]);
+	}
+
+	for (int ms = 0; ms < 3000; ms++) {
+		HostHal::advanceMillis(1);
+		for (int i = 0; i < count; i++) {
+			strips[i]->update();
+		}
+	}
+}
+
+
+// Strips created without a scheduler each have their own, however many there are
+static void testOwnTimers() {
+	HostHal::reset();
+	RgbStrip* strips[8];
+	for (int i = 0; i < 8; i++) {
+		strips[i] = new RgbStrip(i * 3, i * 3 + 1, i * 3 + 2);
+	}
+
+	runTransitions(strips, 8);
+	for (int i = 0; i < 8; i++) {
+		CHECK(strips[i]->isScheduled());
+		CHECK_EQUAL(255, strips[i]->getActiveColour().r);
+		CHECK(strips[i]->flash(2));
+		delete strips[i];
+	}
+}
+
+
+// A full shared scheduler is reported instead of silently leaving strips unscheduled
+static void testSharedTimer() {
+	HostHal::reset();
+	SimpleTimer timer;
+
+	// Two slots per strip: five strips fill the ten slots
+	RgbStrip* strips[6];
+	for (int i = 0; i < 6; i++) {
+		strips[i] = new RgbStrip(i * 3, i * 3 + 1, i * 3 + 2, timer);
+	}
+
+	for (int i = 0; i < 5; i++) {
+		CHECK(strips[i]->isScheduled());
+	}
+	CHECK(!strips[5]->isScheduled());
+	CHECK_EQUAL(0, timer.getNumAvailableTimers());
+
+	runTransitions(strips, 5);
+	CHECK_EQUAL(255, strips[4]->getActiveColour().r);
+
+	// No slot is left for a flash
+	CHECK(!strips[0]->flash(1));
+
+	for (int i = 0; i < 6; i++) {
+		delete strips[i];
+	}
+}
+
+
+// Pixel strips created without a scheduler also have their own
+static void testPixelStripTimers() {
+	HostHal::reset();
+	RecordingTransport transports[6];
+	PixelStripT<4>* strips[6];
+	for (int i = 0; i < 6; i++) {
+		strips[i] = new PixelStripT<4>(transports[i]);
+		CHECK(strips[i]->isScheduled());
+		strips[i]->enableTransitions();
+		strips[i]->setTargetColour(COLOURS[WHITE]);
+	}
+
+	for (int ms = 0; ms < 3000; ms++) {
+		HostHal::advanceMillis(1);
+		for (int i = 0; i < 6; i++) {
+			strips[i]->update();
+		}
+	}
+
+	for (int i = 0; i < 6; i++) {
+		CHECK(strips[i]->isTargetColourReached());
+		delete strips[i];
+	}
+}
+
+
+int main() {
+	testOwnTimers();
+	testSharedTimer();
+	testPixelStripTimers();
+	return TestCheck::result();
+}
@@ -0,0 +1,225 @@
+/*
+* SequenceTest.cpp
+*
+* The PROGMEM keyframe player on the virtual clock: when each step starts, looping and ping-pong
+* order, the step callback and SEQUENCE_FINISHED, and step timing across the millis() wrap.
+*/
+
+#include "TestCheck.h"
+#include "RgbStrip.h"
+
+
+static const Keyframe STEPS[] PROGMEM = {
+	// colour           brightness  fade   hold   easing
+	{{255, 0, 0},       100,        0,     300,   EASE_LINEAR},
+	{{0, 255, 0},       100,        100,   200,   EASE_LINEAR},
+	{{0, 0, 255},       50,         200,   0,     EASE_LINEAR}
+};
+static const int NUM_STEPS = 3;
+
+
+// Steps passed to the callback, in order
+struct StepLog {
+	int steps[32];
+	int count;
+
+	StepLog() : count(0) {
+	}
+};
+
+static void logStep(void* context, int step) {
+	StepLog* log = (StepLog*) context;
+	if (log->count < 32) {
+		log->steps[log->count++] = step;
+	}
+}
+
+
+// Run update() every millisecond up to the given time, from wherever the clock is
+static void runFor(RgbStrip& strip, unsigned long ms) {
+	for (unsigned long i = 0; i < ms; i++) {
+		HostHal::advanceMillis(1);
+		strip.update();
+	}
+}
+
+
+// Each step starts once the previous one has faded in and held, and fades to its colour and brightness
+static void testTiming() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.playSequence(STEPS, NUM_STEPS, SEQUENCE_ONCE);
+	CHECK(strip.isSequencePlaying());
+	CHECK_EQUAL(0, strip.getSequenceStep());
+	CHECK_EQUAL(255, strip.getActiveColour().r);
+	CHECK(!strip.isFading());
+
+	runFor(strip, 299);
+	CHECK_EQUAL(0, strip.getSequenceStep());
+	runFor(strip, 1);
+	CHECK_EQUAL(1, strip.getSequenceStep());
+	CHECK(strip.isFading());
+
+	// Half way through the fade to green
+	runFor(strip, 50);
+	CHECK_EQUAL(128, strip.getActiveColour().r);
+	CHECK_EQUAL(127, strip.getActiveColour().g);
+	runFor(strip, 50);
+	CHECK(!strip.isFading());
+	CHECK_EQUAL(255, strip.getActiveColour().g);
+
+	// Held for 200 ms, then the last step fades to half brightness blue
+	runFor(strip, 199);
+	CHECK_EQUAL(1, strip.getSequenceStep());
+	runFor(strip, 1);
+	CHECK_EQUAL(2, strip.getSequenceStep());
+	runFor(strip, 200);
+	RGB last = strip.getActiveColour();
+	CHECK(last.r == 0 && last.g == 0 && last.b == 127);
+
+	// The last step has no hold, so the sequence finishes with its fade
+	strip.update();
+	CHECK(!strip.isSequencePlaying());
+	CHECK_EQUAL(2, strip.getSequenceStep());
+}
+
+
+// A late update() starts the next step from when it was due, so the sequence keeps its tempo
+static void testLateUpdate() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.playSequence(STEPS, NUM_STEPS, SEQUENCE_ONCE);
+
+	// Step 1 was due at 300 ms and is half way through its fade at 350 ms
+	HostHal::advanceMillis(350);
+	strip.update();
+	CHECK_EQUAL(1, strip.getSequenceStep());
+	CHECK_EQUAL(127, strip.getActiveColour().g);
+
+	// Step 2 is still due at 600 ms
+	HostHal::advanceMillis(249);
+	strip.update();
+	CHECK_EQUAL(1, strip.getSequenceStep());
+	HostHal::advanceMillis(1);
+	strip.update();
+	CHECK_EQUAL(2, strip.getSequenceStep());
+}
+
+
+// SEQUENCE_LOOP goes back to the first step after the last, without finishing
+static void testLoop() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	StepLog log;
+	strip.setSequenceCallback(logStep, &log);
+	strip.playSequence(STEPS, NUM_STEPS, SEQUENCE_LOOP);
+
+	// One pass takes 300 + 300 + 200 ms
+	runFor(strip, 2 * 800);
+	CHECK(strip.isSequencePlaying());
+	CHECK_EQUAL(0, strip.getSequenceStep());
+	const int EXPECTED[] = {0, 1, 2, 0, 1, 2, 0};
+	CHECK_EQUAL(7, log.count);
+	for (int i = 0; i < 7 && i < log.count; i++) {
+		CHECK_EQUAL(EXPECTED[i], log.steps[i]);
+	}
+}
+
+
+// SEQUENCE_PING_PONG plays the steps backwards from the last, and forwards again from the first
+static void testPingPong() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	StepLog log;
+	strip.setSequenceCallback(logStep, &log);
+	strip.playSequence(STEPS, NUM_STEPS, SEQUENCE_PING_PONG);
+
+	// 0 (300 ms), 1 (300 ms), 2 (200 ms), 1, 0, 1, 2
+	runFor(strip, 300 + 300 + 200 + 300 + 300 + 300);
+	CHECK(strip.isSequencePlaying());
+	const int EXPECTED[] = {0, 1, 2, 1, 0, 1, 2};
+	CHECK_EQUAL(7, log.count);
+	for (int i = 0; i < 7 && i < log.count; i++) {
+		CHECK_EQUAL(EXPECTED[i], log.steps[i]);
+	}
+
+	// A single step sequence holds its step rather than running off either end
+	HostHal::reset();
+	SimpleTimer singleTimer;
+	RgbStrip single(3, 5, 6, singleTimer);
+	single.playSequence(STEPS, 1, SEQUENCE_PING_PONG);
+	runFor(single, 1000);
+	CHECK(single.isSequencePlaying());
+	CHECK_EQUAL(0, single.getSequenceStep());
+}
+
+
+// The callback sees every step as it starts, then SEQUENCE_FINISHED once, when SEQUENCE_ONCE ends
+static void testCallback() {
+	HostHal::reset();
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	StepLog log;
+	strip.setSequenceCallback(logStep, &log);
+	strip.playSequence(STEPS, NUM_STEPS, SEQUENCE_ONCE);
+	CHECK_EQUAL(1, log.count);
+	CHECK_EQUAL(0, log.steps[0]);
+
+	runFor(strip, 300);
+	CHECK_EQUAL(2, log.count);
+	runFor(strip, 300);
+	CHECK_EQUAL(3, log.count);
+	CHECK(strip.isSequencePlaying());
+	runFor(strip, 200);
+	CHECK(!strip.isSequencePlaying());
+	CHECK_EQUAL(4, log.count);
+	CHECK_EQUAL(1, log.steps[1]);
+	CHECK_EQUAL(2, log.steps[2]);
+	CHECK_EQUAL(SEQUENCE_FINISHED, log.steps[3]);
+
+	// Nothing more once it has finished, and stopping a sequence early calls nothing
+	runFor(strip, 1000);
+	CHECK_EQUAL(4, log.count);
+	strip.playSequence(STEPS, NUM_STEPS, SEQUENCE_ONCE);
+	strip.stopSequence();
+	runFor(strip, 1000);
+	CHECK_EQUAL(5, log.count);
+	CHECK(!strip.isSequencePlaying());
+}
+
+
+// A step that starts just before millis() wraps still ends on time
+static void testClockWrap() {
+	HostHal::reset();
+	HostHal::setMicros((0xFFFFFFFFULL - 100) * 1000);
+	SimpleTimer timer;
+	RgbStrip strip(3, 5, 6, timer);
+	strip.playSequence(STEPS, NUM_STEPS, SEQUENCE_ONCE);
+	CHECK_EQUAL(300, strip.msUntilNextEvent());
+
+	// 200 ms on the clock has wrapped
+	runFor(strip, 200);
+	CHECK_EQUAL(0, strip.getSequenceStep());
+	CHECK_EQUAL(100, strip.msUntilNextEvent());
+	runFor(strip, 99);
+	CHECK_EQUAL(0, strip.getSequenceStep());
+	runFor(strip, 1);
+	CHECK_EQUAL(1, strip.getSequenceStep());
+	runFor(strip, 50);
+	CHECK_EQUAL(127, strip.getActiveColour().g);
+}
+
+
+int main() {
+	testTiming();
+	testLateUpdate();
+	testLoop();
+	testPingPong();
+	testCallback();
+	testClockWrap();
+	return TestCheck::result();
+}
@@ -0,0 +1,53 @@
+/*
+* TestCheck.h
+*
+* Minimal checks for the host tests. Each test is its own executable, built by
+* CMakeLists.txt and run by ctest; a failed check prints its location and the
+* test exits non-zero from TestCheck::result().
+*/
+
+
+#ifndef TESTCHECK_H_
+#define TESTCHECK_H_
+
+#include <stdio.h>
+
+// Check that a condition holds
+#define CHECK(condition) TestCheck::check((condition), #condition, __FILE__, __LINE__)
+
+// Check that an integer expression has the expected value
+#define CHECK_EQUAL(expected, actual) TestCheck::checkEqual((long)(expected), (long)(actual), #actual, __FILE__, __LINE__)
+
+namespace TestCheck {
+	inline int& failures() {
+		static int count = 0;
+		return count;
+	}
+
+	inline bool check(bool passed, const char* text, const char* file, int line) {
+		if (!passed) {
+			printf("%s:%d: check failed: %s\n", file, line, text);
+			failures()++;
+		}
+		return passed;
+	}
+
+	inline bool checkEqual(long expected, long actual, const char* text, const char* file, int line) {
+		if (expected != actual) {
+			printf("%s:%d: %s is %ld, expected %ld\n", file, line, text, actual, expected);
+			failures()++;
+		}
+		return expected == actual;
+	}
+
+	// Exit status for main(): 0 if every check passed
+	inline int result() {
+		if (failures() > 0) {
+			printf("%d check(s) failed\n", failures());
+			return 1;
+		}
+		return 0;
+	}
+}
+
+#endif /* TESTCHECK_H_ */